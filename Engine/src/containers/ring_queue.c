@@ -0,0 +1,93 @@
+#include "ring_queue.h"
+#include "core/pancake_memory.h"
+#include "core/logger.h"
+
+static u64* cell_sequence(ring_queue* queue, u64 position) {
+    return (u64*)(queue->cells + (position & (queue->capacity - 1)) * queue->cell_size);
+}
+
+b8 ring_queue_create(u64 stride, u64 capacity, ring_queue* out_queue) {
+    if (!out_queue || stride == 0 || capacity < 2) {
+        PANCAKE_ERROR("ring_queue_create - requires a stride and a capacity of at least 2.");
+        return false;
+    }
+
+    // Power of 2 capacity, so positions wrap with a mask.
+    u64 rounded = 2;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+
+    pancake_zero_memory(out_queue, sizeof(ring_queue));
+    out_queue->stride = stride;
+    out_queue->capacity = rounded;
+    out_queue->cell_size = sizeof(u64) + ((stride + 7) & ~(u64)7);
+    out_queue->cells = pancake_allocate(out_queue->cell_size * rounded, MEMORY_TAG_RING_QUEUE);
+
+    // Cell i is first free for the producer at position i.
+    for (u64 i = 0; i < rounded; ++i) {
+        *cell_sequence(out_queue, i) = i;
+    }
+    __atomic_store_n(&out_queue->enqueue_position, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&out_queue->dequeue_position, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+void ring_queue_destroy(ring_queue* queue) {
+    if (queue && queue->cells) {
+        pancake_free(queue->cells, queue->cell_size * queue->capacity, MEMORY_TAG_RING_QUEUE);
+        pancake_zero_memory(queue, sizeof(ring_queue));
+    }
+}
+
+b8 ring_queue_push(ring_queue* queue, const void* value_ptr) {
+    u64 position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+    for (;;) {
+        u64* sequence = cell_sequence(queue, position);
+        u64 seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        i64 diff = (i64)seq - (i64)position;
+        if (diff == 0) {
+            // The cell is free for this position, try to claim it.
+            if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                pancake_copy_memory(sequence + 1, value_ptr, queue->stride);
+                // Hand the cell to the consumer of this position.
+                __atomic_store_n(sequence, position + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            // Lost the race, position now holds the current value.
+        } else if (diff < 0) {
+            // The cell still holds an element from a lap ago: full.
+            return false;
+        } else {
+            position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+b8 ring_queue_pop(ring_queue* queue, void* dest) {
+    u64 position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+    for (;;) {
+        u64* sequence = cell_sequence(queue, position);
+        u64 seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        i64 diff = (i64)seq - (i64)(position + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                pancake_copy_memory(dest, sequence + 1, queue->stride);
+                // Free the cell for the producer one lap ahead.
+                __atomic_store_n(sequence, position + queue->capacity, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (diff < 0) {
+            // Nothing published at this position yet: empty.
+            return false;
+        } else {
+            position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+u64 ring_queue_length(ring_queue* queue) {
+    u64 enqueue = __atomic_load_n(&queue->enqueue_position, __ATOMIC_ACQUIRE);
+    u64 dequeue = __atomic_load_n(&queue->dequeue_position, __ATOMIC_ACQUIRE);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+}
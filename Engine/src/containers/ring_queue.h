@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    Bounded lock-free queue of fixed-size elements, safe to push and pop from any number of
+    threads at once. Every cell carries a sequence number telling producers and consumers whose
+    turn it is, so a push or pop is a single compare-exchange on the shared cursor plus a copy.
+
+    Memory layout of a cell
+    u64 sequence
+    u8 element[stride], padded so the next cell's sequence is 8-byte aligned
+*/
+
+// Keeps the producer and consumer cursors on separate cache lines.
+#define RING_QUEUE_CACHE_LINE 64
+
+typedef struct ring_queue {
+    u64 stride;
+    u64 capacity;
+    u64 cell_size;
+    u8* cells;
+
+    u8 pad0[RING_QUEUE_CACHE_LINE];
+    u64 enqueue_position;
+    u8 pad1[RING_QUEUE_CACHE_LINE - sizeof(u64)];
+    u64 dequeue_position;
+    u8 pad2[RING_QUEUE_CACHE_LINE - sizeof(u64)];
+} ring_queue;
+
+/**
+ * Creates a ring queue. Not thread safe; create before sharing the queue.
+ * @param stride The size of each element in bytes.
+ * @param capacity The number of elements the queue can hold. Rounded up to a power of 2.
+ * @param out_queue A pointer to hold the created queue.
+ * @returns True on success; otherwise false.
+ */
+PANCAKE_API b8 ring_queue_create(u64 stride, u64 capacity, ring_queue* out_queue);
+
+// Destroys the queue. No thread may be using it anymore.
+PANCAKE_API void ring_queue_destroy(ring_queue* queue);
+
+/**
+ * Copies stride bytes from value_ptr to the back of the queue.
+ * @returns True if pushed, false if the queue is full.
+ */
+PANCAKE_API b8 ring_queue_push(ring_queue* queue, const void* value_ptr);
+
+/**
+ * Copies the element at the front of the queue to dest and removes it.
+ * @returns True if an element was popped, false if the queue is empty.
+ */
+PANCAKE_API b8 ring_queue_pop(ring_queue* queue, void* dest);
+
+// Number of elements in the queue. Only a snapshot while other threads are pushing or popping.
+PANCAKE_API u64 ring_queue_length(ring_queue* queue);
@@ -6,7 +6,15 @@
 #include "memory\linear_allocator.h"
 #include "core/event.h"
 #include "core/inputs.h"
+#include "core/input_recorder.h"
+#include "core/input_actions.h"
+#include "core/async_io.h"
+#include "core/derived_cache.h"
+#include "platform/filesystem.h"
+#include "platform/lz.h"
 #include "core/clock.h"
+#include "core/string_id.h"
+#include "core/pancake_string.h"
 #include "renderer/renderer_frontend.h"
 
 typedef struct application_state{
@@ -28,9 +36,27 @@ typedef struct application_state{
     u64 logging_system_memory_requirement;
     void* logging_system_state_ptr;
 
+    u64 string_id_system_memory_requirement;
+    void* string_id_system_state_ptr;
+
     u64 input_system_memory_requirement;
     void* input_system_state_ptr;
 
+    u64 input_recorder_memory_requirement;
+    void* input_recorder_state_ptr;
+
+    u64 input_actions_memory_requirement;
+    void* input_actions_state_ptr;
+
+    u64 lz_workers_memory_requirement;
+    void* lz_workers_state_ptr;
+
+    u64 async_io_memory_requirement;
+    void* async_io_state_ptr;
+
+    u64 derived_cache_memory_requirement;
+    void* derived_cache_state_ptr;
+
     u64 platform_system_memory_requirement;
     void* platform_system_state_ptr;
 
@@ -77,16 +103,66 @@ b8 application_create(game* game_inst){
         return false;
     }
 
+    //initialize string id sub-system
+    initialize_string_id_system(&app_state->string_id_system_memory_requirement, 0);
+    app_state->string_id_system_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->string_id_system_memory_requirement);
+    initialize_string_id_system(&app_state->string_id_system_memory_requirement, app_state->string_id_system_state_ptr);
+
     //Initialize Input sub-system
     initialize_inputs_system(&app_state->input_system_memory_requirement, 0);
     app_state->input_system_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->input_system_memory_requirement);
     initialize_inputs_system(&app_state->input_system_memory_requirement, app_state->input_system_state_ptr);
 
+    //input actions
+    initialize_input_actions_system(&app_state->input_actions_memory_requirement, 0);
+    app_state->input_actions_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->input_actions_memory_requirement);
+    initialize_input_actions_system(&app_state->input_actions_memory_requirement, app_state->input_actions_state_ptr);
+
+    //input recording/replay
+    initialize_input_recorder(&app_state->input_recorder_memory_requirement, 0);
+    app_state->input_recorder_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->input_recorder_memory_requirement);
+    initialize_input_recorder(&app_state->input_recorder_memory_requirement, app_state->input_recorder_state_ptr);
+    if(game_inst->config.input_replay_path){
+        if(!input_recorder_start_replay(game_inst->config.input_replay_path)){
+            return false;
+        }
+    }else if(game_inst->config.input_record_path){
+        //asked for a recording, running without one would lose the session it was meant to capture
+        if(!input_recorder_start_recording(game_inst->config.input_record_path)){
+            return false;
+        }
+    }
+
     //initialize events sub-system
     initialize_evnets_system(&app_state->event_system_memory_requirement, 0);
     app_state->event_system_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->event_system_memory_requirement);
     initialize_evnets_system(&app_state->event_system_memory_requirement, app_state->event_system_state_ptr);
 
+    //threads decompressing packed files and cached assets, the loading thread works with them
+    initialize_lz_workers(&app_state->lz_workers_memory_requirement, 0, 0);
+    app_state->lz_workers_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->lz_workers_memory_requirement);
+    if(!initialize_lz_workers(&app_state->lz_workers_memory_requirement, app_state->lz_workers_state_ptr, 3)){
+        PANCAKE_WARN("Decompression workers not available, files are decompressed on the loading thread.");
+    }
+
+    //async file I/O
+    initialize_async_io_system(&app_state->async_io_memory_requirement, 0);
+    app_state->async_io_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->async_io_memory_requirement);
+    if(!initialize_async_io_system(&app_state->async_io_memory_requirement, app_state->async_io_state_ptr)){
+        PANCAKE_ERROR("Failed to initialize async I/O system; shutting down.");
+        return false;
+    }
+
+    //cooked assets, cooked again only when their source changes
+    if(game_inst->config.derived_cache_directory){
+        initialize_derived_cache(&app_state->derived_cache_memory_requirement, 0, 0, 0);
+        app_state->derived_cache_state_ptr = linear_allocator_allocate(&app_state->systems_allocator, app_state->derived_cache_memory_requirement);
+        if(!initialize_derived_cache(&app_state->derived_cache_memory_requirement, app_state->derived_cache_state_ptr,
+            game_inst->config.derived_cache_directory, game_inst->config.derived_cache_size_limit)){
+            PANCAKE_WARN("Derived data cache not available, assets are cooked every time.");
+            app_state->derived_cache_state_ptr = 0;
+        }
+    }
 
     
     //listen for events...
@@ -109,6 +185,14 @@ b8 application_create(game* game_inst){
             game_inst->config.start_height)) {
         return false;
     }
+    if(game_inst->config.input_thread && !platform_input_thread_start()){
+        PANCAKE_WARN("Input thread not available, input is read once per frame.");
+    }
+
+    //assets come from the pack when there is one, loose files otherwise
+    if(game_inst->config.asset_pack_path && !filesystem_mount_pack(game_inst->config.asset_pack_path)){
+        PANCAKE_WARN("Could not mount '%s', loading loose asset files.", game_inst->config.asset_pack_path);
+    }
 
 
 
@@ -143,18 +227,34 @@ b8 application_run(){
     f64 target_frame_seconds = 1.0f / 60;
 
 
-    PANCAKE_INFO(get_memory_usage_str());
+    char* memory_usage = get_memory_usage_str();
+    PANCAKE_INFO("%s", memory_usage);
+    pancake_free(memory_usage, string_length(memory_usage) + 1, MEMORY_TAG_STRING);
     while(app_state->is_running){
         if(!platform_pump_messages()){
             app_state->is_running = false;
         }
 
+        //when replaying, the recorded input of this frame is fed in here
+        if(!input_recorder_frame_begin()){
+            PANCAKE_INFO("Input replay finished, shutting down.");
+            app_state->is_running = false;
+        }
+
+        // Everything posted while pumping (input and such) is handled here, before the game updates.
+        inputs_frame_prepare();
+        input_actions_update();
+        event_dispatch_pending();
+        // Reads/writes finished since the last frame.
+        async_io_update();
+
         if(!app_state->is_suspended){
 
             //update clock,and get delta_time
             clock_update(&app_state->clock);
             f64 current_time =app_state->clock.elapsed;
-            f64 delta = (current_time - app_state->last_time);
+            //replays give the game the recorded deltas, so it simulates the same frames
+            f64 delta = input_recorder_frame_delta(current_time - app_state->last_time);
             f64 frame_start_time = platform_get_absolute_time();
 
             if(!app_state->game_inst->Update(app_state->game_inst,(f32)delta)){
@@ -196,6 +296,7 @@ b8 application_run(){
             // As a safety, input is the last thing to be updated before
             // this frame ends.
             inputs_update(delta);
+            event_profiling_frame_end();
 
             app_state->last_time = current_time;
         }
@@ -208,10 +309,17 @@ b8 application_run(){
     unregister_event(EVENT_CODE_KEY_PRESSED,0,application_on_key);
     unregister_event(EVENT_CODE_KEY_RELEASED,0,application_on_key);
 
+    shutdown_derived_cache(&app_state->derived_cache_state_ptr);
+    shutdown_async_io_system(&app_state->async_io_state_ptr);
+    shutdown_lz_workers(&app_state->lz_workers_state_ptr);
     shutdown_events_system(&app_state->event_system_state_ptr);
+    shutdown_input_recorder(&app_state->input_recorder_state_ptr);
+    shutdown_input_actions_system(&app_state->input_actions_state_ptr);
     shutdown_inputs_system(&app_state->input_system_state_ptr);
     shutdown_renderer_system(&app_state->renderer_system_state_ptr);
+    filesystem_unmount_packs();
     platform_system_shutdown(&app_state->platform_system_state_ptr);
+    shutdown_string_id_system(&app_state->string_id_system_state_ptr);
     shutdown_memory_system(&app_state->memory_system_state_ptr);
     shutdown_logging_system(&app_state->logging_system_state_ptr);
 
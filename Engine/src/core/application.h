@@ -20,6 +20,24 @@ typedef struct ApplicationConfig{
 
     //application name used in windowing if applicable
     char* name;
+
+    //if set, all the input is recorded to this file (see input_recorder.h)
+    const char* input_record_path;
+
+    //if set, the input recorded in this file is played back instead of the live input,
+    //and the application quits once it is over
+    const char* input_replay_path;
+
+    //read input on a dedicated thread as it arrives, where the platform supports it
+    b8 input_thread;
+
+    //if set, this pack is mounted at startup and assets are loaded from it (see pack_file.h)
+    const char* asset_pack_path;
+
+    //if set, cooked assets are cached in this directory (see derived_cache.h)
+    const char* derived_cache_directory;
+    //the most bytes the derived data cache keeps on disk, 0 for the default
+    u64 derived_cache_size_limit;
 }ApplicationConfig;
 
 
@@ -0,0 +1,189 @@
+#include "async_io.h"
+#include "logger.h"
+#include "pancake_memory.h"
+#include "pancake_string.h"
+#include "containers/ring_queue.h"
+#include "platform/platform.h"
+#include "platform/filesystem.h"
+#include "platform/pancake_thread.h"
+
+typedef struct async_io_job{
+    u64 id;
+    async_io_request request;
+    char path[ASYNC_IO_MAX_PATH_LENGTH];
+} async_io_job;
+
+typedef struct async_io_done{
+    async_io_completion completion;
+    pfn_async_io_complete on_complete;
+} async_io_done;
+
+typedef struct async_io_state{
+    // Submitted by the main thread, taken by any worker.
+    ring_queue jobs;
+    // Pushed by the workers, drained by async_io_update.
+    ring_queue completions;
+    pancake_thread workers[ASYNC_IO_WORKER_COUNT];
+    u32 worker_count;
+    // Counts the jobs queued, plus one per worker to stop at shutdown; idle workers sleep on it.
+    pancake_semaphore wake;
+    b8 running;
+    u64 next_id;
+    u64 submitted;
+    u64 dispatched;
+} async_io_state;
+
+static async_io_state* state_ptr;
+
+static void async_io_execute(const async_io_job* job, async_io_completion* out){
+    const async_io_request* request = &job->request;
+    out->id = job->id;
+    out->operation = request->operation;
+    out->success = false;
+    out->bytes = 0;
+    out->buffer = request->buffer;
+    out->user_data = request->user_data;
+
+    file_handle file;
+    file_modes mode = request->operation == ASYNC_IO_READ ? FILE_MODE_READ : (FILE_MODE_WRITE | FILE_MODE_KEEP);
+    if(!filesystem_open(job->path, mode, true, &file)){
+        return;
+    }
+    if(filesystem_seek(&file, request->offset)){
+        if(request->operation == ASYNC_IO_READ){
+            out->success = filesystem_read(&file, request->size, request->buffer, &out->bytes);
+        }else{
+            out->success = filesystem_write(&file, request->size, request->buffer, &out->bytes);
+        }
+    }
+    filesystem_close(&file);
+}
+
+static u32 async_io_worker_run(void* params){
+    async_io_job job;
+    for(;;){
+        pancake_semaphore_wait(&state_ptr->wake);
+        // Every job is signalled once queued, so a wake with the queue empty is the signal to stop.
+        // The jobs queued before the stop are all taken first.
+        while(!ring_queue_pop(&state_ptr->jobs, &job)){
+            if(!__atomic_load_n(&state_ptr->running, __ATOMIC_ACQUIRE)){
+                return 0;
+            }
+            pancake_thread_yield();
+        }
+
+        async_io_done done;
+        done.on_complete = job.request.on_complete;
+        async_io_execute(&job, &done.completion);
+        // Never drop a completion, wait for the main thread to make room.
+        while(!ring_queue_push(&state_ptr->completions, &done)){
+            pancake_thread_yield();
+        }
+    }
+    return 0;
+}
+
+b8 initialize_async_io_system(u64* memory_requirement, void* state){
+    *memory_requirement = sizeof(async_io_state);
+    if(state == 0){
+        return true;
+    }
+    pancake_zero_memory(state, sizeof(async_io_state));
+    state_ptr = state;
+
+    state_ptr->next_id = 1;
+    // Destroying a queue that was never created does nothing, the state was zeroed.
+    if(!ring_queue_create(sizeof(async_io_job), ASYNC_IO_QUEUE_CAPACITY, &state_ptr->jobs)
+        || !ring_queue_create(sizeof(async_io_done), ASYNC_IO_QUEUE_CAPACITY, &state_ptr->completions)
+        || !pancake_semaphore_create(0, &state_ptr->wake)){
+        PANCAKE_ERROR("initialize_async_io_system - could not create the queues.");
+        ring_queue_destroy(&state_ptr->jobs);
+        ring_queue_destroy(&state_ptr->completions);
+        state_ptr = 0;
+        return false;
+    }
+
+    __atomic_store_n(&state_ptr->running, true, __ATOMIC_RELEASE);
+    for(u32 i = 0; i < ASYNC_IO_WORKER_COUNT; ++i){
+        if(!pancake_thread_create(async_io_worker_run, 0, &state_ptr->workers[state_ptr->worker_count])){
+            PANCAKE_ERROR("initialize_async_io_system - could not start worker %u.", i);
+            continue;
+        }
+        state_ptr->worker_count++;
+    }
+    if(state_ptr->worker_count == 0){
+        __atomic_store_n(&state_ptr->running, false, __ATOMIC_RELEASE);
+        pancake_semaphore_destroy(&state_ptr->wake);
+        ring_queue_destroy(&state_ptr->jobs);
+        ring_queue_destroy(&state_ptr->completions);
+        state_ptr = 0;
+        return false;
+    }
+    return true;
+}
+
+void shutdown_async_io_system(void* state){
+    if(!state_ptr){
+        return;
+    }
+    // The workers finish the queued jobs before exiting.
+    __atomic_store_n(&state_ptr->running, false, __ATOMIC_RELEASE);
+    pancake_semaphore_signal(&state_ptr->wake, state_ptr->worker_count);
+    while(state_ptr->dispatched < state_ptr->submitted){
+        if(async_io_update() == 0){
+            pancake_thread_yield();
+        }
+    }
+    for(u32 i = 0; i < state_ptr->worker_count; ++i){
+        pancake_thread_wait(&state_ptr->workers[i]);
+    }
+    pancake_semaphore_destroy(&state_ptr->wake);
+    ring_queue_destroy(&state_ptr->jobs);
+    ring_queue_destroy(&state_ptr->completions);
+    state_ptr = 0;
+}
+
+u64 async_io_submit(const async_io_request* request){
+    if(!state_ptr || !request || !request->path || (!request->buffer && request->size)){
+        return 0;
+    }
+    u64 path_length = string_length(request->path);
+    if(path_length >= ASYNC_IO_MAX_PATH_LENGTH){
+        PANCAKE_ERROR("async_io_submit - path too long: '%s'.", request->path);
+        return 0;
+    }
+
+    async_io_job job;
+    job.id = state_ptr->next_id;
+    job.request = *request;
+    pancake_copy_memory(job.path, request->path, path_length + 1);
+    job.request.path = 0;
+    if(!ring_queue_push(&state_ptr->jobs, &job)){
+        PANCAKE_WARN("async_io_submit - %d requests already in flight.", ASYNC_IO_QUEUE_CAPACITY);
+        return 0;
+    }
+    pancake_semaphore_signal(&state_ptr->wake, 1);
+    state_ptr->next_id++;
+    state_ptr->submitted++;
+    return job.id;
+}
+
+u32 async_io_update(){
+    if(!state_ptr){
+        return 0;
+    }
+    u32 count = 0;
+    async_io_done done;
+    while(ring_queue_pop(&state_ptr->completions, &done)){
+        state_ptr->dispatched++;
+        count++;
+        if(done.on_complete){
+            done.on_complete(&done.completion);
+        }
+    }
+    return count;
+}
+
+u64 async_io_pending_count(){
+    return state_ptr ? state_ptr->submitted - state_ptr->dispatched : 0;
+}
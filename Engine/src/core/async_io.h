@@ -0,0 +1,80 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    Reads and writes files on worker threads so the frame loop never waits on the disk.
+
+    A request names a range of a file (path, offset, size) and caller memory to read it into or
+    write it from. The workers push the result of each request to a completion queue, which
+    async_io_update drains once per frame on the main thread, calling the request's on_complete.
+    The caller's memory must stay valid, and untouched, until then.
+    Requests are submitted from the main thread.
+*/
+
+#define ASYNC_IO_WORKER_COUNT 2
+#define ASYNC_IO_QUEUE_CAPACITY 256
+#define ASYNC_IO_MAX_PATH_LENGTH 256
+
+typedef enum async_io_operation{
+    ASYNC_IO_READ,
+    ASYNC_IO_WRITE
+} async_io_operation;
+
+typedef struct async_io_completion{
+    // The id async_io_submit returned for the request.
+    u64 id;
+    async_io_operation operation;
+    // True if the whole range was read/written.
+    b8 success;
+    // The number of bytes actually read/written, less than asked when reading past the end of the file.
+    u64 bytes;
+    void* buffer;
+    void* user_data;
+} async_io_completion;
+
+// Called on the main thread, from async_io_update.
+typedef void (*pfn_async_io_complete)(const async_io_completion* completion);
+
+typedef struct async_io_request{
+    async_io_operation operation;
+    // Copied, doesn't need to outlive the call.
+    const char* path;
+    u64 offset;
+    u64 size;
+    // Read into or written from, owned by the caller.
+    void* buffer;
+    // Optional.
+    pfn_async_io_complete on_complete;
+    void* user_data;
+} async_io_request;
+
+/**
+ * @brief Initializes the async I/O system and starts its workers. Call twice; once with state = 0 to
+ * get required memory size, then a second time passing allocated memory to state.
+ *
+ * @param memory_requirement A pointer to hold the required memory size of internal state.
+ * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ * @return b8 True on success; otherwise false.
+ */
+b8 initialize_async_io_system(u64* memory_requirement, void* state);
+
+// Finishes the requests already submitted, dispatches their completions and stops the workers.
+void shutdown_async_io_system(void* state);
+
+/**
+ * Queues a request for the workers.
+ * @param request The request, copied.
+ * @returns The id of the request, or 0 if it couldn't be queued (too many in flight, path too long).
+ */
+PANCAKE_API u64 async_io_submit(const async_io_request* request);
+
+/**
+ * Calls on_complete for every request finished since the last call. Called once per frame by the
+ * application, can also be called to wait on a request.
+ * @returns The number of completions dispatched.
+ */
+PANCAKE_API u32 async_io_update();
+
+// The number of requests submitted and not dispatched yet.
+PANCAKE_API u64 async_io_pending_count();
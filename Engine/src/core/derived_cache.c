@@ -0,0 +1,520 @@
+#include "derived_cache.h"
+#include "logger.h"
+#include "pancake_memory.h"
+#include "pancake_string.h"
+#include "containers/list.h"
+#include "platform/lz.h"
+#include "platform/pack_file.h"
+
+STATIC_ASSERT(sizeof(derived_cache_file_header) == 24, "derived_cache_file_header is written to files as is");
+
+#define DERIVED_CACHE_INDEX_MAGIC 0x49444B50 // "PKDI"
+#define DERIVED_CACHE_INDEX_NAME "index.ddc"
+// Entries of at least this many lz blocks are decompressed on more than one thread.
+#define DERIVED_CACHE_PARALLEL_BLOCKS 8
+#define DERIVED_CACHE_DECOMPRESS_THREADS 4
+
+#define HASH_PRIME_1 11400714785074694791ull
+#define HASH_PRIME_2 14029467366897019727ull
+#define HASH_PRIME_3 1609587929392839161ull
+#define HASH_PRIME_4 9650029242287828579ull
+#define HASH_PRIME_5 2870177450012600261ull
+
+typedef struct derived_cache_entry{
+    derived_cache_key key;
+    // On disk, header included.
+    u64 stored_size;
+    // The clock when last put or got, the lowest is evicted first.
+    u64 last_used;
+} derived_cache_entry;
+
+// The index file: this header, then the entries.
+typedef struct derived_cache_index_header{
+    u32 magic;
+    u32 version;
+    u64 entry_count;
+    u64 clock;
+} derived_cache_index_header;
+
+typedef struct derived_cache_state{
+    char directory[DERIVED_CACHE_MAX_PATH_LENGTH];
+    u64 size_limit;
+    u64 total_size;
+    u64 clock;
+    // list of derived_cache_entry
+    derived_cache_entry* entries;
+    // The index changed since it was written.
+    b8 dirty;
+} derived_cache_state;
+
+static derived_cache_state* state_ptr;
+
+static PANCAKE_INLINE u64 hash_read64(const u8* p) {
+    u64 value;
+    pancake_copy_memory(&value, p, sizeof(value));
+    return value;
+}
+
+static PANCAKE_INLINE u64 hash_rotate(u64 value, u32 bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static PANCAKE_INLINE u64 hash_round(u64 accumulator, u64 input) {
+    accumulator += input * HASH_PRIME_2;
+    return hash_rotate(accumulator, 31) * HASH_PRIME_1;
+}
+
+static PANCAKE_INLINE u64 hash_merge(u64 hash, u64 accumulator) {
+    hash ^= hash_round(0, accumulator);
+    return hash * HASH_PRIME_1 + HASH_PRIME_4;
+}
+
+u64 derived_cache_hash(const void* data, u64 size, u64 seed) {
+    const u8* p = data;
+    const u8* end = p + size;
+    u64 hash;
+
+    if (size >= 32) {
+        // Four independent lanes, so the rounds overlap in the CPU.
+        u64 v1 = seed + HASH_PRIME_1 + HASH_PRIME_2;
+        u64 v2 = seed + HASH_PRIME_2;
+        u64 v3 = seed;
+        u64 v4 = seed - HASH_PRIME_1;
+        do {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        hash = hash_rotate(v1, 1) + hash_rotate(v2, 7) + hash_rotate(v3, 12) + hash_rotate(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + HASH_PRIME_5;
+    }
+    hash += size;
+
+    for (; end - p >= 8; p += 8) {
+        hash ^= hash_round(0, hash_read64(p));
+        hash = hash_rotate(hash, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+    }
+    if (end - p >= 4) {
+        u32 word;
+        pancake_copy_memory(&word, p, sizeof(word));
+        hash ^= word * HASH_PRIME_1;
+        hash = hash_rotate(hash, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * HASH_PRIME_5;
+        hash = hash_rotate(hash, 11) * HASH_PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static void derived_cache_path(const char* name, char* out_path) {
+    string_format(out_path, "%s/%s", state_ptr->directory, name);
+}
+
+static void derived_cache_entry_path(derived_cache_key key, const char* extension, char* out_path) {
+    string_format(out_path, "%s/%016llx.%s", state_ptr->directory, key, extension);
+}
+
+static i64 derived_cache_find(derived_cache_key key) {
+    u64 count = list_length(state_ptr->entries);
+    for (u64 i = 0; i < count; ++i) {
+        if (state_ptr->entries[i].key == key) {
+            return (i64)i;
+        }
+    }
+    return -1;
+}
+
+// Deletes an entry and its file. The order of the entries doesn't matter, the last one takes its place.
+static void derived_cache_remove(u64 index) {
+    derived_cache_entry* entry = &state_ptr->entries[index];
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_entry_path(entry->key, "ddc", path);
+    filesystem_delete(path);
+
+    state_ptr->total_size -= entry->stored_size;
+    u64 last = list_length(state_ptr->entries) - 1;
+    state_ptr->entries[index] = state_ptr->entries[last];
+    list_length_set(state_ptr->entries, last);
+    state_ptr->dirty = true;
+}
+
+// Evicts the least recently used entries until the cache fits its size limit.
+static void derived_cache_trim() {
+    while (state_ptr->total_size > state_ptr->size_limit) {
+        u64 count = list_length(state_ptr->entries);
+        u64 oldest = 0;
+        for (u64 i = 1; i < count; ++i) {
+            if (state_ptr->entries[i].last_used < state_ptr->entries[oldest].last_used) {
+                oldest = i;
+            }
+        }
+        derived_cache_remove(oldest);
+    }
+}
+
+static void derived_cache_load_index() {
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_path(DERIVED_CACHE_INDEX_NAME, path);
+    if (!filesystem_exists(path)) {
+        return;
+    }
+    file_view view;
+    if (!filesystem_map(path, FILE_MAP_HINT_SEQUENTIAL, &view)) {
+        return;
+    }
+
+    derived_cache_index_header header = {0};
+    if (view.size >= sizeof(header)) {
+        pancake_copy_memory(&header, view.data, sizeof(header));
+    }
+    if (header.magic != DERIVED_CACHE_INDEX_MAGIC || header.version != DERIVED_CACHE_VERSION
+        || header.entry_count != (view.size - sizeof(header)) / sizeof(derived_cache_entry)) {
+        // The entries are taken in again by derived_cache_scan_directory, as the least recently used.
+        PANCAKE_WARN("derived_cache - '%s' is not a valid index, rebuilding it.", path);
+        filesystem_unmap(&view);
+        return;
+    }
+
+    for (u64 i = 0; i < header.entry_count; ++i) {
+        derived_cache_entry entry;
+        pancake_copy_memory(&entry, view.data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+        list_push(state_ptr->entries, entry);
+        state_ptr->total_size += entry.stored_size;
+    }
+    state_ptr->clock = header.clock;
+    filesystem_unmap(&view);
+}
+
+// Reads the key out of an entry's file name, "<key in 16 hex digits>.<extension>".
+static b8 derived_cache_parse_name(const char* name, derived_cache_key* out_key, const char** out_extension) {
+    derived_cache_key key = 0;
+    for (u32 i = 0; i < 16; ++i) {
+        char c = name[i];
+        if (c >= '0' && c <= '9') {
+            key = (key << 4) | (u64)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            key = (key << 4) | (u64)(c - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+    if (name[16] != '.') {
+        return false;
+    }
+    *out_key = key;
+    *out_extension = name + 17;
+    return true;
+}
+
+// Takes in an entry the index doesn't know, put after the index was last written, as the least recently used.
+static b8 derived_cache_adopt(derived_cache_key key, const char* path) {
+    file_view view;
+    if (!filesystem_map(path, FILE_MAP_HINT_RANDOM, &view)) {
+        return false;
+    }
+    derived_cache_file_header header = {0};
+    if (view.size >= sizeof(header)) {
+        pancake_copy_memory(&header, view.data, sizeof(header));
+    }
+    u64 stored_size = view.size;
+    filesystem_unmap(&view);
+    if (header.magic != DERIVED_CACHE_MAGIC || header.version != DERIVED_CACHE_VERSION || header.key != key) {
+        return false;
+    }
+
+    derived_cache_entry entry = {0};
+    entry.key = key;
+    entry.stored_size = stored_size;
+    list_push(state_ptr->entries, entry);
+    state_ptr->total_size += stored_size;
+    state_ptr->dirty = true;
+    return true;
+}
+
+typedef struct derived_cache_scan{
+    // One per entry of the index, set once its file is seen.
+    b8* found;
+    u64 indexed_count;
+    u64 adopted_count;
+    u64 deleted_count;
+} derived_cache_scan;
+
+static void derived_cache_scan_file(const char* name, b8 is_directory, void* user_data) {
+    derived_cache_scan* scan = user_data;
+    derived_cache_key key;
+    const char* extension;
+    if (is_directory || !derived_cache_parse_name(name, &key, &extension)) {
+        // Not an entry, the index among them.
+        return;
+    }
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_path(name, path);
+    if (strings_equal(extension, "ddc")) {
+        i64 index = derived_cache_find(key);
+        if (index >= 0 && (u64)index < scan->indexed_count) {
+            scan->found[index] = true;
+            return;
+        }
+        if (derived_cache_adopt(key, path)) {
+            scan->adopted_count++;
+            return;
+        }
+    } else if (!strings_equal(extension, "tmp")) {
+        return;
+    }
+    // Left by a put that never finished, or not an entry after all.
+    filesystem_delete(path);
+    scan->deleted_count++;
+}
+
+// Matches the index with the directory: entries written since the index was (the process died
+// before shutdown) are taken in, leftovers are deleted, and entries whose file is gone dropped.
+// Without this they would never be counted against the size limit, nor evicted.
+static void derived_cache_scan_directory() {
+    derived_cache_scan scan = {0};
+    scan.indexed_count = list_length(state_ptr->entries);
+    if (scan.indexed_count) {
+        scan.found = pancake_allocate(scan.indexed_count * sizeof(b8), MEMORY_TAG_ARRAY);
+    }
+    if (!filesystem_list_directory(state_ptr->directory, derived_cache_scan_file, &scan)) {
+        PANCAKE_WARN("derived_cache - could not list '%s', trusting the index.", state_ptr->directory);
+    } else {
+        // From the end, so the entries moved by the removals were already looked at.
+        u64 dropped_count = 0;
+        for (u64 i = scan.indexed_count; i-- > 0;) {
+            if (!scan.found[i]) {
+                derived_cache_remove(i);
+                dropped_count++;
+            }
+        }
+        if (scan.adopted_count || scan.deleted_count || dropped_count) {
+            PANCAKE_INFO("Derived data cache: %llu entries missing from the index taken in, %llu leftover files deleted, %llu missing entries dropped.",
+                scan.adopted_count, scan.deleted_count, dropped_count);
+        }
+    }
+    if (scan.found) {
+        pancake_free(scan.found, scan.indexed_count * sizeof(b8), MEMORY_TAG_ARRAY);
+    }
+    derived_cache_trim();
+}
+
+b8 initialize_derived_cache(u64* memory_requirement, void* state, const char* directory, u64 size_limit) {
+    *memory_requirement = sizeof(derived_cache_state);
+    if (state == 0) {
+        return true;
+    }
+    pancake_zero_memory(state, sizeof(derived_cache_state));
+
+    if (string_length(directory) >= DERIVED_CACHE_MAX_PATH_LENGTH) {
+        PANCAKE_ERROR("initialize_derived_cache - the directory path is longer than %d characters.", DERIVED_CACHE_MAX_PATH_LENGTH - 1);
+        return false;
+    }
+    if (!filesystem_create_directory(directory)) {
+        PANCAKE_ERROR("initialize_derived_cache - could not create the directory '%s'.", directory);
+        return false;
+    }
+
+    state_ptr = state;
+    pancake_copy_memory(state_ptr->directory, directory, string_length(directory) + 1);
+    state_ptr->size_limit = size_limit ? size_limit : DERIVED_CACHE_DEFAULT_SIZE_LIMIT;
+    state_ptr->entries = list_create(derived_cache_entry);
+    derived_cache_load_index();
+    derived_cache_scan_directory();
+    PANCAKE_INFO("Derived data cache '%s': %llu entries, %llu bytes.", directory, list_length(state_ptr->entries), state_ptr->total_size);
+    return true;
+}
+
+void shutdown_derived_cache(void* state) {
+    if (state_ptr) {
+        derived_cache_flush();
+        list_destroy(state_ptr->entries);
+    }
+    state_ptr = 0;
+}
+
+b8 derived_cache_make_key_from_file(const char* path, const void* settings, u64 settings_size, derived_cache_key* out_key) {
+    file_view view;
+    if (!filesystem_load(path, FILE_MAP_HINT_SEQUENTIAL, &view)) {
+        return false;
+    }
+    *out_key = derived_cache_make_key(view.data, view.size, settings, settings_size);
+    filesystem_unmap(&view);
+    return true;
+}
+
+b8 derived_cache_get(derived_cache_key key, file_view* out_view) {
+    pancake_zero_memory(out_view, sizeof(file_view));
+    if (!state_ptr) return false;
+
+    i64 index = derived_cache_find(key);
+    if (index < 0) {
+        return false;
+    }
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_entry_path(key, "ddc", path);
+    file_view view;
+    if (!filesystem_map(path, FILE_MAP_HINT_SEQUENTIAL, &view)) {
+        derived_cache_remove(index);
+        return false;
+    }
+
+    derived_cache_file_header header = {0};
+    const u8* data = 0;
+    u64 stored_size = 0;
+    if (view.size >= sizeof(header)) {
+        pancake_copy_memory(&header, view.data, sizeof(header));
+        data = view.data + sizeof(header);
+        stored_size = view.size - sizeof(header);
+    }
+    b8 valid = header.magic == DERIVED_CACHE_MAGIC && header.version == DERIVED_CACHE_VERSION && header.key == key;
+
+    if (valid && header.compression == PACK_COMPRESSION_NONE && stored_size == header.size) {
+        // Straight from the mapping, filesystem_unmap releases it.
+        *out_view = view;
+        out_view->data = data;
+        out_view->size = header.size;
+    } else if (valid && header.compression == PACK_COMPRESSION_LZ) {
+        lz_frame_info info;
+        valid = lz_frame_get_info(data, stored_size, &info) && info.size == header.size;
+        if (valid) {
+            u8* decompressed = pancake_allocate(header.size, MEMORY_TAG_STRING);
+            u32 threads = info.block_count >= DERIVED_CACHE_PARALLEL_BLOCKS ? DERIVED_CACHE_DECOMPRESS_THREADS : 1;
+            valid = lz_frame_decompress(data, stored_size, decompressed, header.size, threads);
+            if (valid) {
+                out_view->data = decompressed;
+                out_view->size = header.size;
+                out_view->owned_data = decompressed;
+            } else {
+                pancake_free(decompressed, header.size, MEMORY_TAG_STRING);
+            }
+        }
+        filesystem_unmap(&view);
+    } else {
+        valid = false;
+        filesystem_unmap(&view);
+    }
+
+    if (!valid) {
+        PANCAKE_WARN("derived_cache - '%s' is corrupted, dropping it.", path);
+        derived_cache_remove(index);
+        return false;
+    }
+    state_ptr->entries[index].last_used = ++state_ptr->clock;
+    state_ptr->dirty = true;
+    return true;
+}
+
+b8 derived_cache_put(derived_cache_key key, const void* data, u64 size) {
+    if (!state_ptr) return false;
+
+    if (size + sizeof(derived_cache_file_header) > state_ptr->size_limit) {
+        PANCAKE_WARN("derived_cache_put - %llu bytes is more than the whole cache holds.", size);
+        return false;
+    }
+
+    u64 capacity = lz_frame_bound(size, 0);
+    u8* frame = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u64 frame_size = lz_frame_compress(data, size, 0, frame, capacity);
+
+    derived_cache_file_header header = {0};
+    header.magic = DERIVED_CACHE_MAGIC;
+    header.version = DERIVED_CACHE_VERSION;
+    header.key = key;
+    header.size = size;
+    const void* stored = data;
+    u64 stored_size = size;
+    if (frame_size && frame_size < size) {
+        header.compression = PACK_COMPRESSION_LZ;
+        stored = frame;
+        stored_size = frame_size;
+    }
+
+    // Written aside then renamed, so a crash never leaves half an entry under its name.
+    char temporary_path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_entry_path(key, "tmp", temporary_path);
+    derived_cache_entry_path(key, "ddc", path);
+    file_handle file;
+    b8 result = filesystem_open(temporary_path, FILE_MODE_WRITE, true, &file);
+    if (result) {
+        u64 written = 0;
+        result = filesystem_write(&file, sizeof(header), &header, &written)
+            && (stored_size == 0 || filesystem_write(&file, stored_size, stored, &written));
+        filesystem_close(&file);
+        result = result && filesystem_rename(temporary_path, path);
+    }
+    pancake_free(frame, capacity, MEMORY_TAG_STRING);
+    if (!result) {
+        PANCAKE_ERROR("derived_cache_put - failed to write '%s'.", path);
+        filesystem_delete(temporary_path);
+        return false;
+    }
+
+    i64 index = derived_cache_find(key);
+    if (index < 0) {
+        derived_cache_entry entry = {0};
+        entry.key = key;
+        list_push(state_ptr->entries, entry);
+        index = (i64)list_length(state_ptr->entries) - 1;
+    }
+    derived_cache_entry* entry = &state_ptr->entries[index];
+    state_ptr->total_size += sizeof(header) + stored_size - entry->stored_size;
+    entry->stored_size = sizeof(header) + stored_size;
+    entry->last_used = ++state_ptr->clock;
+    state_ptr->dirty = true;
+
+    // The entry just put is the most recently used, it is never the one evicted.
+    derived_cache_trim();
+    return true;
+}
+
+u64 derived_cache_size() {
+    return state_ptr ? state_ptr->total_size : 0;
+}
+
+b8 derived_cache_flush() {
+    if (!state_ptr) return false;
+    if (!state_ptr->dirty) return true;
+
+    derived_cache_index_header header = {0};
+    header.magic = DERIVED_CACHE_INDEX_MAGIC;
+    header.version = DERIVED_CACHE_VERSION;
+    header.entry_count = list_length(state_ptr->entries);
+    header.clock = state_ptr->clock;
+
+    char temporary_path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    char path[DERIVED_CACHE_MAX_PATH_LENGTH + 32];
+    derived_cache_path("index.tmp", temporary_path);
+    derived_cache_path(DERIVED_CACHE_INDEX_NAME, path);
+    file_handle file;
+    if (!filesystem_open(temporary_path, FILE_MODE_WRITE, true, &file)) {
+        PANCAKE_ERROR("derived_cache_flush - could not create '%s'.", temporary_path);
+        return false;
+    }
+    u64 written = 0;
+    b8 result = filesystem_write(&file, sizeof(header), &header, &written)
+        && (header.entry_count == 0 || filesystem_write(&file, header.entry_count * sizeof(derived_cache_entry), state_ptr->entries, &written));
+    filesystem_close(&file);
+    result = result && filesystem_rename(temporary_path, path);
+    if (!result) {
+        PANCAKE_ERROR("derived_cache_flush - failed to write '%s'.", path);
+        return false;
+    }
+    state_ptr->dirty = false;
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "defines.h"
+#include "platform/filesystem.h"
+
+/*
+    Keeps what is derived from source assets (compiled pipelines, optimized meshes, compressed
+    textures...) on disk, so it is only cooked again when its inputs change.
+
+    Entries are keyed by a hash of the source's content and of the settings it is cooked with
+    (include the version of the cooking code in the settings, so changing it misses too).
+    Each entry is a file in the cache directory, compressed with lz when that makes it smaller.
+    An index of the entries, in least recently used order, is kept in memory and written to the
+    directory at shutdown; past the size limit the least recently used entries are deleted. At
+    initialization the index is matched with the directory, so entries put after it was last
+    written (or all of them, if it is lost) still count and get evicted.
+    Used from the main thread.
+
+    Entry file layout (little endian)
+    derived_cache_file_header
+    the data, as is or as an lz frame (see lz.h)
+*/
+
+#define DERIVED_CACHE_MAGIC 0x43444B50 // "PKDC"
+#define DERIVED_CACHE_VERSION 1
+#define DERIVED_CACHE_DEFAULT_SIZE_LIMIT (256ull * 1024 * 1024)
+#define DERIVED_CACHE_MAX_PATH_LENGTH 256
+
+typedef u64 derived_cache_key;
+
+typedef struct derived_cache_file_header{
+    u32 magic;
+    u16 version;
+    // A pack_compression.
+    u16 compression;
+    derived_cache_key key;
+    // Once decompressed.
+    u64 size;
+} derived_cache_file_header;
+
+/**
+ * @brief Initializes the derived data cache. Call twice; once with state = 0 to get required memory size,
+ * then a second time passing allocated memory to state.
+ *
+ * @param memory_requirement A pointer to hold the required memory size of internal state.
+ * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ * @param directory The cache directory, created if missing (its parent must exist).
+ * @param size_limit The most bytes the entries may take on disk, 0 for DERIVED_CACHE_DEFAULT_SIZE_LIMIT.
+ * @returns True if the directory could be used; otherwise false.
+ */
+PANCAKE_API b8 initialize_derived_cache(u64* memory_requirement, void* state, const char* directory, u64 size_limit);
+
+// Writes the index, then releases the cache.
+PANCAKE_API void shutdown_derived_cache(void* state);
+
+/**
+ * A fast 64 bit hash of data (xxHash64), reading 32 bytes per round.
+ * @param seed Chains hashes: pass the hash of what came before, or 0.
+ */
+PANCAKE_API u64 derived_cache_hash(const void* data, u64 size, u64 seed);
+
+// The key of what source cooks into with settings.
+PANCAKE_INLINE derived_cache_key derived_cache_make_key(const void* source, u64 source_size, const void* settings, u64 settings_size) {
+    return derived_cache_hash(settings, settings_size, derived_cache_hash(source, source_size, 0));
+}
+
+/**
+ * The key of the file at path (see filesystem_load) cooked with settings.
+ * @returns True if the file could be read; otherwise false.
+ */
+PANCAKE_API b8 derived_cache_make_key_from_file(const char* path, const void* settings, u64 settings_size, derived_cache_key* out_key);
+
+/**
+ * Looks an entry up, marking it as the most recently used.
+ * @param out_view A pointer to hold the entry's data, release it with filesystem_unmap.
+ * @returns True if the cache holds the key; otherwise false, and the data should be cooked and put.
+ */
+PANCAKE_API b8 derived_cache_get(derived_cache_key key, file_view* out_view);
+
+/**
+ * Stores an entry, replacing the one with the same key, then evicts the least recently used
+ * entries until the cache fits its size limit.
+ * @returns True if the entry was written; otherwise false.
+ */
+PANCAKE_API b8 derived_cache_put(derived_cache_key key, const void* data, u64 size);
+
+// The bytes the entries take on disk.
+PANCAKE_API u64 derived_cache_size();
+
+// Writes the index to the cache directory.
+PANCAKE_API b8 derived_cache_flush();
@@ -1,23 +1,88 @@
 #include "event.h"
 #include "pancake_memory.h"
 #include "containers/list.h"
+#include "containers/ring_queue.h"
+#include "memory/linear_allocator.h"
+#include "string_builder.h"
+#include "logger.h"
+#include "platform/platform.h"
+#include "platform/filesystem.h"
 
 typedef struct registered_event {
     void* listener;
     on_event_fnp callback;
+    //listeners are kept sorted by descending priority
+    i32 priority;
+#if PANCAKE_EVENT_PROFILING
+    //index of this handler's entry in profiles
+    u32 profile_index;
+#endif
 } registered_event;
 
 typedef struct event_code_entry{
+    u16 code;
     registered_event* events;
 }event_code_entry;
 
+typedef struct queued_event {
+    u16 code;
+    void* sender;
+    event_context context;
+} queued_event;
+
+#if PANCAKE_EVENT_PROFILING
+typedef struct event_handler_profile {
+    //what is reported; the frame/window fields are refreshed by event_profiling_frame_end
+    event_handler_stats stats;
+    //accumulated during the frame in progress
+    u32 current_calls;
+    u32 current_handled;
+    f64 current_time;
+    //time spent per frame over the last EVENT_PROFILING_WINDOW frames
+    f64 window[EVENT_PROFILING_WINDOW];
+} event_handler_profile;
+#endif
+
 //this should be more than enugh codes
 #define MAX_MESSAGE_CODES 16384
 
+//the most events other threads can have waiting before event_inbox_post starts failing
+#define EVENT_INBOX_CAPACITY 4096
+
+//size of each of the two payload arenas, i.e. the most payload bytes one frame can post
+#define EVENT_PAYLOAD_ARENA_SIZE (256 * 1024)
+
+//codes are looked up through pages of EVENT_CODE_PAGE_SIZE slots, a page only exists once one of its codes is registered
+#define EVENT_CODE_PAGE_SIZE 256
+#define EVENT_CODE_PAGE_COUNT (MAX_MESSAGE_CODES / EVENT_CODE_PAGE_SIZE)
+
 //state structure
 typedef struct event_system_state{
-    //lookup table for event codes
-    event_code_entry registered[MAX_MESSAGE_CODES];
+    //lookup table for event codes: per page, the index + 1 of each code's entry in active (0 = none)
+    u16* code_pages[EVENT_CODE_PAGE_COUNT];
+    //dense array of the codes that have been registered, with their listeners
+    event_code_entry* active;
+
+    //posted events, double buffered so that posting while dispatching lands in the next batch
+    queued_event* queues[2];
+    //payloads of the events in the matching queue, reset once that queue is dispatched
+    linear_allocator payload_arenas[2];
+    u8 write_queue;
+    //scratch space used to sort a batch by code
+    queued_event* sort_scratch;
+
+    //events posted from other threads, moved into the queue by event_dispatch_pending
+    ring_queue inbox;
+
+#if PANCAKE_EVENT_PROFILING
+    b8 profiling_enabled;
+    //one per code/listener/callback ever registered, kept after unregistering so it can still be reported
+    event_handler_profile* profiles;
+    //copy of each profile's stats handed out by event_profiling_get_stats
+    event_handler_stats* stats_snapshot;
+    u32 window_cursor;
+    u32 window_filled;
+#endif
 }event_system_state;
 
 static event_system_state* state_ptr;
@@ -27,37 +92,122 @@ void initialize_evnets_system(u64* memory_requirement, void* state){
     if(state == 0){
         return;
     }
-    pancake_zero_memory(state,sizeof(state));
+    pancake_zero_memory(state,sizeof(event_system_state));
     state_ptr = state;
+
+    state_ptr->active = list_create(event_code_entry);
+    state_ptr->queues[0] = list_create(queued_event);
+    state_ptr->queues[1] = list_create(queued_event);
+    linear_allocator_create(EVENT_PAYLOAD_ARENA_SIZE, 0, &state_ptr->payload_arenas[0]);
+    linear_allocator_create(EVENT_PAYLOAD_ARENA_SIZE, 0, &state_ptr->payload_arenas[1]);
+    state_ptr->write_queue = 0;
+    state_ptr->sort_scratch = list_create(queued_event);
+    ring_queue_create(sizeof(queued_event), EVENT_INBOX_CAPACITY, &state_ptr->inbox);
+
+#if PANCAKE_EVENT_PROFILING
+    state_ptr->profiles = list_create(event_handler_profile);
+    state_ptr->stats_snapshot = list_create(event_handler_stats);
+#endif
 }
 
 void shutdown_events_system(void* state){
     if(state_ptr){
         //free the events arrays, the objects pointed at should be destroyed on there own
-        for(u64 i=0; i < MAX_MESSAGE_CODES; ++i){
-            if(state_ptr->registered[i].events != 0){
-                list_destroy(state_ptr->registered[i].events);
-                state_ptr->registered[i].events = 0;
+        u64 active_count = list_length(state_ptr->active);
+        for(u64 i=0; i < active_count; ++i){
+            list_destroy(state_ptr->active[i].events);
+        }
+        list_destroy(state_ptr->active);
+        state_ptr->active = 0;
+
+        for(u32 i=0; i < EVENT_CODE_PAGE_COUNT; ++i){
+            if(state_ptr->code_pages[i]){
+                pancake_free(state_ptr->code_pages[i], sizeof(u16) * EVENT_CODE_PAGE_SIZE, MEMORY_TAG_DICT);
+                state_ptr->code_pages[i] = 0;
             }
         }
+
+        //anything still queued is dropped
+        list_destroy(state_ptr->queues[0]);
+        list_destroy(state_ptr->queues[1]);
+        linear_allocator_destroy(&state_ptr->payload_arenas[0]);
+        linear_allocator_destroy(&state_ptr->payload_arenas[1]);
+        list_destroy(state_ptr->sort_scratch);
+        ring_queue_destroy(&state_ptr->inbox);
+
+#if PANCAKE_EVENT_PROFILING
+        list_destroy(state_ptr->profiles);
+        list_destroy(state_ptr->stats_snapshot);
+#endif
     }
     state_ptr = 0;
 }
 
+//returns the index + 1 of the given code's entry in active, or 0 if nothing was ever registered for it
+static u16 find_code_slot(u16 code){
+    if(code >= MAX_MESSAGE_CODES){
+        return 0;
+    }
+    u16* page = state_ptr->code_pages[code / EVENT_CODE_PAGE_SIZE];
+    return page ? page[code % EVENT_CODE_PAGE_SIZE] : 0;
+}
+
+static event_code_entry* find_code_entry(u16 code){
+    u16 slot = find_code_slot(code);
+    return slot ? &state_ptr->active[slot - 1] : 0;
+}
+
+#if PANCAKE_EVENT_PROFILING
+//returns the profile index of the given handler, creating the profile the first time it is registered
+static u32 acquire_handler_profile(u16 code, void* listener, on_event_fnp on_event){
+    u64 profile_count = list_length(state_ptr->profiles);
+    for(u64 i=0; i < profile_count; ++i){
+        event_handler_stats* stats = &state_ptr->profiles[i].stats;
+        if(stats->code == code && stats->listener == listener && stats->callback == on_event){
+            return (u32)i;
+        }
+    }
+
+    event_handler_profile profile;
+    pancake_zero_memory(&profile, sizeof(event_handler_profile));
+    profile.stats.code = code;
+    profile.stats.listener = listener;
+    profile.stats.callback = on_event;
+    list_push(state_ptr->profiles, profile);
+    return (u32)profile_count;
+}
+#endif
+
 b8 register_event(u16 code, void* listener, on_event_fnp on_event){
-    if(!state_ptr){
+    return register_event_priority(code, listener, on_event, EVENT_PRIORITY_DEFAULT);
+}
+
+b8 register_event_priority(u16 code, void* listener, on_event_fnp on_event, i32 priority){
+    if(!state_ptr || code >= MAX_MESSAGE_CODES){
          return false;
     }
 
-    //create our events list if it is null
-    if(state_ptr->registered[code].events == 0){
-        state_ptr->registered[code].events = list_create(registered_event);
+    //create the entry for this code if it does not exist yet
+    event_code_entry* entry = find_code_entry(code);
+    if(!entry){
+        u16** page = &state_ptr->code_pages[code / EVENT_CODE_PAGE_SIZE];
+        if(*page == 0){
+            *page = pancake_allocate(sizeof(u16) * EVENT_CODE_PAGE_SIZE, MEMORY_TAG_DICT);
+        }
+
+        event_code_entry new_entry;
+        new_entry.code = code;
+        new_entry.events = list_create(registered_event);
+        list_push(state_ptr->active, new_entry);
+        u64 active_count = list_length(state_ptr->active);
+        (*page)[code % EVENT_CODE_PAGE_SIZE] = (u16)active_count;
+        entry = &state_ptr->active[active_count - 1];
     }
 
     // Check for duplication
-    u64 registered_count = list_length(state_ptr->registered[code].events);
+    u64 registered_count = list_length(entry->events);
     for(u64 i=0; i < registered_count; ++i){
-        if(state_ptr->registered[code].events[i].listener == listener){
+        if(entry->events[i].listener == listener){
             //TODO: WARN
             return false;
         }
@@ -68,7 +218,19 @@ b8 register_event(u16 code, void* listener, on_event_fnp on_event){
     registered_event event;
     event.listener = listener;
     event.callback = on_event;
-    list_push(state_ptr->registered[code].events, event);
+    event.priority = priority;
+#if PANCAKE_EVENT_PROFILING
+    event.profile_index = acquire_handler_profile(code, listener, on_event);
+#endif
+    list_push(entry->events, event);
+
+    //move it up past lower priorities, so dispatch only walks the list in order.
+    //listeners of equal priority stay in registration order
+    for(u64 i = registered_count; i > 0 && entry->events[i - 1].priority < priority; --i){
+        registered_event lower = entry->events[i - 1];
+        entry->events[i - 1] = entry->events[i];
+        entry->events[i] = lower;
+    }
 
     return true;
 }
@@ -79,19 +241,21 @@ b8 unregister_event(u16 code, void* listener, on_event_fnp on_event){
     }
 
     // On nothing is registered for the code, boot out.
-    if(state_ptr->registered[code].events == 0){
+    // NOTE: an emptied entry is kept, so a list being dispatched is never freed under a handler.
+    event_code_entry* entry = find_code_entry(code);
+    if(!entry){
         //TODO: WARN
         return false;
     }
 
-    u64 registered_count = list_length(state_ptr->registered[code].events);
+    u64 registered_count = list_length(entry->events);
     
     for(u64 i=0; i < registered_count; ++i){
-        registered_event e = state_ptr->registered[code].events[i];
+        registered_event e = entry->events[i];
         if(e.listener == listener && e.callback == on_event){
             //Found one, Remove it
             registered_event popped_event;
-            list_pop_at(state_ptr->registered[code].events,i,&popped_event);
+            list_pop_at(entry->events,i,&popped_event);
             
             return true;
         }
@@ -101,20 +265,37 @@ b8 unregister_event(u16 code, void* listener, on_event_fnp on_event){
     return false;
 }
 
-b8 fire_event(u16 code, void* sender, event_context context){
-    if(!state_ptr){
-         return false;
-    }
-
+static b8 dispatch_event(u16 code, void* sender, event_context context){
     // On nothing is registered for the code, boot out.
-   if(state_ptr->registered[code].events == 0){
+    u16 slot = find_code_slot(code);
+    if(!slot){
         return false;
     }
 
-    u64 registered_count = list_length(state_ptr->registered[code].events);
+    u64 registered_count = list_length(state_ptr->active[slot - 1].events);
     
     for(u64 i=0; i < registered_count; ++i){
-        registered_event e = state_ptr->registered[code].events[i];
+        //looked up on every iteration, a handler registering listeners may move both arrays
+        registered_event e = state_ptr->active[slot - 1].events[i];
+#if PANCAKE_EVENT_PROFILING
+        if(state_ptr->profiling_enabled){
+            f64 start_time = platform_get_absolute_time();
+            b8 handled = e.callback(code,sender,e.listener,context);
+            f64 elapsed = platform_get_absolute_time() - start_time;
+
+            event_handler_profile* profile = &state_ptr->profiles[e.profile_index];
+            profile->current_calls++;
+            profile->current_time += elapsed;
+            if(elapsed > profile->stats.max_call_time){
+                profile->stats.max_call_time = elapsed;
+            }
+            if(handled){
+                profile->current_handled++;
+                return true;
+            }
+            continue;
+        }
+#endif
         if(e.callback(code,sender,e.listener,context)){
             //message had been handled , do not send to other listeners
             return true;
@@ -123,3 +304,258 @@ b8 fire_event(u16 code, void* sender, event_context context){
     //not found
     return false;
 }
+
+b8 fire_event(u16 code, void* sender, event_context context){
+    if(!state_ptr){
+         return false;
+    }
+
+    return dispatch_event(code, sender, context);
+}
+
+b8 event_post(u16 code, void* sender, event_context context){
+    if(!state_ptr){
+         return false;
+    }
+
+    queued_event e;
+    e.code = code;
+    e.sender = sender;
+    e.context = context;
+    list_push(state_ptr->queues[state_ptr->write_queue], e);
+    return true;
+}
+
+void* event_payload_allocate(u64 size){
+    if(!state_ptr || size == 0){
+        return 0;
+    }
+    if(size > EVENT_PAYLOAD_ARENA_SIZE){
+        PANCAKE_ERROR("event_payload_allocate - %llu bytes is more than a frame's arena holds.", size);
+        return 0;
+    }
+    //rounded up to 16 so every payload starts aligned like memory from malloc, any struct can go there
+    return linear_allocator_allocate(&state_ptr->payload_arenas[state_ptr->write_queue], (size + 15) & ~(u64)15);
+}
+
+b8 event_post_payload(u16 code, void* sender, const void* data, u64 size){
+    void* payload = event_payload_allocate(size);
+    if(!payload){
+        return false;
+    }
+    pancake_copy_memory(payload, data, size);
+
+    event_context context;
+    context.data.payload.data = payload;
+    context.data.payload.size = size;
+    return event_post(code, sender, context);
+}
+
+b8 event_inbox_post(u16 code, void* sender, event_context context){
+    if(!state_ptr){
+         return false;
+    }
+
+    queued_event e;
+    e.code = code;
+    e.sender = sender;
+    e.context = context;
+    return ring_queue_push(&state_ptr->inbox, &e);
+}
+
+//stable bottom-up merge sort by code, so events of one code keep their posting order
+static void sort_events_by_code(queued_event* events, queued_event* scratch, u64 count){
+    queued_event* src = events;
+    queued_event* dst = scratch;
+    for(u64 width = 1; width < count; width *= 2){
+        for(u64 left = 0; left < count; left += 2 * width){
+            u64 mid = left + width < count ? left + width : count;
+            u64 right = left + 2 * width < count ? left + 2 * width : count;
+            u64 i = left, j = mid, k = left;
+            while(i < mid && j < right){
+                dst[k++] = src[j].code < src[i].code ? src[j++] : src[i++];
+            }
+            while(i < mid) dst[k++] = src[i++];
+            while(j < right) dst[k++] = src[j++];
+        }
+        queued_event* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    //the sorted result must end up in events
+    if(src != events){
+        pancake_copy_memory(events, src, count * sizeof(queued_event));
+    }
+}
+
+u64 event_dispatch_pending(){
+    if(!state_ptr){
+        return 0;
+    }
+
+    //collect what other threads posted since last time
+    queued_event inbound;
+    while(ring_queue_pop(&state_ptr->inbox, &inbound)){
+        list_push(state_ptr->queues[state_ptr->write_queue], inbound);
+    }
+
+    //swap queues, anything posted by the handlers below is dispatched next time
+    queued_event* batch = state_ptr->queues[state_ptr->write_queue];
+    linear_allocator* batch_arena = &state_ptr->payload_arenas[state_ptr->write_queue];
+    state_ptr->write_queue ^= 1;
+
+    u64 count = list_length(batch);
+    if(count == 0){
+        //payloads may also have gone out with fire_event
+        linear_allocator_free_all(batch_arena);
+        return 0;
+    }
+
+    //group the batch by code so each listener list is walked for a run of events at once
+    if(count > 1){
+        if(list_capacity(state_ptr->sort_scratch) < count){
+            list_destroy(state_ptr->sort_scratch);
+            state_ptr->sort_scratch = list_reserve(queued_event, count);
+        }
+        sort_events_by_code(batch, state_ptr->sort_scratch, count);
+    }
+
+    for(u64 i = 0; i < count; ++i){
+        dispatch_event(batch[i].code, batch[i].sender, batch[i].context);
+    }
+
+    list_clear(batch);
+    linear_allocator_free_all(batch_arena);
+    return count;
+}
+
+void event_profiling_enable(b8 enabled){
+#if PANCAKE_EVENT_PROFILING
+    if(state_ptr){
+        state_ptr->profiling_enabled = enabled;
+    }
+#else
+    if(enabled){
+        PANCAKE_WARN("event_profiling_enable - event profiling was compiled out (PANCAKE_EVENT_PROFILING = 0).");
+    }
+#endif
+}
+
+b8 event_profiling_is_enabled(){
+#if PANCAKE_EVENT_PROFILING
+    return state_ptr && state_ptr->profiling_enabled;
+#else
+    return false;
+#endif
+}
+
+void event_profiling_frame_end(){
+#if PANCAKE_EVENT_PROFILING
+    if(!state_ptr || !state_ptr->profiling_enabled){
+        return;
+    }
+
+    u32 cursor = state_ptr->window_cursor;
+    if(state_ptr->window_filled < EVENT_PROFILING_WINDOW){
+        state_ptr->window_filled++;
+    }
+    u32 filled = state_ptr->window_filled;
+
+    u64 profile_count = list_length(state_ptr->profiles);
+    for(u64 i=0; i < profile_count; ++i){
+        event_handler_profile* profile = &state_ptr->profiles[i];
+        event_handler_stats* stats = &profile->stats;
+
+        stats->frame_calls = profile->current_calls;
+        stats->frame_handled = profile->current_handled;
+        stats->frame_time = profile->current_time;
+        stats->total_calls += profile->current_calls;
+        stats->total_handled += profile->current_handled;
+        stats->total_time += profile->current_time;
+
+        profile->window[cursor] = profile->current_time;
+        f64 sum = 0;
+        f64 max = 0;
+        for(u32 f=0; f < filled; ++f){
+            sum += profile->window[f];
+            if(profile->window[f] > max){
+                max = profile->window[f];
+            }
+        }
+        stats->window_average_time = sum / filled;
+        stats->window_max_time = max;
+
+        profile->current_calls = 0;
+        profile->current_handled = 0;
+        profile->current_time = 0;
+    }
+
+    state_ptr->window_cursor = (cursor + 1) % EVENT_PROFILING_WINDOW;
+#endif
+}
+
+const event_handler_stats* event_profiling_get_stats(u32* out_count){
+    *out_count = 0;
+#if PANCAKE_EVENT_PROFILING
+    if(!state_ptr){
+        return 0;
+    }
+
+    u64 profile_count = list_length(state_ptr->profiles);
+    list_clear(state_ptr->stats_snapshot);
+    for(u64 i=0; i < profile_count; ++i){
+        list_push(state_ptr->stats_snapshot, state_ptr->profiles[i].stats);
+    }
+    *out_count = (u32)profile_count;
+    return state_ptr->stats_snapshot;
+#else
+    return 0;
+#endif
+}
+
+b8 event_profiling_dump(const char* path){
+    u32 count = 0;
+    const event_handler_stats* stats = event_profiling_get_stats(&count);
+    if(!stats){
+        return false;
+    }
+
+    //worst frame first, that is the handler to look at
+    u32* order = pancake_allocate(sizeof(u32) * (count ? count : 1), MEMORY_TAG_ARRAY);
+    for(u32 i=0; i < count; ++i){
+        u32 j = i;
+        while(j > 0 && stats[order[j - 1]].window_max_time < stats[i].window_max_time){
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    string_builder report;
+    string_builder_create(4096, 0, &report);
+    string_builder_append_format(&report, "event handler profile, %u handlers, window of %u frames (times in ms)\n", count, EVENT_PROFILING_WINDOW);
+    string_builder_append(&report, "code\tlistener\tcallback\tframe_calls\tframe_handled\tframe_ms\twindow_avg_ms\twindow_max_ms\tmax_call_ms\ttotal_calls\ttotal_handled\ttotal_ms\n");
+    for(u32 i=0; i < count; ++i){
+        const event_handler_stats* s = &stats[order[i]];
+        string_builder_append_format(&report, "%u\t%p\t%p\t%u\t%u\t%.4f\t%.4f\t%.4f\t%.4f\t%llu\t%llu\t%.4f\n",
+            s->code, s->listener, (void*)s->callback, s->frame_calls, s->frame_handled,
+            s->frame_time * 1000.0, s->window_average_time * 1000.0, s->window_max_time * 1000.0, s->max_call_time * 1000.0,
+            s->total_calls, s->total_handled, s->total_time * 1000.0);
+    }
+    pancake_free(order, sizeof(u32) * (count ? count : 1), MEMORY_TAG_ARRAY);
+
+    b8 result = false;
+    file_handle handle;
+    if(filesystem_open(path, FILE_MODE_WRITE, false, &handle)){
+        u64 written = 0;
+        result = filesystem_write(&handle, report.length, report.data, &written);
+        filesystem_close(&handle);
+    }
+    if(!result){
+        PANCAKE_ERROR("event_profiling_dump - unable to write '%s'.", path);
+    }
+
+    string_builder_destroy(&report);
+    return result;
+}
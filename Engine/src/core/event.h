@@ -3,7 +3,7 @@
 #include "defines.h"
 
 typedef struct event_context{
-    //128 bytes
+    //16 bytes (128 bits)
     union{
         i64 i64[2];
         u64 u64[2];
@@ -17,6 +17,12 @@ typedef struct event_context{
         u16 u16[8];
 
         char c[16];
+
+        //variable size data, allocated with event_payload_allocate (or by event_post_payload)
+        struct{
+            void* data;
+            u64 size;
+        }payload;
     }data;
 }event_context;
 
@@ -24,8 +30,8 @@ typedef struct event_context{
 //should return true if handled
 typedef b8 (*on_event_fnp)(u16 code, void* sender, void* lestener_inst, event_context data);
 
-void initialize_evnets_system(u64* memory_requirement, void* state);
-void shutdown_events_system(void* state);
+PANCAKE_API void initialize_evnets_system(u64* memory_requirement, void* state);
+PANCAKE_API void shutdown_events_system(void* state);
 
 /*
     Register to listen for when events are sent with the provided code.
@@ -37,6 +43,21 @@ void shutdown_events_system(void* state);
 */
 PANCAKE_API b8 register_event(u16 code, void* listener, on_event_fnp on_event);
 
+//priority used by register_event
+#define EVENT_PRIORITY_DEFAULT 0
+
+/*
+    Same as register_event, with an explicit priority. Listeners are called from the highest priority to the lowest
+    (equal priorities in registration order), so a high priority consumer such as a UI layer that handles input
+    short-circuits the event before the rest of the listeners are even looked at.
+    @param code : the event code to listen for
+    @param listener : a pointer to a listener instance, can be 0/NULL
+    @param on_event : the Callback function pointer to be invoked when the event code is fired
+    @param priority : higher is called earlier, EVENT_PRIORITY_DEFAULT for everyday listeners
+    @return true if the event is successfully registered, Otherwise false
+*/
+PANCAKE_API b8 register_event_priority(u16 code, void* listener, on_event_fnp on_event, i32 priority);
+
 /*
     Unregister from listening for when events are sent with the provided code.
     If no matching registration is found the return value will be false
@@ -57,6 +78,113 @@ PANCAKE_API b8 unregister_event(u16 code, void* listener, on_event_fnp on_event)
 */
 PANCAKE_API b8 fire_event(u16 code, void* sender, event_context context);
 
+/*
+    Queue an event to be dispatched later by event_dispatch_pending, instead of right away.
+    Safe to call from within event handlers; events posted during a dispatch go to the next batch.
+    @param code : the event code to post .
+    @param sender : a pointer to the sender, can be 0/NULL .
+    @param context : the event data, copied into the queue .
+    @return true if queued, Otherwise false
+*/
+PANCAKE_API b8 event_post(u16 code, void* sender, event_context context);
+
+/*
+    Allocate size bytes from the event system's frame arena, for data too big for event_context.
+    Put the pointer and size in context.data.payload and fire or post the event; no one has to free it.
+    The memory stays valid until the end of the next event_dispatch_pending (i.e. through the dispatch
+    of events posted this frame), after which the arena is reset. Main thread only.
+    @param size : the number of bytes needed .
+    @return the zeroed memory, 16 byte aligned, or 0 if the arena is exhausted for this frame
+*/
+PANCAKE_API void* event_payload_allocate(u64 size);
+
+/*
+    Copy size bytes of data into the frame arena and post an event carrying them in context.data.payload.
+    @param code : the event code to post .
+    @param sender : a pointer to the sender, can be 0/NULL .
+    @param data : the payload to copy .
+    @param size : the size of the payload in bytes .
+    @return true if queued, Otherwise false
+*/
+PANCAKE_API b8 event_post_payload(u16 code, void* sender, const void* data, u64 size);
+
+/*
+    Thread safe version of event_post, for worker threads notifying the main thread (asset loaded, job done...).
+    The event lands in a lock-free inbox that event_dispatch_pending drains on the main thread.
+    Everything else in the event system (registration, firing, payloads) must stay on the main thread.
+    @param code : the event code to post .
+    @param sender : a pointer to the sender, can be 0/NULL .
+    @param context : the event data, copied into the inbox .
+    @return true if queued, false if the inbox is full (the caller may retry after the next dispatch)
+*/
+PANCAKE_API b8 event_inbox_post(u16 code, void* sender, event_context context);
+
+/*
+    Dispatch every event posted since the last call, including those from the inbox. Events are grouped by code, keeping the
+    order they were posted in within a code, and each is handed to the listeners as fire_event would.
+    Called once per frame by the application, right after the platform messages are pumped.
+    @return the number of events dispatched
+*/
+PANCAKE_API u64 event_dispatch_pending();
+
+/*
+    Event handler profiling. Compiled in while PANCAKE_EVENT_PROFILING is 1 (the default outside release
+    builds, as for debug logging: PANCAKE_RELEASE, or no _DEBUG), and off at runtime until
+    event_profiling_enable(true). When on, every callback invoked by fire_event/event_dispatch_pending
+    is timed and counted per code/listener/callback.
+*/
+#ifndef PANCAKE_EVENT_PROFILING
+#if PANCAKE_RELEASE == 1 || !defined(_DEBUG)
+#define PANCAKE_EVENT_PROFILING 0
+#else
+#define PANCAKE_EVENT_PROFILING 1
+#endif
+#endif
+
+//number of frames the rolling aggregates cover
+#define EVENT_PROFILING_WINDOW 64
+
+typedef struct event_handler_stats{
+    u16 code;
+    void* listener;
+    on_event_fnp callback;
+
+    //during the last completed frame
+    u32 frame_calls;
+    u32 frame_handled;
+    f64 frame_time;
+
+    //per-frame time over the last EVENT_PROFILING_WINDOW frames
+    f64 window_average_time;
+    f64 window_max_time;
+
+    //since profiling started, times in seconds
+    f64 max_call_time;
+    u64 total_calls;
+    u64 total_handled;
+    f64 total_time;
+}event_handler_stats;
+
+PANCAKE_API void event_profiling_enable(b8 enabled);
+PANCAKE_API b8 event_profiling_is_enabled();
+
+//rolls the current frame into the aggregates. called by the application once per frame.
+PANCAKE_API void event_profiling_frame_end();
+
+/*
+    Get the stats of every handler registered so far (including unregistered ones).
+    @param out_count : receives the number of entries .
+    @return an array of out_count stats, valid until the next call
+*/
+PANCAKE_API const event_handler_stats* event_profiling_get_stats(u32* out_count);
+
+/*
+    Write the stats of every handler to a tab separated text file, the worst frame time first.
+    @param path : the file to write .
+    @return true if written, Otherwise false
+*/
+PANCAKE_API b8 event_profiling_dump(const char* path);
+
 // System internal event codes. Application should use codes beyond 255.
 typedef enum system_event_code {
     // Shuts the application down on the next frame.
@@ -65,37 +193,46 @@ typedef enum system_event_code {
     // Keyboard key pressed.
     /* Context usage:
      * u16 key_code = data.data.u16[0];
+     * f64 time = data.data.f64[1]; (when the input arrived, see platform_get_absolute_time)
      */
     EVENT_CODE_KEY_PRESSED = 0x02,
 
     // Keyboard key released.
     /* Context usage:
      * u16 key_code = data.data.u16[0];
+     * f64 time = data.data.f64[1]; (when the input arrived, see platform_get_absolute_time)
      */
     EVENT_CODE_KEY_RELEASED = 0x03,
 
     // Mouse button pressed.
     /* Context usage:
      * u16 button = data.data.u16[0];
+     * f64 time = data.data.f64[1]; (when the input arrived, see platform_get_absolute_time)
      */
     EVENT_CODE_BUTTON_PRESSED = 0x04,
 
     // Mouse button released.
     /* Context usage:
      * u16 button = data.data.u16[0];
+     * f64 time = data.data.f64[1]; (when the input arrived, see platform_get_absolute_time)
      */
     EVENT_CODE_BUTTON_RELEASED = 0x05,
 
-    // Mouse moved.
+    // Mouse moved. Posted at most once per frame, coalescing every move since the previous one.
     /* Context usage:
      * u16 x = data.data.u16[0];
      * u16 y = data.data.u16[1];
+     * i16 delta_x = data.data.i16[2];
+     * i16 delta_y = data.data.i16[3];
+     * u16 move_count = data.data.u16[4];
+     * the time of the last move is given by input_mouse_get_move_time()
      */
     EVENT_CODE_MOUSE_MOVED = 0x06,
 
     // Mouse wheel roled.
     /* Context usage:
      * u8 z_delta = data.data.u8[0];
+     * f64 time = data.data.f64[1];
      */
     EVENT_CODE_MOUSE_WHEEL = 0x07,
 
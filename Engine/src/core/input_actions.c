@@ -0,0 +1,179 @@
+#include "input_actions.h"
+#include "pancake_memory.h"
+#include "logger.h"
+
+//the compiled bindings of an action
+typedef struct action_binding{
+    input_key_mask keys;
+    u32 buttons;
+} action_binding;
+
+typedef struct axis_binding{
+    input_key_mask negative;
+    input_key_mask positive;
+} axis_binding;
+
+typedef struct input_actions_state{
+    u32 action_count;
+    string_id action_names[INPUT_ACTIONS_MAX];
+    action_binding action_bindings[INPUT_ACTIONS_MAX];
+    u8 action_states[INPUT_ACTIONS_MAX];
+
+    u32 axis_count;
+    string_id axis_names[INPUT_AXES_MAX];
+    axis_binding axis_bindings[INPUT_AXES_MAX];
+    f32 axis_values[INPUT_AXES_MAX];
+} input_actions_state;
+
+static input_actions_state* state_ptr;
+
+PANCAKE_API void initialize_input_actions_system(u64* memory_requirement, void* state){
+    *memory_requirement = sizeof(input_actions_state);
+    if(state == 0){
+        return;
+    }
+    pancake_zero_memory(state, sizeof(input_actions_state));
+    state_ptr = state;
+}
+
+PANCAKE_API void shutdown_input_actions_system(void* state){
+    state_ptr = 0;
+}
+
+static PANCAKE_INLINE b8 mask_intersects(const input_key_mask* a, const input_key_mask* b){
+    return ((a->bits[0] & b->bits[0]) | (a->bits[1] & b->bits[1]) | (a->bits[2] & b->bits[2]) | (a->bits[3] & b->bits[3])) != 0;
+}
+
+PANCAKE_API void input_actions_update(){
+    if(!state_ptr) return;
+
+    const input_key_mask* keys_down = input_keys_get_state();
+    if(!keys_down) return;
+    u32 buttons_down = input_mouse_get_buttons();
+
+    //edges come from the action itself going up/down, so an action bound to two keys
+    //is not pressed again when the second key goes down while the first is held
+    for(u32 i = 0; i < state_ptr->action_count; ++i){
+        const action_binding* binding = &state_ptr->action_bindings[i];
+        u8 was_down = state_ptr->action_states[i] & INPUT_ACTION_DOWN;
+        u8 down = (mask_intersects(&binding->keys, keys_down) || (binding->buttons & buttons_down)) ? INPUT_ACTION_DOWN : 0;
+        state_ptr->action_states[i] = down
+            | ((down && !was_down) ? INPUT_ACTION_PRESSED : 0)
+            | ((!down && was_down) ? INPUT_ACTION_RELEASED : 0);
+    }
+
+    for(u32 i = 0; i < state_ptr->axis_count; ++i){
+        const axis_binding* binding = &state_ptr->axis_bindings[i];
+        state_ptr->axis_values[i] = (f32)mask_intersects(&binding->positive, keys_down) - (f32)mask_intersects(&binding->negative, keys_down);
+    }
+}
+
+PANCAKE_API input_action input_action_find(string_id name){
+    if(!state_ptr) return INVALID_INPUT_ACTION;
+
+    for(u32 i = 0; i < state_ptr->action_count; ++i){
+        if(state_ptr->action_names[i] == name){
+            return (input_action)i;
+        }
+    }
+    return INVALID_INPUT_ACTION;
+}
+
+PANCAKE_API input_action input_action_register(string_id name){
+    if(!state_ptr) return INVALID_INPUT_ACTION;
+
+    input_action existing = input_action_find(name);
+    if(existing != INVALID_INPUT_ACTION){
+        return existing;
+    }
+    if(state_ptr->action_count == INPUT_ACTIONS_MAX){
+        PANCAKE_ERROR("input_action_register - all %d actions are in use.", INPUT_ACTIONS_MAX);
+        return INVALID_INPUT_ACTION;
+    }
+    u32 index = state_ptr->action_count++;
+    state_ptr->action_names[index] = name;
+    return (input_action)index;
+}
+
+PANCAKE_API void input_action_bind_key(input_action action, keys key){
+    if(!state_ptr || action >= state_ptr->action_count) return;
+
+    input_key_mask_add(&state_ptr->action_bindings[action].keys, key);
+}
+
+PANCAKE_API void input_action_bind_button(input_action action, m_buttons button){
+    //buttons past the last one would shift past the mask
+    if(!state_ptr || action >= state_ptr->action_count || button >= BUTTON_MAX_BUTTONS) return;
+
+    state_ptr->action_bindings[action].buttons |= 1u << button;
+}
+
+PANCAKE_API void input_action_unbind_all(input_action action){
+    if(!state_ptr || action >= state_ptr->action_count) return;
+
+    pancake_zero_memory(&state_ptr->action_bindings[action], sizeof(action_binding));
+}
+
+PANCAKE_API const u8* input_actions_get_states(u32* out_count){
+    if(!state_ptr){
+        *out_count = 0;
+        return 0;
+    }
+    *out_count = state_ptr->action_count;
+    return state_ptr->action_states;
+}
+
+PANCAKE_API u8 input_action_get_state(input_action action){
+    if(!state_ptr || action >= state_ptr->action_count) return 0;
+
+    return state_ptr->action_states[action];
+}
+
+PANCAKE_API input_axis input_axis_find(string_id name){
+    if(!state_ptr) return INVALID_INPUT_ACTION;
+
+    for(u32 i = 0; i < state_ptr->axis_count; ++i){
+        if(state_ptr->axis_names[i] == name){
+            return (input_axis)i;
+        }
+    }
+    return INVALID_INPUT_ACTION;
+}
+
+PANCAKE_API input_axis input_axis_register(string_id name){
+    if(!state_ptr) return INVALID_INPUT_ACTION;
+
+    input_axis existing = input_axis_find(name);
+    if(existing != INVALID_INPUT_ACTION){
+        return existing;
+    }
+    if(state_ptr->axis_count == INPUT_AXES_MAX){
+        PANCAKE_ERROR("input_axis_register - all %d axes are in use.", INPUT_AXES_MAX);
+        return INVALID_INPUT_ACTION;
+    }
+    u32 index = state_ptr->axis_count++;
+    state_ptr->axis_names[index] = name;
+    return (input_axis)index;
+}
+
+PANCAKE_API void input_axis_bind_keys(input_axis axis, keys negative, keys positive){
+    if(!state_ptr || axis >= state_ptr->axis_count) return;
+
+    input_key_mask_add(&state_ptr->axis_bindings[axis].negative, negative);
+    input_key_mask_add(&state_ptr->axis_bindings[axis].positive, positive);
+}
+
+PANCAKE_API const f32* input_axes_get_values(u32* out_count){
+    if(!state_ptr){
+        *out_count = 0;
+        return 0;
+    }
+    *out_count = state_ptr->axis_count;
+    return state_ptr->axis_values;
+}
+
+PANCAKE_API f32 input_axis_get_value(input_axis axis){
+    if(!state_ptr || axis >= state_ptr->axis_count) return 0;
+
+    return state_ptr->axis_values[axis];
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "defines.h"
+#include "inputs.h"
+#include "string_id.h"
+
+/*
+    Maps named actions ("jump", "fire"...) and axes ("move_x") to keys and mouse buttons, so games
+    ask about what the player wants to do instead of which key is down.
+
+    Each action's bindings are compiled into a key mask plus a button mask, and all actions are
+    evaluated once per frame into a flat state array. Reading an action is then a byte load from
+    that array (see input_actions_get_states), no matter how many actions a game checks.
+*/
+
+#define INPUT_ACTIONS_MAX 256
+#define INPUT_AXES_MAX 64
+
+#define INVALID_INPUT_ACTION 0xFFFF
+
+typedef u16 input_action;
+typedef u16 input_axis;
+
+//flags of an action's state
+typedef enum input_action_state{
+    INPUT_ACTION_DOWN = 0x1,
+    //went down this frame
+    INPUT_ACTION_PRESSED = 0x2,
+    //went up this frame
+    INPUT_ACTION_RELEASED = 0x4
+} input_action_state;
+
+/**
+ * @brief Initializes the input actions system. Call twice; once with state = 0 to get required memory size,
+ * then a second time passing allocated memory to state.
+ *
+ * @param memory_requirement A pointer to hold the required memory size of internal state.
+ * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ */
+PANCAKE_API void initialize_input_actions_system(u64* memory_requirement, void* state);
+PANCAKE_API void shutdown_input_actions_system(void* state);
+
+//evaluates every action and axis against this frame's input. called once per frame, after inputs_frame_prepare.
+PANCAKE_API void input_actions_update();
+
+/**
+ * Registers an action, or returns the existing one with that name.
+ * @param name The id of the action's name, e.g. STRING_ID("jump").
+ * @returns The action, or INVALID_INPUT_ACTION if there is no room left.
+ */
+PANCAKE_API input_action input_action_register(string_id name);
+
+// Returns the action registered with that name, or INVALID_INPUT_ACTION.
+PANCAKE_API input_action input_action_find(string_id name);
+
+PANCAKE_API void input_action_bind_key(input_action action, keys key);
+PANCAKE_API void input_action_bind_button(input_action action, m_buttons button);
+// Removes all the bindings of the action.
+PANCAKE_API void input_action_unbind_all(input_action action);
+
+/**
+ * The state flags of every action, indexed by input_action, valid until the next input_actions_update.
+ * Keep the pointer around and test the flags directly when checking many actions per frame.
+ * @param out_count A pointer to hold the number of registered actions.
+ */
+PANCAKE_API const u8* input_actions_get_states(u32* out_count);
+
+// Returns the state flags (see input_action_state) of the action.
+PANCAKE_API u8 input_action_get_state(input_action action);
+
+PANCAKE_INLINE b8 input_action_is_down(input_action action) {
+    return (input_action_get_state(action) & INPUT_ACTION_DOWN) != 0;
+}
+PANCAKE_INLINE b8 input_action_was_pressed(input_action action) {
+    return (input_action_get_state(action) & INPUT_ACTION_PRESSED) != 0;
+}
+PANCAKE_INLINE b8 input_action_was_released(input_action action) {
+    return (input_action_get_state(action) & INPUT_ACTION_RELEASED) != 0;
+}
+
+/**
+ * Registers an axis, or returns the existing one with that name. Its value is -1, 0 or 1
+ * depending on whether its negative bindings, none or both, or its positive bindings are down.
+ * @returns The axis, or INVALID_INPUT_ACTION if there is no room left.
+ */
+PANCAKE_API input_axis input_axis_register(string_id name);
+PANCAKE_API input_axis input_axis_find(string_id name);
+PANCAKE_API void input_axis_bind_keys(input_axis axis, keys negative, keys positive);
+
+// The values of every axis, indexed by input_axis, valid until the next input_actions_update.
+PANCAKE_API const f32* input_axes_get_values(u32* out_count);
+PANCAKE_API f32 input_axis_get_value(input_axis axis);
@@ -0,0 +1,276 @@
+#include "input_recorder.h"
+#include "inputs.h"
+#include "logger.h"
+#include "pancake_memory.h"
+#include "platform/platform.h"
+#include "platform/filesystem.h"
+
+STATIC_ASSERT(sizeof(input_record) == 16, "input_record is written to files as is");
+
+//records are written in batches of this many, not one by one
+#define INPUT_RECORDER_BUFFER_RECORDS 1024
+
+typedef enum input_recorder_mode{
+    INPUT_RECORDER_IDLE,
+    INPUT_RECORDER_RECORDING,
+    INPUT_RECORDER_REPLAYING
+} input_recorder_mode;
+
+typedef struct input_recorder_state{
+    input_recorder_mode mode;
+    u32 frame;
+    f64 start_time;
+
+    //recording
+    file_handle file;
+    u32 buffered_count;
+    input_record buffer[INPUT_RECORDER_BUFFER_RECORDS];
+
+    //replaying
+    u8* file_data;
+    u64 file_size;
+    const input_record* records;
+    u64 record_count;
+    u64 cursor;
+    //set while the recorder itself feeds the inputs system
+    b8 feeding;
+} input_recorder_state;
+
+static input_recorder_state* state_ptr;
+
+void initialize_input_recorder(u64* memory_requirement, void* state){
+    *memory_requirement = sizeof(input_recorder_state);
+    if(state == 0){
+        return;
+    }
+    pancake_zero_memory(state, sizeof(input_recorder_state));
+    state_ptr = state;
+}
+
+void shutdown_input_recorder(void* state){
+    if(state_ptr){
+        input_recorder_stop();
+    }
+    state_ptr = 0;
+}
+
+static void flush_records(){
+    if(state_ptr->buffered_count == 0){
+        return;
+    }
+    u64 written = 0;
+    if(!filesystem_write(&state_ptr->file, state_ptr->buffered_count * sizeof(input_record), state_ptr->buffer, &written)){
+        PANCAKE_ERROR("input_recorder - failed to write %u records.", state_ptr->buffered_count);
+    }
+    state_ptr->buffered_count = 0;
+}
+
+static void append_record(const input_record* record){
+    state_ptr->buffer[state_ptr->buffered_count++] = *record;
+    if(state_ptr->buffered_count == INPUT_RECORDER_BUFFER_RECORDS){
+        flush_records();
+    }
+}
+
+//a record replay can feed to the inputs system as is
+static b8 record_is_valid(const input_record* record){
+    switch(record->type){
+        case INPUT_RECORD_KEY:
+            return record->code < KEYS_MAX_KEYS;
+        case INPUT_RECORD_BUTTON:
+            return record->code < BUTTON_MAX_BUTTONS;
+        case INPUT_RECORD_MOVE:
+        case INPUT_RECORD_WHEEL:
+        case INPUT_RECORD_FRAME:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void fill_record(input_record* record, input_record_type type, f64 time){
+    pancake_zero_memory(record, sizeof(input_record));
+    record->frame = state_ptr->frame;
+    record->time_us = time > state_ptr->start_time ? (u32)((time - state_ptr->start_time) * 1000000.0) : 0;
+    record->type = type;
+}
+
+PANCAKE_API b8 input_recorder_start_recording(const char* path){
+    if(!state_ptr) return false;
+
+    input_recorder_stop();
+    if(!filesystem_open(path, FILE_MODE_WRITE, true, &state_ptr->file)){
+        PANCAKE_ERROR("input_recorder - could not create '%s'.", path);
+        return false;
+    }
+
+    input_recording_header header = {0};
+    header.magic = INPUT_RECORDING_MAGIC;
+    header.version = INPUT_RECORDING_VERSION;
+    header.record_size = sizeof(input_record);
+    u64 written = 0;
+    if(!filesystem_write(&state_ptr->file, sizeof(header), &header, &written)){
+        PANCAKE_ERROR("input_recorder - could not write to '%s'.", path);
+        filesystem_close(&state_ptr->file);
+        return false;
+    }
+
+    state_ptr->mode = INPUT_RECORDER_RECORDING;
+    state_ptr->frame = 0;
+    state_ptr->buffered_count = 0;
+    state_ptr->start_time = platform_get_absolute_time();
+    PANCAKE_INFO("Recording input to '%s'.", path);
+    return true;
+}
+
+PANCAKE_API b8 input_recorder_start_replay(const char* path){
+    if(!state_ptr) return false;
+
+    input_recorder_stop();
+    file_handle file;
+    if(!filesystem_open(path, FILE_MODE_READ, true, &file)){
+        PANCAKE_ERROR("input_recorder - could not open '%s'.", path);
+        return false;
+    }
+    u8* data = 0;
+    u64 size = 0;
+    b8 read = filesystem_read_all_bytes(&file, &data, &size);
+    filesystem_close(&file);
+
+    const input_recording_header* header = (const input_recording_header*)data;
+    if(!read || size < sizeof(input_recording_header)
+        || header->magic != INPUT_RECORDING_MAGIC
+        || header->version != INPUT_RECORDING_VERSION
+        || header->record_size != sizeof(input_record)){
+        PANCAKE_ERROR("input_recorder - '%s' is not a valid input recording.", path);
+        if(data){
+            pancake_free(data, size, MEMORY_TAG_STRING);
+        }
+        return false;
+    }
+
+    const input_record* records = (const input_record*)(data + sizeof(input_recording_header));
+    u64 record_count = (size - sizeof(input_recording_header)) / sizeof(input_record);
+    for(u64 i = 0; i < record_count; ++i){
+        if(!record_is_valid(&records[i])){
+            PANCAKE_ERROR("input_recorder - '%s' holds an invalid record (%llu).", path, i);
+            pancake_free(data, size, MEMORY_TAG_STRING);
+            return false;
+        }
+    }
+
+    state_ptr->file_data = data;
+    state_ptr->file_size = size;
+    state_ptr->records = records;
+    state_ptr->record_count = record_count;
+    state_ptr->cursor = 0;
+    state_ptr->frame = 0;
+    state_ptr->mode = INPUT_RECORDER_REPLAYING;
+    PANCAKE_INFO("Replaying %llu input records from '%s'.", state_ptr->record_count, path);
+    return true;
+}
+
+PANCAKE_API void input_recorder_stop(){
+    if(!state_ptr) return;
+
+    if(state_ptr->mode == INPUT_RECORDER_RECORDING){
+        flush_records();
+        filesystem_close(&state_ptr->file);
+    }else if(state_ptr->mode == INPUT_RECORDER_REPLAYING){
+        pancake_free(state_ptr->file_data, state_ptr->file_size, MEMORY_TAG_STRING);
+        state_ptr->file_data = 0;
+        state_ptr->records = 0;
+        state_ptr->record_count = 0;
+    }
+    state_ptr->mode = INPUT_RECORDER_IDLE;
+}
+
+PANCAKE_API b8 input_recorder_is_recording(){
+    return state_ptr && state_ptr->mode == INPUT_RECORDER_RECORDING;
+}
+
+PANCAKE_API b8 input_recorder_is_replaying(){
+    return state_ptr && state_ptr->mode == INPUT_RECORDER_REPLAYING;
+}
+
+b8 input_recorder_capture(input_record_type type, u16 code, b8 pressed, i16 x, i16 y, f64 time){
+    if(!state_ptr) return true;
+
+    switch(state_ptr->mode){
+        case INPUT_RECORDER_RECORDING: {
+            input_record record;
+            fill_record(&record, type, time);
+            record.code = code;
+            record.pressed = pressed;
+            if(type == INPUT_RECORD_WHEEL){
+                record.value.wheel_delta = x;
+            }else{
+                record.value.position.x = x;
+                record.value.position.y = y;
+            }
+            append_record(&record);
+            return true;
+        }
+        case INPUT_RECORDER_REPLAYING:
+            return state_ptr->feeding;
+        default:
+            return true;
+    }
+}
+
+PANCAKE_API b8 input_recorder_frame_begin(){
+    if(!state_ptr || state_ptr->mode != INPUT_RECORDER_REPLAYING) return true;
+
+    if(state_ptr->cursor >= state_ptr->record_count){
+        return false;
+    }
+
+    //everything up to this frame's delta, arriving now
+    f64 now = platform_get_absolute_time();
+    state_ptr->feeding = true;
+    while(state_ptr->cursor < state_ptr->record_count){
+        const input_record* record = &state_ptr->records[state_ptr->cursor];
+        if(record->frame > state_ptr->frame || record->type == INPUT_RECORD_FRAME){
+            break;
+        }
+        switch(record->type){
+            case INPUT_RECORD_KEY:
+                input_process_key((keys)record->code, record->pressed, now);
+                break;
+            case INPUT_RECORD_BUTTON:
+                input_process_mouse_button((m_buttons)record->code, record->pressed, now);
+                break;
+            case INPUT_RECORD_MOVE:
+                input_process_mouse_move(record->value.position.x, record->value.position.y, now);
+                break;
+            case INPUT_RECORD_WHEEL:
+                input_process_mouse_wheel((i8)record->value.wheel_delta, now);
+                break;
+        }
+        state_ptr->cursor++;
+    }
+    state_ptr->feeding = false;
+    return true;
+}
+
+PANCAKE_API f64 input_recorder_frame_delta(f64 delta){
+    if(!state_ptr) return delta;
+
+    if(state_ptr->mode == INPUT_RECORDER_RECORDING){
+        input_record record;
+        fill_record(&record, INPUT_RECORD_FRAME, platform_get_absolute_time());
+        record.value.frame_delta = (f32)delta;
+        append_record(&record);
+    }else if(state_ptr->mode == INPUT_RECORDER_REPLAYING){
+        if(state_ptr->cursor < state_ptr->record_count){
+            const input_record* record = &state_ptr->records[state_ptr->cursor];
+            if(record->type == INPUT_RECORD_FRAME && record->frame == state_ptr->frame){
+                delta = record->value.frame_delta;
+                state_ptr->cursor++;
+            }
+        }
+    }
+
+    state_ptr->frame++;
+    return delta;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    Records everything fed to the inputs system (keys, buttons, moves, wheel) along with the frame it
+    happened on, and plays it back later instead of the live input, so the same session can be run
+    over and over (benchmarks, regressions).
+
+    The frame delta given to the game is recorded as well and handed back on replay, so the game
+    simulates the exact same frames while the actual frame times can still be measured.
+
+    File layout (little endian, written as is)
+    input_recording_header
+    input_record[...] until the end of the file
+*/
+
+#define INPUT_RECORDING_MAGIC 0x52494B50 // "PKIR"
+#define INPUT_RECORDING_VERSION 1
+
+typedef enum input_record_type{
+    INPUT_RECORD_KEY,
+    INPUT_RECORD_BUTTON,
+    INPUT_RECORD_MOVE,
+    INPUT_RECORD_WHEEL,
+    //end of a frame, holds the delta given to the game
+    INPUT_RECORD_FRAME
+} input_record_type;
+
+typedef struct input_recording_header{
+    u32 magic;
+    u32 version;
+    u32 record_size;
+    u32 reserved;
+} input_recording_header;
+
+//16 bytes
+typedef struct input_record{
+    u32 frame;
+    //microseconds since the recording started, when the input arrived
+    u32 time_us;
+    u8 type;
+    u8 pressed;
+    //the key or button
+    u16 code;
+    union{
+        struct{
+            i16 x;
+            i16 y;
+        } position;
+        i32 wheel_delta;
+        f32 frame_delta;
+    } value;
+} input_record;
+
+void initialize_input_recorder(u64* memory_requirement, void* state);
+void shutdown_input_recorder(void* state);
+
+/**
+ * Starts writing the input to the file at path, stops any recording or replay in progress.
+ * @returns True if the file could be created; otherwise false.
+ */
+PANCAKE_API b8 input_recorder_start_recording(const char* path);
+
+/**
+ * Loads the recording at path and starts feeding it to the inputs system. Live input is
+ * ignored until the replay is over.
+ * @returns True if the file is a valid recording; otherwise false.
+ */
+PANCAKE_API b8 input_recorder_start_replay(const char* path);
+
+//stops recording (flushing what is left to the file) or replaying.
+PANCAKE_API void input_recorder_stop();
+
+PANCAKE_API b8 input_recorder_is_recording();
+PANCAKE_API b8 input_recorder_is_replaying();
+
+/*
+    Called by the inputs system for every input it is given.
+    Records it when recording. Returns false if live input should be dropped (replaying).
+*/
+b8 input_recorder_capture(input_record_type type, u16 code, b8 pressed, i16 x, i16 y, f64 time);
+
+/**
+ * Called once per frame after the messages are pumped. When replaying, feeds the input recorded
+ * for this frame to the inputs system.
+ * @returns False once a replay has run out of input; otherwise true.
+ */
+PANCAKE_API b8 input_recorder_frame_begin();
+
+/**
+ * Called once per updated frame with the delta about to be given to the game. Records it, or
+ * returns the recorded one when replaying, and moves on to the next frame.
+ */
+PANCAKE_API f64 input_recorder_frame_delta(f64 delta);
@@ -2,22 +2,50 @@
 #include "event.h"
 #include "pancake_memory.h"
 #include "logger.h"
+#include "input_recorder.h"
 
-typedef struct keyboard_state{
-    b8 keys[256];
-} keyboard_state;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INPUT_MASK_SSE2 1
+#include <emmintrin.h>
+#else
+#define INPUT_MASK_SSE2 0
+#endif
+
+STATIC_ASSERT(BUTTON_MAX_BUTTONS <= 32, "mouse buttons are kept in a u32 mask");
 
 typedef struct mouse_state{
     i16 x;
     i16 y;
-    u8 buttons[BUTTON_MAX_BUTTONS];
+    //one bit per m_buttons
+    u32 buttons;
 } mouse_state;
 
 typedef struct input_state{
-    keyboard_state keyboard_current;
-    keyboard_state keyboard_previous;
+    //one bit per key, see input_key_mask
+    input_key_mask keyboard_current;
+    input_key_mask keyboard_previous;
+    //edges, computed once per frame by inputs_frame_prepare
+    input_key_mask keyboard_pressed;
+    input_key_mask keyboard_released;
     mouse_state mouse_current;
     mouse_state mouse_previous;
+    u32 mouse_pressed;
+    u32 mouse_released;
+
+    //mouse motion gathered while pumping messages, published once per frame by inputs_frame_prepare
+    i32 pending_delta_x;
+    i32 pending_delta_y;
+    u32 pending_move_count;
+    f64 pending_move_time;
+    //time of the last move published
+    f64 mouse_move_time;
+
+    //raw motion samples, only recorded while someone asked for them.
+    //double buffered: one is being filled while the other holds the last published frame
+    u32 mouse_history_requests;
+    u8 pending_samples_index;
+    u32 sample_counts[2];
+    input_mouse_sample samples[2][INPUT_MOUSE_HISTORY_CAPACITY];
 } input_state;
 
 // Internal input state pointer
@@ -39,42 +67,148 @@ void shutdown_inputs_system(void* state){
     //TODO: shutdown routines when needed
     state_ptr = 0;
 }
+//pressed = current & ~previous, released = previous & ~current
+static void compute_key_edges(const input_key_mask* current, const input_key_mask* previous, input_key_mask* pressed, input_key_mask* released){
+#if INPUT_MASK_SSE2
+    for(u32 i = 0; i < 4; i += 2){
+        __m128i cur = _mm_loadu_si128((const __m128i*)&current->bits[i]);
+        __m128i prev = _mm_loadu_si128((const __m128i*)&previous->bits[i]);
+        _mm_storeu_si128((__m128i*)&pressed->bits[i], _mm_andnot_si128(prev, cur));
+        _mm_storeu_si128((__m128i*)&released->bits[i], _mm_andnot_si128(cur, prev));
+    }
+#else
+    for(u32 i = 0; i < 4; ++i){
+        pressed->bits[i] = current->bits[i] & ~previous->bits[i];
+        released->bits[i] = previous->bits[i] & ~current->bits[i];
+    }
+#endif
+}
+
+//true if any bit is set in (a & b)
+static b8 masks_intersect(const input_key_mask* a, const input_key_mask* b){
+#if INPUT_MASK_SSE2
+    __m128i lo = _mm_and_si128(_mm_loadu_si128((const __m128i*)&a->bits[0]), _mm_loadu_si128((const __m128i*)&b->bits[0]));
+    __m128i hi = _mm_and_si128(_mm_loadu_si128((const __m128i*)&a->bits[2]), _mm_loadu_si128((const __m128i*)&b->bits[2]));
+    __m128i any = _mm_or_si128(lo, hi);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xFFFF;
+#else
+    return ((a->bits[0] & b->bits[0]) | (a->bits[1] & b->bits[1]) | (a->bits[2] & b->bits[2]) | (a->bits[3] & b->bits[3])) != 0;
+#endif
+}
+
+static i16 clamp_to_i16(i32 value){
+    return value < -32768 ? -32768 : value > 32767 ? 32767 : (i16)value;
+}
+
+void inputs_frame_prepare(){
+    if(!state_ptr) return;
+
+    //what changed while pumping messages, queried for the rest of the frame
+    compute_key_edges(&state_ptr->keyboard_current, &state_ptr->keyboard_previous, &state_ptr->keyboard_pressed, &state_ptr->keyboard_released);
+    state_ptr->mouse_pressed = state_ptr->mouse_current.buttons & ~state_ptr->mouse_previous.buttons;
+    state_ptr->mouse_released = state_ptr->mouse_previous.buttons & ~state_ptr->mouse_current.buttons;
+
+    //publish the samples gathered since last frame, the other buffer starts filling
+    u8 published = state_ptr->pending_samples_index;
+    state_ptr->pending_samples_index ^= 1;
+    state_ptr->sample_counts[state_ptr->pending_samples_index] = 0;
+
+    if(state_ptr->pending_move_count == 0){
+        state_ptr->sample_counts[published] = 0;
+        return;
+    }
+
+    //one move event per frame: last absolute position plus the motion accumulated since the previous one
+    event_context context;
+    context.data.u16[0] = state_ptr->mouse_current.x;
+    context.data.u16[1] = state_ptr->mouse_current.y;
+    context.data.i16[2] = clamp_to_i16(state_ptr->pending_delta_x);
+    context.data.i16[3] = clamp_to_i16(state_ptr->pending_delta_y);
+    context.data.u16[4] = state_ptr->pending_move_count > 0xFFFF ? 0xFFFF : (u16)state_ptr->pending_move_count;
+    event_post(EVENT_CODE_MOUSE_MOVED, 0, context);
+    state_ptr->mouse_move_time = state_ptr->pending_move_time;
+
+    state_ptr->pending_delta_x = 0;
+    state_ptr->pending_delta_y = 0;
+    state_ptr->pending_move_count = 0;
+}
+
 void inputs_update(f64 delta_time){
     if(!state_ptr) return;
     
-    //copy current states to previous states
-    pancake_copy_memory(&state_ptr->keyboard_previous,&state_ptr->keyboard_current,sizeof(keyboard_state));
-    pancake_copy_memory(&state_ptr->mouse_previous,&state_ptr->mouse_current,sizeof(mouse_state));
+    //current states become the previous states
+    state_ptr->keyboard_previous = state_ptr->keyboard_current;
+    state_ptr->mouse_previous = state_ptr->mouse_current;
 }
 
 //keyboar inputs
 PANCAKE_API b8 input_key_is_down(keys key){
     if(!state_ptr) return false;
 
-    return state_ptr->keyboard_current.keys[key] == true;
+    return input_key_mask_has(&state_ptr->keyboard_current, key);
 }
 PANCAKE_API b8 input_key_is_up(keys key){
     if(!state_ptr) return true;
 
-    return state_ptr->keyboard_current.keys[key] == false;
+    return !input_key_mask_has(&state_ptr->keyboard_current, key);
 }
 PANCAKE_API b8 input_key_was_down(keys key){
     if(!state_ptr) return false;
 
-    return state_ptr->keyboard_previous.keys[key] == true;
+    return input_key_mask_has(&state_ptr->keyboard_previous, key);
 }
 PANCAKE_API b8 input_key_was_up(keys key){
     if(!state_ptr) return true;
 
-    return state_ptr->keyboard_previous.keys[key] == false;
+    return !input_key_mask_has(&state_ptr->keyboard_previous, key);
 }
+PANCAKE_API b8 input_key_pressed_this_frame(keys key){
+    if(!state_ptr) return false;
+
+    return input_key_mask_has(&state_ptr->keyboard_pressed, key);
+}
+PANCAKE_API b8 input_key_released_this_frame(keys key){
+    if(!state_ptr) return false;
 
-void input_process_key(keys key, b8 pressed){
+    return input_key_mask_has(&state_ptr->keyboard_released, key);
+}
+PANCAKE_API b8 input_keys_any_down(const input_key_mask* mask){
+    if(!state_ptr) return false;
+
+    return masks_intersect(&state_ptr->keyboard_current, mask);
+}
+PANCAKE_API b8 input_keys_all_down(const input_key_mask* mask){
+    if(!state_ptr) return false;
+
+    const u64* current = state_ptr->keyboard_current.bits;
+    return ((mask->bits[0] & ~current[0]) | (mask->bits[1] & ~current[1]) | (mask->bits[2] & ~current[2]) | (mask->bits[3] & ~current[3])) == 0;
+}
+PANCAKE_API b8 input_keys_any_pressed(const input_key_mask* mask){
+    if(!state_ptr) return false;
+
+    return masks_intersect(&state_ptr->keyboard_pressed, mask);
+}
+PANCAKE_API b8 input_keys_any_released(const input_key_mask* mask){
+    if(!state_ptr) return false;
+
+    return masks_intersect(&state_ptr->keyboard_released, mask);
+}
+PANCAKE_API const input_key_mask* input_keys_get_state(){
+    return state_ptr ? &state_ptr->keyboard_current : 0;
+}
+
+void input_process_key(keys key, b8 pressed, f64 time){
+    //live input is dropped while a recording is replayed
+    if(!input_recorder_capture(INPUT_RECORD_KEY, key, pressed, 0, 0, time)) return;
 
     //only handle this if the state had been changed.
-    if(state_ptr && state_ptr->keyboard_current.keys[key] != pressed){
+    if(state_ptr && input_key_mask_has(&state_ptr->keyboard_current, key) != pressed){
         //update internal state
-        state_ptr->keyboard_current.keys[key] = pressed;
+        if(pressed){
+            input_key_mask_add(&state_ptr->keyboard_current, key);
+        }else{
+            input_key_mask_remove(&state_ptr->keyboard_current, key);
+        }
         
         if (key == KEY_LALT) {
             PANCAKE_INFO("Left alt %s.", pressed ? "pressed" : "released");
@@ -94,10 +228,11 @@ void input_process_key(keys key, b8 pressed){
             PANCAKE_INFO("Right shift %s.", pressed ? "pressed" : "released");
         }
 
-        //fire off an event for immediate processing
+        //post an event, dispatched once the messages of this frame are pumped
         event_context context;
         context.data.u16[0] = key;
-        fire_event(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASED, 0, context);
+        context.data.f64[1] = time;
+        event_post(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASED, 0, context);
     }
 }
 
@@ -106,22 +241,32 @@ void input_process_key(keys key, b8 pressed){
 PANCAKE_API b8 input_mouse_button_is_down(m_buttons button){
     if(!state_ptr) return false;
 
-    return state_ptr->mouse_current.buttons[button] == true;
+    return (state_ptr->mouse_current.buttons >> button) & 1;
 }
 PANCAKE_API b8 input_mouse_button_is_up(m_buttons button){
     if(!state_ptr) return true;
 
-    return state_ptr->mouse_current.buttons[button] == false;
+    return !((state_ptr->mouse_current.buttons >> button) & 1);
 }
 PANCAKE_API b8 input_mouse_button_was_down(m_buttons button){
     if(!state_ptr) return false;
 
-    return state_ptr->mouse_previous.buttons[button] == true;
+    return (state_ptr->mouse_previous.buttons >> button) & 1;
 }
 PANCAKE_API b8 input_mouse_button_was_up(m_buttons button){
     if(!state_ptr) return true;
 
-    return state_ptr->mouse_previous.buttons[button] == false;
+    return !((state_ptr->mouse_previous.buttons >> button) & 1);
+}
+PANCAKE_API b8 input_mouse_button_pressed_this_frame(m_buttons button){
+    if(!state_ptr) return false;
+
+    return (state_ptr->mouse_pressed >> button) & 1;
+}
+PANCAKE_API b8 input_mouse_button_released_this_frame(m_buttons button){
+    if(!state_ptr) return false;
+
+    return (state_ptr->mouse_released >> button) & 1;
 }
 PANCAKE_API void input_mouse_get_position(f32* x, f32* y){
     if(!state_ptr){
@@ -133,6 +278,12 @@ PANCAKE_API void input_mouse_get_position(f32* x, f32* y){
     *x = state_ptr->mouse_current.x;
     *y = state_ptr->mouse_current.y;
 }
+PANCAKE_API u32 input_mouse_get_buttons(){
+    return state_ptr ? state_ptr->mouse_current.buttons : 0;
+}
+PANCAKE_API f64 input_mouse_get_move_time(){
+    return state_ptr ? state_ptr->mouse_move_time : 0;
+}
 PANCAKE_API void input_mouse_get_previous_position(f32* x, f32* y){
     if(!state_ptr){
         *x = 0;
@@ -144,40 +295,83 @@ PANCAKE_API void input_mouse_get_previous_position(f32* x, f32* y){
     *y = state_ptr->mouse_previous.y;
 }
 
-void input_process_mouse_button(m_buttons button, b8 pressed){
+void input_process_mouse_button(m_buttons button, b8 pressed, f64 time){
+    if(!input_recorder_capture(INPUT_RECORD_BUTTON, button, pressed, 0, 0, time)) return;
+
     //if the state changed, fire an event
-    if(state_ptr->mouse_current.buttons[button] != pressed){
-        state_ptr->mouse_current.buttons[button] = pressed;
+    if(((state_ptr->mouse_current.buttons >> button) & 1) != pressed){
+        if(pressed){
+            state_ptr->mouse_current.buttons |= 1u << button;
+        }else{
+            state_ptr->mouse_current.buttons &= ~(1u << button);
+        }
 
-        //fire the event
+        //post the event
         event_context context;
         context.data.u16[0] = button;
-        fire_event(pressed ? EVENT_CODE_BUTTON_PRESSED : EVENT_CODE_BUTTON_RELEASED, 0, context);
+        context.data.f64[1] = time;
+        event_post(pressed ? EVENT_CODE_BUTTON_PRESSED : EVENT_CODE_BUTTON_RELEASED, 0, context);
     }
 }
-void input_process_mouse_move(i16 x, i16 y){
-    //if the postion changed, fire an event
+void input_process_mouse_move(i16 x, i16 y, f64 time){
+    if(!input_recorder_capture(INPUT_RECORD_MOVE, 0, false, x, y, time)) return;
+
+    //if the postion changed, accumulate it. the event is posted once per frame by inputs_frame_prepare
     if(state_ptr->mouse_current.x != x || state_ptr->mouse_current.y != y ){
         //NOTE: enable this in debugging
         //PANCAKE_DEBUG("mouse postion => (%i , %i)", x, y);
 
+        state_ptr->pending_delta_x += x - state_ptr->mouse_current.x;
+        state_ptr->pending_delta_y += y - state_ptr->mouse_current.y;
+        state_ptr->pending_move_count++;
+        state_ptr->pending_move_time = time;
+
         //update internal state
         state_ptr->mouse_current.x = x;
         state_ptr->mouse_current.y = y;
 
-        //fire an event
-        event_context context;
-        context.data.u16[0] = x;
-        context.data.u16[1] = y;
-        fire_event(EVENT_CODE_MOUSE_MOVED, 0, context);
+        //keep the intermediate positions for whoever asked for them
+        if(state_ptr->mouse_history_requests > 0){
+            u8 index = state_ptr->pending_samples_index;
+            u32 count = state_ptr->sample_counts[index];
+            if(count < INPUT_MOUSE_HISTORY_CAPACITY){
+                state_ptr->samples[index][count].x = x;
+                state_ptr->samples[index][count].y = y;
+                state_ptr->sample_counts[index] = count + 1;
+            }
+        }
+    }
+}
+
+PANCAKE_API void input_mouse_request_history(b8 enabled){
+    if(!state_ptr) return;
+
+    if(enabled){
+        state_ptr->mouse_history_requests++;
+    }else if(state_ptr->mouse_history_requests > 0){
+        state_ptr->mouse_history_requests--;
+    }
+}
+
+PANCAKE_API const input_mouse_sample* input_mouse_get_history(u32* out_count){
+    if(!state_ptr){
+        *out_count = 0;
+        return 0;
     }
+
+    u8 published = state_ptr->pending_samples_index ^ 1;
+    *out_count = state_ptr->sample_counts[published];
+    return state_ptr->samples[published];
 }
-void input_process_mouse_wheel(i8 z_delta){
+void input_process_mouse_wheel(i8 z_delta, f64 time){
+    if(!input_recorder_capture(INPUT_RECORD_WHEEL, 0, false, z_delta, 0, time)) return;
+
     //NOTE: no internal state to update
 
-    //fire an event
+    //post an event
     event_context context;
     context.data.u16[0] = z_delta;
-    fire_event(EVENT_CODE_MOUSE_WHEEL, 0, context);
+    context.data.f64[1] = time;
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, context);
 }
 
@@ -144,6 +144,26 @@ typedef enum keys {
     KEYS_MAX_KEYS
 } keys;
 
+/*
+    Keyboard state is kept as bit masks, one bit per key. A mask is also how several keys are
+    queried at once (e.g. "any of WASD"), a handful of and/or over 4 words instead of a loop.
+*/
+typedef struct input_key_mask{
+    u64 bits[4];
+} input_key_mask;
+
+STATIC_ASSERT(KEYS_MAX_KEYS <= 256, "input_key_mask holds 256 keys");
+
+PANCAKE_INLINE void input_key_mask_add(input_key_mask* mask, keys key){
+    mask->bits[(u8)key >> 6] |= 1ull << (key & 63);
+}
+PANCAKE_INLINE void input_key_mask_remove(input_key_mask* mask, keys key){
+    mask->bits[(u8)key >> 6] &= ~(1ull << (key & 63));
+}
+PANCAKE_INLINE b8 input_key_mask_has(const input_key_mask* mask, keys key){
+    return (mask->bits[(u8)key >> 6] >> (key & 63)) & 1;
+}
+
 /**
  * @brief Initializes the input system. Call twice; once to obtain memory requirement (passing
  * state = 0), then a second time passing allocated memory to state.
@@ -151,26 +171,72 @@ typedef enum keys {
  * @param memory_requirement The required size of the state memory.
  * @param state Either 0 or the allocated block of state memory.
  */
-void initialize_inputs_system(u64* memory_requirement, void* state);
-void shutdown_inputs_system(void* state);
-void inputs_update(f64 delta_time);
+PANCAKE_API void initialize_inputs_system(u64* memory_requirement, void* state);
+PANCAKE_API void shutdown_inputs_system(void* state);
+PANCAKE_API void inputs_update(f64 delta_time);
+
+//publishes the input gathered while pumping messages (e.g. the coalesced mouse move event) and
+//computes the pressed/released this frame masks.
+//called once per frame, after the platform messages are pumped and before events are dispatched.
+PANCAKE_API void inputs_frame_prepare();
 
 //keyboard inputs
 PANCAKE_API b8 input_key_is_down(keys key);
 PANCAKE_API b8 input_key_is_up(keys key);
 PANCAKE_API b8 input_key_was_down(keys key);
 PANCAKE_API b8 input_key_was_up(keys key);
+//edges since the previous frame, valid from inputs_frame_prepare until the end of the frame
+PANCAKE_API b8 input_key_pressed_this_frame(keys key);
+PANCAKE_API b8 input_key_released_this_frame(keys key);
+
+//bulk queries, true if any (or all) of the keys in mask match
+PANCAKE_API b8 input_keys_any_down(const input_key_mask* mask);
+PANCAKE_API b8 input_keys_all_down(const input_key_mask* mask);
+PANCAKE_API b8 input_keys_any_pressed(const input_key_mask* mask);
+PANCAKE_API b8 input_keys_any_released(const input_key_mask* mask);
 
-void input_process_key(keys key, b8 pressed);
+//the keys currently down
+PANCAKE_API const input_key_mask* input_keys_get_state();
+
+/*
+    The input_process_* functions are fed by the platform layer. time is when the input arrived,
+    in platform_get_absolute_time seconds, as close to the OS as the platform can get it.
+*/
+PANCAKE_API void input_process_key(keys key, b8 pressed, f64 time);
 
 //mouse inputs
 PANCAKE_API b8 input_mouse_button_is_down(m_buttons button);
 PANCAKE_API b8 input_mouse_button_is_up(m_buttons button);
 PANCAKE_API b8 input_mouse_button_was_down(m_buttons button);
 PANCAKE_API b8 input_mouse_button_was_up(m_buttons button);
+PANCAKE_API b8 input_mouse_button_pressed_this_frame(m_buttons button);
+PANCAKE_API b8 input_mouse_button_released_this_frame(m_buttons button);
+//the buttons currently down, one bit per m_buttons
+PANCAKE_API u32 input_mouse_get_buttons();
 PANCAKE_API void input_mouse_get_position(f32* x, f32* y);
 PANCAKE_API void input_mouse_get_previous_position(f32* x, f32* y);
-
-void input_process_mouse_button(m_buttons button, b8 pressed);
-void input_process_mouse_move(i16 x, i16 y);
-void input_process_mouse_wheel(i8 z_delta);
+//when the last move of the published frame arrived, 0 if the mouse never moved
+PANCAKE_API f64 input_mouse_get_move_time();
+
+/*
+    Mouse motion is coalesced: however many moves the platform reports, a single EVENT_CODE_MOUSE_MOVED
+    is posted per frame. Consumers that need every intermediate position (drawing, gestures...) request
+    the history and read it back each frame.
+*/
+//the most motion samples kept per frame, later ones are dropped (the event still has the final position)
+#define INPUT_MOUSE_HISTORY_CAPACITY 256
+
+typedef struct input_mouse_sample{
+    i16 x;
+    i16 y;
+} input_mouse_sample;
+
+//starts (true) or stops (false) recording motion samples. requests are counted, recording stops once all stopped.
+PANCAKE_API void input_mouse_request_history(b8 enabled);
+
+//returns the motion samples of the last published frame, oldest first. valid until the next frame.
+PANCAKE_API const input_mouse_sample* input_mouse_get_history(u32* out_count);
+
+void input_process_mouse_button(m_buttons button, b8 pressed, f64 time);
+void input_process_mouse_move(i16 x, i16 y, f64 time);
+void input_process_mouse_wheel(i8 z_delta, f64 time);
@@ -0,0 +1,95 @@
+#include "log_ring.h"
+#include "string_builder.h"
+
+STATIC_ASSERT(sizeof(log_ring_header) == 32, "log_ring_header is read from files as is");
+
+b8 log_ring_create(const char* path, u64 capacity, log_ring* out_ring){
+    platform_zero_memory(out_ring, sizeof(log_ring));
+    if(capacity == 0 || !platform_file_map_writable(path, sizeof(log_ring_header) + capacity, &out_ring->mapping)){
+        return false;
+    }
+
+    out_ring->header = out_ring->mapping.memory;
+    out_ring->text = (char*)out_ring->mapping.memory + sizeof(log_ring_header);
+    // Whatever the file held before is stale, starting over.
+    platform_zero_memory(out_ring->header, sizeof(log_ring_header));
+    out_ring->header->magic = LOG_RING_MAGIC;
+    out_ring->header->version = LOG_RING_VERSION;
+    out_ring->header->header_size = sizeof(log_ring_header);
+    out_ring->header->capacity = capacity;
+    return true;
+}
+
+void log_ring_destroy(log_ring* ring){
+    if(ring && ring->header){
+        platform_file_unmap(&ring->mapping);
+        ring->header = 0;
+        ring->text = 0;
+    }
+}
+
+void log_ring_write(log_ring* ring, const char* text, u64 length){
+    if(!ring->header || length == 0){
+        return;
+    }
+    u64 capacity = ring->header->capacity;
+    // Reserving the span first lets any number of threads write at once, each into its own bytes.
+    u64 position = __atomic_fetch_add(&ring->header->write_position, length, __ATOMIC_ACQ_REL);
+    // Only the tail of a line longer than the ring fits.
+    if(length > capacity){
+        text += length - capacity;
+        position += length - capacity;
+        length = capacity;
+    }
+
+    u64 offset = position % capacity;
+    u64 first = capacity - offset < length ? capacity - offset : length;
+    platform_copy_memory(ring->text + offset, text, first);
+    platform_copy_memory(ring->text, text + first, length - first);
+}
+
+b8 log_ring_decode(const void* data, u64 size, string_builder* out_text){
+    if(size < sizeof(log_ring_header)){
+        return false;
+    }
+    // The data may come from anywhere, read the header without assuming its alignment.
+    log_ring_header header;
+    platform_copy_memory(&header, data, sizeof(log_ring_header));
+    if(header.magic != LOG_RING_MAGIC
+        || header.version != LOG_RING_VERSION
+        || header.header_size < sizeof(log_ring_header)
+        || header.header_size > size
+        || header.capacity == 0
+        || header.capacity > size - header.header_size){
+        return false;
+    }
+
+    const char* text = (const char*)data + header.header_size;
+    u64 capacity = header.capacity;
+    u64 written = header.write_position;
+    if(written <= capacity){
+        string_builder_append_n(out_text, text, written);
+        return true;
+    }
+
+    // Wrapped: the oldest byte is the next one to be overwritten.
+    u64 start = written % capacity;
+    u64 skip = start;
+    while(skip < capacity && text[skip] != '\n'){
+        skip++;
+    }
+    if(skip < capacity){
+        string_builder_append_n(out_text, text + skip + 1, capacity - skip - 1);
+        string_builder_append_n(out_text, text, start);
+    }else{
+        // The cut line runs past the wrap.
+        u64 end = 0;
+        while(end < start && text[end] != '\n'){
+            end++;
+        }
+        if(end < start){
+            string_builder_append_n(out_text, text + end + 1, start - end - 1);
+        }
+    }
+    return true;
+}
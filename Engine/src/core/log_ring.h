@@ -0,0 +1,61 @@
+#pragma once
+
+#include "defines.h"
+#include "platform/platform.h"
+
+struct string_builder;
+
+/*
+    A fixed size ring of log text kept in a memory mapped file. Writing a line is a copy into the
+    mapping, no system call, and since the pages belong to the file the OS writes them out even if
+    the process crashes right after. The newest capacity bytes of the log survive, the older ones
+    are overwritten.
+
+    File layout (little endian)
+    log_ring_header
+    char[capacity], text wrapping around at capacity
+*/
+
+#define LOG_RING_MAGIC 0x474C4B50 // "PKLG"
+#define LOG_RING_VERSION 1
+
+typedef struct log_ring_header{
+    u32 magic;
+    u32 version;
+    u32 header_size;
+    u32 reserved;
+    u64 capacity;
+    // Bytes written since the ring was created, the next byte goes at write_position % capacity.
+    // Moved before the text is copied, so a crash mid write can leave the newest line partly written.
+    u64 write_position;
+} log_ring_header;
+
+typedef struct log_ring{
+    platform_file_mapping mapping;
+    log_ring_header* header;
+    char* text;
+} log_ring;
+
+/**
+ * Creates (or replaces) the ring file at path and maps it.
+ * @param path The path of the file.
+ * @param capacity The number of bytes of text it keeps.
+ * @param out_ring A pointer to hold the ring.
+ * @returns True if the file could be created and mapped; otherwise false.
+ */
+b8 log_ring_create(const char* path, u64 capacity, log_ring* out_ring);
+void log_ring_destroy(log_ring* ring);
+
+// Appends the text to the ring. Safe from any number of threads at once, lines never interleave
+// as long as the ring holds more than the text being written meanwhile.
+void log_ring_write(log_ring* ring, const char* text, u64 length);
+
+/**
+ * Extracts the text of a ring file, oldest line first. Once the ring has wrapped, the oldest
+ * line, cut by the wrap, is skipped.
+ * @param data The contents of a ring file.
+ * @param size The size of data in bytes.
+ * @param out_text The builder to append the text to.
+ * @returns True if data is a valid ring file; otherwise false.
+ */
+PANCAKE_API b8 log_ring_decode(const void* data, u64 size, struct string_builder* out_text);
@@ -4,24 +4,627 @@
 #include "platform/filesystem.h"
 #include "pancake_string.h"
 #include "pancake_memory.h"
+#include "string_builder.h"
+#include "log_ring.h"
+#include "containers/ring_queue.h"
+#include "platform/pancake_thread.h"
 
 // TODO: temporary
 #include <stdarg.h>
 
+// Most log lines fit here, longer ones spill over to the heap.
+#define LOG_LINE_STACK_SIZE 1024
+
+// Lines waiting for the writer thread.
+#define LOG_QUEUE_CAPACITY 1024
+// Lines up to this long are copied into the queue, longer ones are handed over on the heap.
+#define LOG_ENTRY_TEXT_SIZE 488
+// The writer gathers lines up to about this size before writing them out.
+#define LOG_WRITER_BATCH_SIZE (64 * 1024)
+
+#define LOG_FILE_NAME "console.log"
+// Rotated files are named console.<n>.log, the highest n being the oldest.
+#define LOG_FILE_ROTATED_FORMAT "console.%u.log"
+#define LOG_FILE_MAX_ROTATED 32
+
+// Every line also goes to this memory mapped ring, which survives crashes (see log_ring.h).
+#define LOG_RING_FILE_NAME "console.ring"
+// The ring of the previous run, kept in case it crashed.
+#define LOG_RING_PREVIOUS_FILE_NAME "console.prev.ring"
+#define LOG_RING_CAPACITY (1024 * 1024)
+
+// How often a line that keeps repeating is reported, in seconds.
+#define LOG_REPEAT_REPORT_INTERVAL 1.0
+
+typedef struct log_entry{
+    u8 level;
+    u32 length;
+    // When the line was logged, taken on the calling thread.
+    f64 time;
+    // Set when the line did not fit in text, freed by the writer.
+    char* long_text;
+    // Set for deferred lines: text then holds the raw arguments, formatted by the writer.
+    const char* format;
+    const log_callsite* site;
+    union{
+        char text[LOG_ENTRY_TEXT_SIZE];
+        // One word per argument, followed by the characters of the string arguments.
+        u64 words[LOG_ENTRY_TEXT_SIZE / sizeof(u64)];
+    };
+}log_entry;
+
+// Raw argument types of deferred lines, as read with va_arg.
+typedef enum log_arg_type{
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LONG_LONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING
+}log_arg_type;
+
+// log_callsite.state
+#define LOG_CALLSITE_UNPARSED 0
+#define LOG_CALLSITE_PARSING 1
+#define LOG_CALLSITE_PARSED 2
+// log_callsite.arg_count of formats that can't be deferred (%n, long double, too many arguments...).
+#define LOG_CALLSITE_NOT_DEFERRABLE 0xFF
+// log_callsite.string_precisions of strings without one, and of those taking it from the '*' argument before.
+#define LOG_PRECISION_NONE 0xFFFF
+#define LOG_PRECISION_ARG 0xFFFE
+
+static const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
+
 typedef struct logger_system_state{
     file_handle log_file_handle;
+    // Read by the writer, stored field by field by log_configure_file.
+    log_file_config file_config;
+    // Bytes in console.log since it was opened, and when it was opened / last flushed.
+    u64 file_size;
+    f64 file_open_time;
+    f64 file_flush_time;
+    log_ring ring;
+    // Lines are stamped with the seconds since then.
+    f64 start_time;
+
+    // Formatted lines are queued by any thread and written by the writer thread.
+    ring_queue queue;
+    pancake_thread writer;
+    b8 writer_running;
+    // Lines the writer logs itself are written on the spot, it can't wait on its own queue.
+    u64 writer_thread_id;
+    // Lines queued/written so far, log_flush waits for the second to catch up with the first.
+    u64 queued_count;
+    u64 written_count;
+    // log_flush asks the writer to flush the file too, and waits for it to say it is done.
+    u64 flush_requests;
+    u64 flush_done;
 }logger_system_state;
 
 static logger_system_state* state_ptr;
 
-void append_message_to_file(const char* message){
+// Outside of the state, the macros read it before (and after) the logger is up.
+u8 log_category_levels[LOG_CATEGORIES_MAX] = {[0 ... LOG_CATEGORIES_MAX - 1] = LOG_LEVEL_TRACE};
+static u8 log_level_global = LOG_LEVEL_TRACE;
+static const char* log_category_names[LOG_CATEGORIES_MAX] = {"general"};
+static u32 log_category_count = 1;
+// Categories given their own level, one bit each.
+static u32 log_category_overrides;
+static u32 log_rate_limit = LOG_RATE_LIMIT_DEFAULT;
+
+static void log_output_unfiltered(log_level level, const char* message, ...);
+
+void append_message_to_file(const char* message, u64 length){
     if(state_ptr && state_ptr->log_file_handle.is_valid){
         //Store the message already containes a "\n", just write the bytes directly
-        u64 length = string_length(message);
         u64 written = 0;
         if(!filesystem_write(&state_ptr->log_file_handle, length, message, &written)){
             platform_console_write_error("Error : Unable to write to 'console.log'.", LOG_LEVEL_ERROR);
         }
+        state_ptr->file_size += written;
+    }
+}
+
+static b8 log_file_open(){
+    if(!filesystem_open(LOG_FILE_NAME, FILE_MODE_WRITE, false, &state_ptr->log_file_handle)){
+        platform_console_write_error("Error : Unable to to open console.log for writing.", LOG_LEVEL_ERROR);
+        return false;
+    }
+    state_ptr->file_size = 0;
+    state_ptr->file_open_time = platform_get_absolute_time();
+    state_ptr->file_flush_time = state_ptr->file_open_time;
+    return true;
+}
+
+// Moves console.log to console.1.log, console.1.log to console.2.log... dropping the oldest, and starts a new console.log.
+static void log_file_rotate(){
+    u32 max_files = __atomic_load_n(&state_ptr->file_config.max_files, __ATOMIC_RELAXED);
+    if(max_files > LOG_FILE_MAX_ROTATED){
+        max_files = LOG_FILE_MAX_ROTATED;
+    }
+
+    filesystem_close(&state_ptr->log_file_handle);
+    if(max_files == 0){
+        filesystem_delete(LOG_FILE_NAME);
+    }else{
+        char from[32];
+        char to[32];
+        string_format(to, LOG_FILE_ROTATED_FORMAT, max_files);
+        filesystem_delete(to);
+        for(u32 i = max_files - 1; i > 0; --i){
+            string_format(from, LOG_FILE_ROTATED_FORMAT, i);
+            string_format(to, LOG_FILE_ROTATED_FORMAT, i + 1);
+            if(filesystem_exists(from)){
+                filesystem_rename(from, to);
+            }
+        }
+        string_format(to, LOG_FILE_ROTATED_FORMAT, 1);
+        filesystem_rename(LOG_FILE_NAME, to);
+    }
+    log_file_open();
+}
+
+// Hands what was written to console.log over to the OS, then rotates it if it is due.
+static void log_file_flush(){
+    if(!state_ptr->log_file_handle.is_valid){
+        return;
+    }
+    filesystem_flush(&state_ptr->log_file_handle);
+    f64 now = platform_get_absolute_time();
+    state_ptr->file_flush_time = now;
+
+    u64 rotate_bytes = __atomic_load_n(&state_ptr->file_config.rotate_bytes, __ATOMIC_RELAXED);
+    u32 rotate_seconds = __atomic_load_n(&state_ptr->file_config.rotate_interval_seconds, __ATOMIC_RELAXED);
+    if((rotate_bytes && state_ptr->file_size >= rotate_bytes)
+        || (rotate_seconds && now - state_ptr->file_open_time >= rotate_seconds)){
+        log_file_rotate();
+    }
+}
+
+// Writes the batch to the file in one go.
+static void log_file_write_batch(string_builder* file_batch){
+    if(file_batch->length){
+        append_message_to_file(file_batch->data, file_batch->length);
+        string_builder_clear(file_batch);
+    }
+    log_file_flush();
+}
+
+static void write_to_console(const char* text, u8 level){
+    if(level < LOG_LEVEL_WARN){
+        platform_console_write_error(text, level);
+    }else{
+        platform_console_write(text, level);
+    }
+}
+
+// Appends the time stamp lines start with: "[seconds since the logger started] ". Lines logged
+// before the logger is up (or after it is gone) have none.
+static void log_append_time(string_builder* out, f64 time){
+    if(state_ptr){
+        f64 start = state_ptr->start_time;
+        string_builder_append_format(out, "[%11.6f] ", time > start ? time - start : 0.0);
+    }
+}
+
+static b8 is_conversion(char c){
+    switch(c){
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        case 's': case 'p': case 'n':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Formats a deferred line, one conversion at a time with the argument stored for it.
+static void log_format_deferred(const log_entry* entry, string_builder* out){
+    string_builder_append(out, level_strings[entry->level]);
+
+    const u8* types = entry->site->arg_types;
+    u32 arg = 0;
+    const char* p = entry->format;
+    while(*p){
+        const char* literal = p;
+        while(*p && *p != '%'){
+            p++;
+        }
+        string_builder_append_n(out, literal, p - literal);
+        if(!*p){
+            break;
+        }
+        if(p[1] == '%'){
+            string_builder_append_char(out, '%');
+            p += 2;
+            continue;
+        }
+
+        // Copy the conversion, with the values of '*' written in.
+        char spec[64];
+        u32 length = 0;
+        spec[length++] = *p++;
+        while(*p && !is_conversion(*p) && length < sizeof(spec) - 16){
+            if(*p == '*'){
+                length += string_format(spec + length, "%d", (i32)entry->words[arg++]);
+            }else{
+                spec[length++] = *p;
+            }
+            p++;
+        }
+        if(!*p){
+            break;
+        }
+        spec[length++] = *p++;
+        spec[length] = 0;
+
+        u64 word = entry->words[arg];
+        switch(types[arg]){
+            case LOG_ARG_INT: string_builder_append_format(out, spec, (int)word); break;
+            case LOG_ARG_LONG: string_builder_append_format(out, spec, (long)word); break;
+            case LOG_ARG_LONG_LONG: string_builder_append_format(out, spec, (long long)word); break;
+            case LOG_ARG_SIZE: string_builder_append_format(out, spec, (__SIZE_TYPE__)word); break;
+            case LOG_ARG_POINTER: string_builder_append_format(out, spec, (void*)(__UINTPTR_TYPE__)word); break;
+            case LOG_ARG_STRING: string_builder_append_format(out, spec, entry->text + word); break;
+            case LOG_ARG_DOUBLE: {
+                f64 value;
+                platform_copy_memory(&value, &word, sizeof(value));
+                string_builder_append_format(out, spec, value);
+            } break;
+        }
+        arg++;
+    }
+    string_builder_append_char(out, '\n');
+}
+
+typedef struct log_writer{
+    // Consecutive lines of the same level, printed in one call.
+    string_builder console_run;
+    u8 run_level;
+    // Lines waiting to be written to the file.
+    string_builder file_batch;
+    // The line being written, time stamp first.
+    string_builder line;
+    // The last line written, and how many times it came again since, not written yet.
+    string_builder last_line;
+    u8 last_level;
+    u32 repeat_count;
+    f64 repeat_time;
+}log_writer;
+
+// Sends a line to the console run, the ring and the file batch.
+static void log_writer_emit(log_writer* writer, u8 level, const char* text, u64 length){
+    string_builder* console_run = &writer->console_run;
+    if(console_run->length && (level != writer->run_level || console_run->length >= LOG_WRITER_BATCH_SIZE)){
+        write_to_console(console_run->data, writer->run_level);
+        string_builder_clear(console_run);
+    }
+    writer->run_level = level;
+    string_builder_append_n(console_run, text, length);
+    log_ring_write(&state_ptr->ring, text, length);
+
+    // The batch stays within its buffer (a longer line skips it), so the builder never grows.
+    string_builder* file_batch = &writer->file_batch;
+    if(file_batch->length + length >= file_batch->capacity){
+        log_file_write_batch(file_batch);
+    }
+    if(length >= file_batch->capacity){
+        append_message_to_file(text, length);
+    }else{
+        string_builder_append_n(file_batch, text, length);
+    }
+    if(file_batch->length >= __atomic_load_n(&state_ptr->file_config.flush_bytes, __ATOMIC_RELAXED)){
+        log_file_write_batch(file_batch);
+    }
+}
+
+// Writes how many times the last line came again, if it did.
+static void log_writer_report_repeats(log_writer* writer){
+    if(writer->repeat_count == 0){
+        return;
+    }
+    char buffer[128];
+    string_builder line;
+    string_builder_create_from_buffer_untracked(buffer, sizeof(buffer), &line);
+    log_append_time(&line, platform_get_absolute_time());
+    string_builder_append_format(&line, "%sLast message repeated %u times.\n", level_strings[writer->last_level], writer->repeat_count);
+    log_writer_emit(writer, writer->last_level, line.data, line.length);
+    string_builder_destroy(&line);
+    writer->repeat_count = 0;
+}
+
+// Writes the line, unless it is the same as the last one (time stamps aside), which is only counted.
+static void log_writer_write(log_writer* writer, u8 level, const char* text, u64 length, u64 stamp_length){
+    string_builder* last_line = &writer->last_line;
+    const char* message = text + stamp_length;
+    u64 message_length = length - stamp_length;
+    if(level == writer->last_level && message_length == last_line->length && strings_nequal(message, last_line->data, message_length)){
+        if(writer->repeat_count++ == 0){
+            writer->repeat_time = platform_get_absolute_time();
+        }
+        return;
+    }
+
+    log_writer_report_repeats(writer);
+    log_writer_emit(writer, level, text, length);
+    writer->last_level = level;
+    string_builder_clear(last_line);
+    // Only lines that fit are compared, so the builder never grows.
+    if(message_length < last_line->capacity){
+        string_builder_append_n(last_line, message, message_length);
+    }
+}
+
+// Writes out everything queued so far. Lines for the file are gathered in the file batch, written
+// whenever flush_bytes are waiting (see log_writer_drain_all for the rest).
+// Returns the number of lines taken from the queue.
+static u64 log_writer_drain(log_writer* writer){
+    u64 count = 0;
+    log_entry entry;
+    while(ring_queue_pop(&state_ptr->queue, &entry)){
+        string_builder* line = &writer->line;
+        string_builder_clear(line);
+        log_append_time(line, entry.time);
+        u64 stamp_length = line->length;
+        if(entry.format){
+            log_format_deferred(&entry, line);
+        }else{
+            string_builder_append_n(line, entry.long_text ? entry.long_text : entry.text, entry.length);
+        }
+        log_writer_write(writer, entry.level, line->data, line->length, stamp_length);
+        if(entry.long_text){
+            platform_free(entry.long_text, false);
+        }
+        count++;
+    }
+
+    if(writer->console_run.length){
+        write_to_console(writer->console_run.data, writer->run_level);
+        string_builder_clear(&writer->console_run);
+    }
+    if(count){
+        __atomic_add_fetch(&state_ptr->written_count, count, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+// Drains the queue with batch buffers taken straight from the platform (see log_enqueue).
+static void log_writer_drain_all(b8 keep_running){
+    u64 buffer_size = LOG_WRITER_BATCH_SIZE + LOG_LINE_STACK_SIZE;
+    char* console_buffer = platform_allocate(buffer_size, false);
+    char* file_buffer = platform_allocate(buffer_size, false);
+    char line_buffer[LOG_LINE_STACK_SIZE];
+    char last_line_buffer[LOG_LINE_STACK_SIZE];
+    log_writer writer = {0};
+    string_builder_create_from_buffer_untracked(console_buffer, buffer_size, &writer.console_run);
+    string_builder_create_from_buffer_untracked(file_buffer, buffer_size, &writer.file_batch);
+    string_builder_create_from_buffer_untracked(line_buffer, sizeof(line_buffer), &writer.line);
+    string_builder_create_from_buffer_untracked(last_line_buffer, sizeof(last_line_buffer), &writer.last_line);
+
+    for(;;){
+        // Read the flag and the flush requests first, so nothing queued before them is left behind.
+        b8 running = keep_running && __atomic_load_n(&state_ptr->writer_running, __ATOMIC_ACQUIRE);
+        u64 flush_request = __atomic_load_n(&state_ptr->flush_requests, __ATOMIC_ACQUIRE);
+        u64 drained = log_writer_drain(&writer);
+
+        // A line repeating for a while is reported every LOG_REPEAT_REPORT_INTERVAL.
+        b8 requested = flush_request != __atomic_load_n(&state_ptr->flush_done, __ATOMIC_RELAXED);
+        f64 now = platform_get_absolute_time();
+        if(writer.repeat_count && (requested || !running || now - writer.repeat_time >= LOG_REPEAT_REPORT_INTERVAL)){
+            log_writer_report_repeats(&writer);
+            write_to_console(writer.console_run.data, writer.run_level);
+            string_builder_clear(&writer.console_run);
+        }
+
+        // Whatever is left in the batch waits for more lines, up to flush_interval_ms.
+        u32 interval_ms = __atomic_load_n(&state_ptr->file_config.flush_interval_ms, __ATOMIC_RELAXED);
+        if(requested || !running
+            || (writer.file_batch.length && (now - state_ptr->file_flush_time) * 1000.0 >= interval_ms)){
+            log_file_write_batch(&writer.file_batch);
+        }
+        if(requested){
+            __atomic_store_n(&state_ptr->flush_done, flush_request, __ATOMIC_RELEASE);
+        }
+
+        if(drained == 0){
+            if(!running){
+                break;
+            }
+            platform_sleep(1);
+        }
+    }
+
+    string_builder_destroy(&writer.console_run);
+    string_builder_destroy(&writer.file_batch);
+    string_builder_destroy(&writer.line);
+    string_builder_destroy(&writer.last_line);
+    platform_free(console_buffer, false);
+    platform_free(file_buffer, false);
+}
+
+static u32 log_writer_run(void* params){
+    __atomic_store_n(&state_ptr->writer_thread_id, pancake_thread_current_id(), __ATOMIC_RELEASE);
+    log_writer_drain_all(true);
+    return 0;
+}
+
+// True if lines logged by the calling thread can be handed over to the writer thread.
+static b8 log_writer_available(){
+    return state_ptr
+        && __atomic_load_n(&state_ptr->writer_running, __ATOMIC_ACQUIRE)
+        && pancake_thread_current_id() != __atomic_load_n(&state_ptr->writer_thread_id, __ATOMIC_ACQUIRE);
+}
+
+void log_flush(){
+    if(!state_ptr){
+        return;
+    }
+    if(!log_writer_available()){
+        log_file_flush();
+        return;
+    }
+    u64 target = __atomic_load_n(&state_ptr->queued_count, __ATOMIC_ACQUIRE);
+    u64 request = __atomic_add_fetch(&state_ptr->flush_requests, 1, __ATOMIC_ACQ_REL);
+    while(__atomic_load_n(&state_ptr->written_count, __ATOMIC_ACQUIRE) < target
+        || __atomic_load_n(&state_ptr->flush_done, __ATOMIC_ACQUIRE) < request){
+        pancake_thread_yield();
+    }
+}
+
+void log_set_level(log_level level){
+    log_level_global = level;
+    for(u32 i = 0; i < LOG_CATEGORIES_MAX; ++i){
+        if(!(log_category_overrides & (1u << i))){
+            log_category_levels[i] = level;
+        }
+    }
+}
+
+log_level log_get_level(){
+    return log_level_global;
+}
+
+log_category log_category_register(const char* name){
+    for(u32 i = 0; i < log_category_count; ++i){
+        if(strings_equal(log_category_names[i], name)){
+            return (log_category)i;
+        }
+    }
+    if(log_category_count == LOG_CATEGORIES_MAX){
+        PANCAKE_ERROR("log_category_register - all %d categories are in use.", LOG_CATEGORIES_MAX);
+        return INVALID_LOG_CATEGORY;
+    }
+    log_category_names[log_category_count] = name;
+    return (log_category)log_category_count++;
+}
+
+void log_category_set_level(log_category category, log_level level){
+    if(category >= LOG_CATEGORIES_MAX) return;
+
+    log_category_overrides |= 1u << category;
+    log_category_levels[category] = level;
+}
+
+void log_category_reset_level(log_category category){
+    if(category >= LOG_CATEGORIES_MAX) return;
+
+    log_category_overrides &= ~(1u << category);
+    log_category_levels[category] = log_level_global;
+}
+
+void log_set_rate_limit(u32 lines_per_second){
+    __atomic_store_n(&log_rate_limit, lines_per_second, __ATOMIC_RELAXED);
+}
+
+u32 log_get_rate_limit(){
+    return __atomic_load_n(&log_rate_limit, __ATOMIC_RELAXED);
+}
+
+b8 log_callsite_admit(log_callsite* site, log_level level, const char* format){
+    u32 limit = __atomic_load_n(&log_rate_limit, __ATOMIC_RELAXED);
+    if(limit == 0 || level == LOG_LEVEL_FATAL){
+        return true;
+    }
+
+    u32 now = (u32)platform_get_absolute_time();
+    u32 window = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+    if(window != now && __atomic_compare_exchange_n(&site->window, &window, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        // First line of a new second, the thread moving the window on reports what the last one dropped.
+        u32 count = __atomic_exchange_n(&site->count, 1, __ATOMIC_RELAXED);
+        if(count > limit){
+            log_output_unfiltered(level, "Suppressed %u lines like \"%s\" (over %u per second).", count - limit, format, limit);
+        }
+        return true;
+    }
+    // Approximate when racing a window change, which is fine for a limit.
+    return __atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) <= limit;
+}
+
+void log_configure_file(const log_file_config* config){
+    if(!state_ptr || !config){
+        return;
+    }
+    log_file_config* current = &state_ptr->file_config;
+    u64 flush_bytes = config->flush_bytes < LOG_WRITER_BATCH_SIZE ? config->flush_bytes : LOG_WRITER_BATCH_SIZE;
+    __atomic_store_n(&current->flush_bytes, flush_bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&current->flush_interval_ms, config->flush_interval_ms, __ATOMIC_RELAXED);
+    __atomic_store_n(&current->rotate_bytes, config->rotate_bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&current->rotate_interval_seconds, config->rotate_interval_seconds, __ATOMIC_RELAXED);
+    __atomic_store_n(&current->max_files, config->max_files, __ATOMIC_RELAXED);
+}
+
+// Appends count bytes to a crash line, cut at capacity. A plain loop, safe in a signal handler.
+static u64 log_crash_append(char* line, u64 length, u64 capacity, const char* text, u64 count){
+    for(u64 i = 0; i < count && length < capacity; ++i){
+        line[length++] = text[i];
+    }
+    return length;
+}
+
+static u64 log_crash_length(const char* text){
+    u64 length = 0;
+    while(text[length]){
+        length++;
+    }
+    return length;
+}
+
+// The time stamp of log_append_time, "[%11.6f] ", written out digit by digit: no stdio.
+static u64 log_crash_append_time(char* line, u64 length, u64 capacity, f64 time){
+    f64 seconds = time > state_ptr->start_time ? time - state_ptr->start_time : 0.0;
+    u64 micros = (u64)(seconds * 1000000.0 + 0.5);
+    char digits[32];
+    u32 count = 0;
+    for(u32 i = 0; i < 6; ++i){
+        digits[count++] = '0' + micros % 10;
+        micros /= 10;
+    }
+    digits[count++] = '.';
+    do{
+        digits[count++] = '0' + micros % 10;
+        micros /= 10;
+    }while(micros && count < sizeof(digits));
+    while(count < 11){
+        digits[count++] = ' ';
+    }
+
+    length = log_crash_append(line, length, capacity, "[", 1);
+    while(count){
+        length = log_crash_append(line, length, capacity, &digits[--count], 1);
+    }
+    return log_crash_append(line, length, capacity, "] ", 2);
+}
+
+// Runs on the crashing thread, inside a signal handler: the lines still queued are copied to the
+// ring, the one output that outlives the process. Only bytes already there are copied, no
+// formatting and no allocation, either could deadlock on the lock held by the code that crashed.
+// Deferred lines are not formatted yet, their format string is written instead, tagged.
+// The writer may still be draining meanwhile, the ring takes writes from both at once.
+static void log_on_crash(){
+    if(!state_ptr || !state_ptr->ring.header){
+        return;
+    }
+    static const char deferred_tag[] = "(not formatted, crashed first) ";
+    char line[LOG_LINE_STACK_SIZE];
+    log_entry entry;
+    while(ring_queue_pop(&state_ptr->queue, &entry)){
+        u64 length = log_crash_append_time(line, 0, sizeof(line), entry.time);
+        if(entry.format){
+            const char* level = level_strings[entry.level];
+            length = log_crash_append(line, length, sizeof(line), level, log_crash_length(level));
+            length = log_crash_append(line, length, sizeof(line), deferred_tag, sizeof(deferred_tag) - 1);
+            length = log_crash_append(line, length, sizeof(line) - 1, entry.format, log_crash_length(entry.format));
+            line[length++] = '\n';
+            log_ring_write(&state_ptr->ring, line, length);
+        }else if(entry.long_text){
+            // Left to the OS afterwards, the process is going away.
+            log_ring_write(&state_ptr->ring, line, length);
+            log_ring_write(&state_ptr->ring, entry.long_text, entry.length);
+        }else{
+            length = log_crash_append(line, length, sizeof(line), entry.text, entry.length);
+            log_ring_write(&state_ptr->ring, line, length);
+        }
     }
 }
 
@@ -32,53 +635,342 @@ b8 initialize_logging_system(u64* required_memory, void* state) {
     }
 
     state_ptr = state;
+    state_ptr->start_time = platform_get_absolute_time();
 
-    // TODO: create log file.
-    if(!filesystem_open("console.log", FILE_MODE_WRITE, false, &state_ptr->log_file_handle)){
-        platform_console_write_error("Error : Unable to to open console.log for writing.", LOG_LEVEL_ERROR);
+    state_ptr->file_config.flush_bytes = LOG_WRITER_BATCH_SIZE;
+    state_ptr->file_config.flush_interval_ms = 100;
+    state_ptr->file_config.rotate_bytes = 16 * 1024 * 1024;
+    state_ptr->file_config.rotate_interval_seconds = 0;
+    state_ptr->file_config.max_files = 4;
+    if(!log_file_open()){
         return false;
     }
+
+    if(filesystem_exists(LOG_RING_FILE_NAME)){
+        filesystem_rename(LOG_RING_FILE_NAME, LOG_RING_PREVIOUS_FILE_NAME);
+    }
+    if(!log_ring_create(LOG_RING_FILE_NAME, LOG_RING_CAPACITY, &state_ptr->ring)){
+        platform_console_write_error("Error : Unable to map console.ring, logging without it.\n", LOG_LEVEL_ERROR);
+    }
+
+    // Until the writer runs (or if it can't be started) lines are written by the thread logging them.
+    state_ptr->writer_running = false;
+    state_ptr->writer_thread_id = 0;
+    state_ptr->queued_count = 0;
+    state_ptr->written_count = 0;
+    state_ptr->flush_requests = 0;
+    state_ptr->flush_done = 0;
+    ring_queue_create(sizeof(log_entry), LOG_QUEUE_CAPACITY, &state_ptr->queue);
+    __atomic_store_n(&state_ptr->writer_running, true, __ATOMIC_RELEASE);
+    if(!pancake_thread_create(log_writer_run, 0, &state_ptr->writer)){
+        __atomic_store_n(&state_ptr->writer_running, false, __ATOMIC_RELEASE);
+        platform_console_write_error("Error : Unable to start the log writer thread, logging synchronously.\n", LOG_LEVEL_ERROR);
+    }
+    platform_set_crash_handler(log_on_crash);
     return true;
 }
 
 void shutdown_logging_system(void* state) {
-    // TODO: cleanup logging/write queued entries.
+    if(!state_ptr){
+        return;
+    }
+    platform_set_crash_handler(0);
+    if(state_ptr->writer_running){
+        // The writer drains the queue before exiting.
+        __atomic_store_n(&state_ptr->writer_running, false, __ATOMIC_RELEASE);
+        pancake_thread_wait(&state_ptr->writer);
+        // Lines queued by other threads while the writer was exiting.
+        log_writer_drain_all(false);
+    }
+    ring_queue_destroy(&state_ptr->queue);
+    log_file_flush();
+    filesystem_close(&state_ptr->log_file_handle);
+    log_ring_destroy(&state_ptr->ring);
     state_ptr = 0;
 }
 
-void log_output(log_level level, const char* message, ...) {
-    // TODO: These string operations are all pretty slow. This needs to be
-    // moved to another thread eventually, along with the file writes, to
-    // avoid slowing things down while the engine is trying to run.
-    const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
-    b8 is_error = level < LOG_LEVEL_WARN;
+static void log_push(const log_entry* entry){
+    // Never drop a line, wait for the writer to make room.
+    while(!ring_queue_push(&state_ptr->queue, entry)){
+        pancake_thread_yield();
+    }
+    __atomic_add_fetch(&state_ptr->queued_count, 1, __ATOMIC_RELEASE);
+}
 
-    // Technically imposes a 32k character limit on a single log entry, but...
-    // DON'T DO THAT!
-    char out_message[32000];
-    pancake_zero_memory(out_message, sizeof(out_message));
+// Hands the line over to the writer thread. Returns false if it is not running.
+static b8 log_enqueue(log_level level, f64 time, const char* text, u64 length){
+    if(!log_writer_available()){
+        return false;
+    }
+
+    log_entry entry;
+    entry.level = level;
+    entry.time = time;
+    entry.length = length;
+    entry.format = 0;
+    entry.site = 0;
+    if(length < LOG_ENTRY_TEXT_SIZE){
+        entry.long_text = 0;
+        platform_copy_memory(entry.text, text, length + 1);
+    }else{
+        // Straight from the platform, the memory system's counters are not thread safe.
+        entry.long_text = platform_allocate(length + 1, false);
+        platform_copy_memory(entry.long_text, text, length + 1);
+    }
+
+    log_push(&entry);
+    return true;
+}
+
+// Writes a line, time stamp first, from the calling thread: there is no writer thread to hand it to (or this is it).
+static void log_write_direct(log_level level, f64 time, const char* text, u64 length){
+    char line_buffer[LOG_LINE_STACK_SIZE];
+    string_builder line;
+    string_builder_create_from_buffer_untracked(line_buffer, sizeof(line_buffer), &line);
+    log_append_time(&line, time);
+    string_builder_append_n(&line, text, length);
+
+    write_to_console(line.data, level);
+    if(state_ptr){
+        log_ring_write(&state_ptr->ring, line.data, line.length);
+    }
+    append_message_to_file(line.data, line.length);
+    if(level <= LOG_LEVEL_ERROR && state_ptr){
+        log_file_flush();
+    }
+    string_builder_destroy(&line);
+}
+
+// Formats the line on the calling thread; the console and file output is left to the writer thread.
+static void log_output_v(log_level level, const char* message, __builtin_va_list arg_ptr) {
+    f64 time = platform_get_absolute_time();
+
+    // Build "<level><message>\n" in one pass, formatting straight after the prefix.
+    char line_buffer[LOG_LINE_STACK_SIZE];
+    string_builder line;
+    string_builder_create_from_buffer_untracked(line_buffer, sizeof(line_buffer), &line);
+    string_builder_append(&line, level_strings[level]);
 
     // Format original message.
+    string_builder_append_format_v(&line, message, arg_ptr);
+
+    string_builder_append_char(&line, '\n');
+
+    if(!log_enqueue(level, time, line.data, line.length)){
+        log_write_direct(level, time, line.data, line.length);
+    }
+
+    string_builder_destroy(&line);
+
+    // Whatever happens next (abort, crash), the fatal message and everything before it is out.
+    if(level == LOG_LEVEL_FATAL){
+        log_flush();
+    }
+}
+
+// log_output without the level check, for the logger's own lines.
+static void log_output_unfiltered(log_level level, const char* message, ...) {
+    __builtin_va_list arg_ptr;
+    va_start(arg_ptr, message);
+    log_output_v(level, message, arg_ptr);
+    va_end(arg_ptr);
+}
+
+void log_output(log_level level, const char* message, ...) {
     // NOTE: Oddly enough, MS's headers override the GCC/Clang va_list type with a "typedef char* va_list" in some
     // cases, and as a result throws a strange error here. The workaround for now is to just use __builtin_va_list,
     // which is the type GCC/Clang's va_start expects.
+    if(!PANCAKE_LOG_ENABLED(LOG_CATEGORY_GENERAL, level)){
+        return;
+    }
     __builtin_va_list arg_ptr;
     va_start(arg_ptr, message);
-    string_format_v(out_message, message, arg_ptr);
+    log_output_v(level, message, arg_ptr);
     va_end(arg_ptr);
+}
+
+// Works out the va_arg type of every argument of format, once per callsite.
+static void log_parse_format(const char* format, log_callsite* out){
+    u8 count = 0;
+    for(const char* p = format; *p; ++p){
+        if(*p != '%'){
+            continue;
+        }
+        p++;
+        if(*p == '%'){
+            continue;
+        }
+
+        // flags, width and precision, '*' takes an int argument
+        while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'){
+            p++;
+        }
+        u16 precision = LOG_PRECISION_NONE;
+        for(u32 part = 0; part < 2; ++part){
+            if(*p == '*'){
+                if(count == LOG_DEFERRED_MAX_ARGS) goto not_deferrable;
+                out->arg_types[count++] = LOG_ARG_INT;
+                p++;
+                precision = part == 1 ? LOG_PRECISION_ARG : precision;
+            }else{
+                // Past the size of an entry the string could never be copied whole anyway.
+                u32 value = 0;
+                while(*p >= '0' && *p <= '9'){
+                    value = value * 10 + (*p - '0');
+                    if(value > LOG_ENTRY_TEXT_SIZE){
+                        value = LOG_ENTRY_TEXT_SIZE;
+                    }
+                    p++;
+                }
+                precision = part == 1 ? (u16)value : precision;
+            }
+            if(part == 0){
+                if(*p != '.') break;
+                p++;
+            }
+        }
+
+        // length
+        u8 type = LOG_ARG_INT;
+        if(*p == 'h'){
+            p += p[1] == 'h' ? 2 : 1;
+        }else if(*p == 'l'){
+            type = p[1] == 'l' ? LOG_ARG_LONG_LONG : LOG_ARG_LONG;
+            p += p[1] == 'l' ? 2 : 1;
+        }else if(*p == 'z' || *p == 't'){
+            type = LOG_ARG_SIZE;
+            p++;
+        }else if(*p == 'j'){
+            type = LOG_ARG_LONG_LONG;
+            p++;
+        }else if(*p == 'L'){
+            goto not_deferrable;
+        }
+
+        switch(*p){
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                break;
+            case 'c':
+                type = LOG_ARG_INT;
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                type = LOG_ARG_DOUBLE;
+                break;
+            case 's':
+                if(type != LOG_ARG_INT) goto not_deferrable;
+                type = LOG_ARG_STRING;
+                break;
+            case 'p':
+                type = LOG_ARG_POINTER;
+                break;
+            default:
+                goto not_deferrable;
+        }
+        if(count == LOG_DEFERRED_MAX_ARGS) goto not_deferrable;
+        out->string_precisions[count] = precision;
+        out->arg_types[count++] = type;
+    }
+    out->arg_count = count;
+    return;
 
-    // Prepend log level to message.
-    string_format(out_message, "%s%s\n", level_strings[level], out_message);
+not_deferrable:
+    out->arg_count = LOG_CALLSITE_NOT_DEFERRABLE;
+}
 
-    // Print accordingly
-    if (is_error) {
-        platform_console_write_error(out_message, level);
-    } else {
-        platform_console_write(out_message, level);
+// Copies the arguments into the entry. False if they don't fit.
+static b8 log_capture_args(const log_callsite* site, log_entry* entry, __builtin_va_list args){
+    u64 strings_offset = site->arg_count * sizeof(u64);
+    for(u32 i = 0; i < site->arg_count; ++i){
+        u64* word = &entry->words[i];
+        switch(site->arg_types[i]){
+            case LOG_ARG_INT: *word = (u64)(i64)va_arg(args, int); break;
+            case LOG_ARG_LONG: *word = (u64)(i64)va_arg(args, long); break;
+            case LOG_ARG_LONG_LONG: *word = (u64)va_arg(args, long long); break;
+            case LOG_ARG_SIZE: *word = (u64)va_arg(args, __SIZE_TYPE__); break;
+            case LOG_ARG_POINTER: *word = (u64)(__UINTPTR_TYPE__)va_arg(args, void*); break;
+            case LOG_ARG_DOUBLE: {
+                f64 value = va_arg(args, double);
+                platform_copy_memory(word, &value, sizeof(value));
+            } break;
+            case LOG_ARG_STRING: {
+                // The string may not outlive the call, keep a copy.
+                const char* str = va_arg(args, const char*);
+                if(!str){
+                    str = "(null)";
+                }
+                // With a precision only that many characters are read, the string may not be
+                // terminated past them (%.*s of a view into a larger buffer).
+                u16 precision = site->string_precisions[i];
+                u64 length;
+                if(precision == LOG_PRECISION_ARG && (i32)entry->words[i - 1] >= 0){
+                    length = string_nlength(str, (i32)entry->words[i - 1]);
+                }else if(precision != LOG_PRECISION_ARG && precision != LOG_PRECISION_NONE){
+                    length = string_nlength(str, precision);
+                }else{
+                    length = string_length(str);
+                }
+                if(strings_offset + length + 1 > LOG_ENTRY_TEXT_SIZE){
+                    return false;
+                }
+                platform_copy_memory(entry->text + strings_offset, str, length);
+                entry->text[strings_offset + length] = 0;
+                *word = strings_offset;
+                strings_offset += length + 1;
+            } break;
+        }
     }
+    return true;
+}
+
+void log_output_deferred(log_callsite* site, log_level level, const char* format, ...) {
+    f64 time = platform_get_absolute_time();
+    __builtin_va_list arg_ptr;
+    va_start(arg_ptr, format);
 
-    //Output a copy to the log file
-    append_message_to_file(out_message);
+    if(log_writer_available()){
+        // Parse once per callsite; threads racing the first parse use their own copy.
+        log_callsite local;
+        const log_callsite* parsed = site;
+        if(__atomic_load_n(&site->state, __ATOMIC_ACQUIRE) != LOG_CALLSITE_PARSED){
+            log_parse_format(format, &local);
+            parsed = &local;
+            u8 expected = LOG_CALLSITE_UNPARSED;
+            if(__atomic_compare_exchange_n(&site->state, &expected, LOG_CALLSITE_PARSING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+                site->arg_count = local.arg_count;
+                platform_copy_memory(site->arg_types, local.arg_types, sizeof(local.arg_types));
+                platform_copy_memory(site->string_precisions, local.string_precisions, sizeof(local.string_precisions));
+                __atomic_store_n(&site->state, LOG_CALLSITE_PARSED, __ATOMIC_RELEASE);
+                parsed = site;
+            }
+        }
+
+        if(parsed->arg_count != LOG_CALLSITE_NOT_DEFERRABLE){
+            // A racing thread's local copy would not outlive the call, the writer needs the callsite.
+            log_entry entry;
+            __builtin_va_list args_copy;
+            va_copy(args_copy, arg_ptr);
+            b8 captured = parsed == site && log_capture_args(site, &entry, args_copy);
+            va_end(args_copy);
+            if(captured){
+                entry.level = level;
+                entry.time = time;
+                entry.length = 0;
+                entry.long_text = 0;
+                entry.format = format;
+                entry.site = site;
+                log_push(&entry);
+                va_end(arg_ptr);
+                if(level == LOG_LEVEL_FATAL){
+                    log_flush();
+                }
+                return;
+            }
+        }
+    }
+
+    // Not deferrable, format it now.
+    log_output_v(level, format, arg_ptr);
+    va_end(arg_ptr);
 }
 
 void report_assertion_failure(const char* expression, const char* message, const char* file, i32 line) {
@@ -2,16 +2,29 @@
 
 #include "defines.h"
 
+#ifndef LOG_WARN_ENABLED
 #define LOG_WARN_ENABLED 1
+#endif
+#ifndef LOG_INFO_ENABLED
 #define LOG_INFO_ENABLED 1
-#define LOG_DEBUG_ENABLED 1
-#define LOG_TRACE_ENABLED 1
+#endif
 
-// Disable debug and trace logging for release builds.
-#if PANCAKE_RELEASE == 1
+// Debug and trace logging is compiled out of release builds (PANCAKE_RELEASE, or no _DEBUG).
+#if PANCAKE_RELEASE == 1 || !defined(_DEBUG)
+#ifndef LOG_DEBUG_ENABLED
 #define LOG_DEBUG_ENABLED 0
+#endif
+#ifndef LOG_TRACE_ENABLED
 #define LOG_TRACE_ENABLED 0
 #endif
+#else
+#ifndef LOG_DEBUG_ENABLED
+#define LOG_DEBUG_ENABLED 1
+#endif
+#ifndef LOG_TRACE_ENABLED
+#define LOG_TRACE_ENABLED 1
+#endif
+#endif
 
 typedef enum log_level {
     LOG_LEVEL_FATAL = 0,
@@ -34,19 +47,147 @@ void shutdown_logging_system();
 b8 initialize_logging_system(u64* required_memory, void* state);
 void shutdown_logging_system(void* state);
 
+/*
+    Lines are formatted by the calling thread and queued; a writer thread prints them and writes
+    them to console.log in batches. Each line is stamped with the time it was logged, taken on the
+    calling thread and written first as "[seconds since the logger started] ". Fatal messages (and assertion failures) flush the queue before
+    returning, so they are never lost to the crash that usually follows.
+*/
 PANCAKE_API void log_output(log_level level, const char* message, ...);
 
+// Blocks until every line logged so far has been written out and console.log is flushed.
+PANCAKE_API void log_flush();
+
+/*
+    console.log is written in large batches: lines wait in memory until flush_bytes of them are
+    pending or the oldest has waited flush_interval_ms. Once the file grows past rotate_bytes (or has
+    been open for rotate_interval_seconds) it is moved to console.1.log, older files shifting up to
+    console.<max_files>.log, and a new console.log is started. 0 turns a rotation limit off.
+    Every line is also copied right away to console.ring, a memory mapped ring that survives crashes
+    (see log_ring.h); the previous run's ring is kept as console.prev.ring.
+*/
+typedef struct log_file_config{
+    u64 flush_bytes;
+    u32 flush_interval_ms;
+    u32 rotate_interval_seconds;
+    u64 rotate_bytes;
+    u32 max_files;
+}log_file_config;
+
+// Changes how console.log is flushed and rotated, defaults: 64KB, 100ms, 16MB, off, 4 files.
+PANCAKE_API void log_configure_file(const log_file_config* config);
+
+/*
+    Deferred formatting: the PANCAKE_* macros don't format on the calling thread. They copy the raw
+    arguments (strings included) next to the format pointer, and the writer thread formats them later.
+    The format must therefore be a string literal. What each argument is gets worked out from the
+    format once per callsite and cached in a static log_callsite.
+    Lines that can't be deferred (%n, long double, more than LOG_DEFERRED_MAX_ARGS arguments, strings
+    too long for a queue entry, or no writer thread) are formatted on the spot as by log_output.
+*/
+#ifndef LOG_DEFERRED_FORMATTING
+#define LOG_DEFERRED_FORMATTING 1
+#endif
+
+#define LOG_DEFERRED_MAX_ARGS 16
+
+typedef struct log_callsite {
+    u8 state;
+    u8 arg_count;
+    u8 arg_types[LOG_DEFERRED_MAX_ARGS];
+    // The precision of the string arguments, the most characters read from them.
+    u16 string_precisions[LOG_DEFERRED_MAX_ARGS];
+    // The second the lines of the callsite are being counted in, and how many there were so far.
+    u32 window;
+    u32 count;
+} log_callsite;
+
+PANCAKE_API void log_output_deferred(log_callsite* site, log_level level, const char* format, ...);
+
+/*
+    Runtime filtering: every line belongs to a category (LOG_CATEGORY_GENERAL for the PANCAKE_*
+    macros), and each category has the most verbose level it lets through. The macros compare
+    against it before the arguments are evaluated, so a filtered out line costs a load and a branch.
+    Levels are meant to be changed from the main thread, e.g. while loading a config or from a console.
+*/
+typedef u8 log_category;
+
+#define LOG_CATEGORY_GENERAL 0
+#define LOG_CATEGORIES_MAX 32
+#define INVALID_LOG_CATEGORY 0xFF
+
+// The most verbose level of each category, indexed by log_category. Change it with log_set_level/log_category_set_level.
+PANCAKE_API extern u8 log_category_levels[LOG_CATEGORIES_MAX];
+
+// Sets the level of every category that wasn't given its own by log_category_set_level.
+PANCAKE_API void log_set_level(log_level level);
+PANCAKE_API log_level log_get_level();
+
+/**
+ * Registers a category, or returns the existing one with that name.
+ * @param name The name of the category, which must outlive the logger (usually a literal).
+ * @returns The category, or INVALID_LOG_CATEGORY if all LOG_CATEGORIES_MAX are in use.
+ */
+PANCAKE_API log_category log_category_register(const char* name);
+
+// Gives the category its own level, no longer following log_set_level.
+PANCAKE_API void log_category_set_level(log_category category, log_level level);
+// Makes the category follow log_set_level again.
+PANCAKE_API void log_category_reset_level(log_category category);
+
+/*
+    Rate limiting: a callsite logs at most log_get_rate_limit() lines per second, the rest are dropped
+    before their arguments are evaluated and reported as one "suppressed" line once the callsite logs
+    again in a later second. Fatal lines are never dropped. On top of that, the writer thread writes
+    a line repeating the previous one as a single "Last message repeated N times." line.
+*/
+#define LOG_RATE_LIMIT_DEFAULT 100
+
+// Sets how many lines per second a callsite may log, 0 for no limit.
+PANCAKE_API void log_set_rate_limit(u32 lines_per_second);
+PANCAKE_API u32 log_get_rate_limit();
+
+// Counts a line of the callsite, false if it is over the rate limit and should be dropped.
+PANCAKE_API b8 log_callsite_admit(log_callsite* site, log_level level, const char* format);
+
+// True if lines of that level get through the category's filter.
+#define PANCAKE_LOG_ENABLED(category, level) ((u8)(level) <= log_category_levels[category])
+
+#if LOG_DEFERRED_FORMATTING == 1
+// Logs at the given level in the given category, formatted later by the writer thread.
+#define PANCAKE_LOG_CATEGORY(category, level, message, ...)                               \
+    do {                                                                                  \
+        static log_callsite pancake_log_callsite;                                         \
+        if (PANCAKE_LOG_ENABLED(category, level)                                          \
+            && log_callsite_admit(&pancake_log_callsite, level, "" message)) {            \
+            log_output_deferred(&pancake_log_callsite, level, "" message, ##__VA_ARGS__); \
+        }                                                                                 \
+    } while (0)
+#else
+#define PANCAKE_LOG_CATEGORY(category, level, message, ...)                   \
+    do {                                                                      \
+        static log_callsite pancake_log_callsite;                             \
+        if (PANCAKE_LOG_ENABLED(category, level)                              \
+            && log_callsite_admit(&pancake_log_callsite, level, message)) {   \
+            log_output(level, message, ##__VA_ARGS__);                        \
+        }                                                                     \
+    } while (0)
+#endif
+
+// Logs at the given level.
+#define PANCAKE_LOG(level, message, ...) PANCAKE_LOG_CATEGORY(LOG_CATEGORY_GENERAL, level, message, ##__VA_ARGS__)
+
 // Logs a fatal-level message.
-#define PANCAKE_FATAL(message, ...) log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__);
+#define PANCAKE_FATAL(message, ...) PANCAKE_LOG(LOG_LEVEL_FATAL, message, ##__VA_ARGS__);
 
 #ifndef PANCAKE_ERROR
 // Logs an error-level message.
-#define PANCAKE_ERROR(message, ...) log_output(LOG_LEVEL_ERROR, message, ##__VA_ARGS__);
+#define PANCAKE_ERROR(message, ...) PANCAKE_LOG(LOG_LEVEL_ERROR, message, ##__VA_ARGS__);
 #endif
 
 #if LOG_WARN_ENABLED == 1
 // Logs a warning-level message.
-#define PANCAKE_WARN(message, ...) log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__);
+#define PANCAKE_WARN(message, ...) PANCAKE_LOG(LOG_LEVEL_WARN, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_WARN_ENABLED != 1
 #define PANCAKE_WARN(message, ...)
@@ -54,7 +195,7 @@ PANCAKE_API void log_output(log_level level, const char* message, ...);
 
 #if LOG_INFO_ENABLED == 1
 // Logs a info-level message.
-#define PANCAKE_INFO(message, ...) log_output(LOG_LEVEL_INFO, message, ##__VA_ARGS__);
+#define PANCAKE_INFO(message, ...) PANCAKE_LOG(LOG_LEVEL_INFO, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_INFO_ENABLED != 1
 #define PANCAKE_INFO(message, ...)
@@ -62,7 +203,7 @@ PANCAKE_API void log_output(log_level level, const char* message, ...);
 
 #if LOG_DEBUG_ENABLED == 1
 // Logs a debug-level message.
-#define PANCAKE_DEBUG(message, ...) log_output(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#define PANCAKE_DEBUG(message, ...) PANCAKE_LOG(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_DEBUG_ENABLED != 1
 #define PANCAKE_DEBUG(message, ...)
@@ -70,7 +211,7 @@ PANCAKE_API void log_output(log_level level, const char* message, ...);
 
 #if LOG_TRACE_ENABLED == 1
 // Logs a trace-level message.
-#define PANCAKE_TRACE(message, ...) log_output(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#define PANCAKE_TRACE(message, ...) PANCAKE_LOG(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_TRACE_ENABLED != 1
 #define PANCAKE_TRACE(message, ...)
@@ -1,6 +1,7 @@
 #include "pancake_memory.h"
 #include "core/logger.h"
 #include "core/pancake_string.h"
+#include "core/string_builder.h"
 #include "platform/platform.h"
 #include <stdio.h>
 
@@ -94,8 +95,10 @@ char* get_memory_usage_str(){
     const u64 Mb = 1024 * 1024;
     const u64 Kb = 1024;
 
-    char buffer[8000] = "system memor usage (tagged) :\n";
-    u64 offset = string_length(buffer);
+    char buffer[1024];
+    string_builder report;
+    string_builder_create_from_buffer(buffer, sizeof(buffer), &report);
+    string_builder_append(&report, "system memor usage (tagged) :\n");
     for(i32 i=0; i < MEMORY_TAG_MAX_TAGS; ++i){
         char unit[3] = "Xb";
         float amount = 1.0f;
@@ -113,12 +116,11 @@ char* get_memory_usage_str(){
             unit[1] = 0;
             amount = state_ptr->stats.tagged_allocations[i];
         }
-        //snprintf() returns the number of character written
-        //so we add the return value to our offset variable
-        offset += snprintf(buffer + offset, 8000, "\t%s : %.2f %s\n", memory_tags_string[i], amount, unit);
+        string_builder_append_format(&report, "\t%s : %.2f %s\n", memory_tags_string[i], amount, unit);
     }
 
-    char* out_string = string_duplicate(buffer);
+    char* out_string = string_duplicate(report.data);
+    string_builder_destroy(&report);
     return out_string;
 }
 u64 get_memory_allocations_count(){
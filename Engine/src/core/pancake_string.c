@@ -14,6 +14,10 @@ u64 string_length(const char* str) {
     return strlen(str);
 }
 
+u64 string_nlength(const char* str, u64 max_length) {
+    return strnlen(str, max_length);
+}
+
 char* string_duplicate(const char* str) {
     u64 length = string_length(str);
     char* copy = pancake_allocate(length + 1, MEMORY_TAG_STRING);
@@ -34,6 +38,10 @@ b8 strings_equal(const char* str0, const char* str1){
     return strcmp(str0, str1) == 0;
 }
 
+b8 strings_nequal(const char* str0, const char* str1, u64 length){
+    return strncmp(str0, str1, length) == 0;
+}
+
 i32 string_format(char* dest, const char* format, ...) {
     if (dest) {
         __builtin_va_list arg_ptr;
@@ -47,12 +55,9 @@ i32 string_format(char* dest, const char* format, ...) {
 
 i32 string_format_v(char* dest, const char* format, void* va_listp) {
     if (dest) {
-        // Big, but can fit on the stack.
-        char buffer[32000];
-        i32 written = vsnprintf(buffer, 32000, format, va_listp);
-        buffer[written] = 0;
-        pancake_copy_memory(dest, buffer, written + 1);
-
+        // Format straight into dest, the caller owns making it big enough.
+        // NOTE: dest must not overlap any of the arguments.
+        i32 written = vsnprintf(dest, STRING_FORMAT_MAX_LENGTH, format, va_listp);
         return written;
     }
     return -1;
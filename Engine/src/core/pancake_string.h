@@ -4,18 +4,27 @@
 
 // Returns the length of the given string.
 PANCAKE_API u64 string_length(const char* str);
+// Returns the length of the given string, reading max_length characters at most: str needs no terminator past them.
+PANCAKE_API u64 string_nlength(const char* str, u64 max_length);
 PANCAKE_API char* string_duplicate(const char* str); 
 
 //case sensative string comparison, true if the same otherwise false 
 PANCAKE_API b8 strings_equal(const char* str0, const char* str1);
 
+//case sensative comparison of the first length characters at most, true if the same otherwise false
+PANCAKE_API b8 strings_nequal(const char* str0, const char* str1, u64 length);
+
+// The most characters string_format/string_format_v will write to dest, terminator included.
+// Use a string_builder (core/string_builder.h) for output of unknown length.
+#define STRING_FORMAT_MAX_LENGTH 32000
+
 // Performs string formatting to dest given format string and parameters.
 PANCAKE_API i32 string_format(char* dest, const char* format, ...);
 
 //
 /**
  * Performs variadic string formatting to dest given format string and va_list.
- * @param dest The destination for the formatted string.
+ * @param dest The destination for the formatted string. Must not overlap any argument.
  * @param format The string to be formatted.
  * @param va_list The variadic argument list.
  * @returns The size of the data written.
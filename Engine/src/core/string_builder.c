@@ -0,0 +1,190 @@
+#include "string_builder.h"
+#include "pancake_memory.h"
+#include "pancake_string.h"
+#include "memory/linear_allocator.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#define STRING_BUILDER_MIN_CAPACITY 64
+
+void string_builder_create(u64 initial_capacity, linear_allocator* arena, string_builder* out_builder) {
+    if (!out_builder) {
+        return;
+    }
+    if (initial_capacity < STRING_BUILDER_MIN_CAPACITY) {
+        initial_capacity = STRING_BUILDER_MIN_CAPACITY;
+    }
+
+    out_builder->length = 0;
+    out_builder->arena = arena;
+    if (arena) {
+        out_builder->data = linear_allocator_allocate(arena, initial_capacity);
+        out_builder->owns_memory = false;
+    } else {
+        out_builder->data = pancake_allocate(initial_capacity, MEMORY_TAG_STRING);
+        out_builder->owns_memory = true;
+    }
+    out_builder->untracked = false;
+    out_builder->capacity = out_builder->data ? initial_capacity : 0;
+    if (out_builder->data) {
+        out_builder->data[0] = 0;
+    }
+}
+
+void string_builder_create_from_buffer(char* buffer, u64 size, string_builder* out_builder) {
+    if (!out_builder) {
+        return;
+    }
+    out_builder->data = buffer;
+    out_builder->length = 0;
+    out_builder->capacity = buffer ? size : 0;
+    out_builder->arena = 0;
+    out_builder->owns_memory = false;
+    out_builder->untracked = false;
+    if (buffer && size) {
+        buffer[0] = 0;
+    }
+}
+
+void string_builder_create_from_buffer_untracked(char* buffer, u64 size, string_builder* out_builder) {
+    string_builder_create_from_buffer(buffer, size, out_builder);
+    if (out_builder) {
+        out_builder->untracked = true;
+    }
+}
+
+static void string_builder_free(string_builder* builder) {
+    if (builder->untracked) {
+        platform_free(builder->data, false);
+    } else {
+        pancake_free(builder->data, builder->capacity, MEMORY_TAG_STRING);
+    }
+}
+
+void string_builder_destroy(string_builder* builder) {
+    if (!builder) {
+        return;
+    }
+    if (builder->owns_memory && builder->data) {
+        string_builder_free(builder);
+    }
+    builder->data = 0;
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->arena = 0;
+    builder->owns_memory = false;
+    builder->untracked = false;
+}
+
+void string_builder_clear(string_builder* builder) {
+    builder->length = 0;
+    if (builder->data) {
+        builder->data[0] = 0;
+    }
+}
+
+b8 string_builder_reserve(string_builder* builder, u64 additional) {
+    u64 required = builder->length + additional + 1;
+    if (required <= builder->capacity) {
+        return true;
+    }
+
+    u64 new_capacity = builder->capacity ? builder->capacity * 2 : STRING_BUILDER_MIN_CAPACITY;
+    while (new_capacity < required) {
+        new_capacity *= 2;
+    }
+
+    if (builder->arena) {
+        linear_allocator* arena = builder->arena;
+        // While the builder is the most recent allocation, the arena can simply be bumped.
+        if (builder->data && builder->data + builder->capacity == (char*)arena->memory + arena->allocated) {
+            if (linear_allocator_allocate(arena, new_capacity - builder->capacity)) {
+                builder->capacity = new_capacity;
+                return true;
+            }
+            return false;
+        }
+
+        char* block = linear_allocator_allocate(arena, new_capacity);
+        if (!block) {
+            return false;
+        }
+        if (builder->data) {
+            pancake_copy_memory(block, builder->data, builder->length + 1);
+        }
+        builder->data = block;
+        builder->capacity = new_capacity;
+        return true;
+    }
+
+    char* block = builder->untracked ? platform_allocate(new_capacity, false) : pancake_allocate(new_capacity, MEMORY_TAG_STRING);
+    if (builder->data) {
+        pancake_copy_memory(block, builder->data, builder->length + 1);
+        if (builder->owns_memory) {
+            string_builder_free(builder);
+        }
+    }
+    builder->data = block;
+    builder->capacity = new_capacity;
+    builder->owns_memory = true;
+    return true;
+}
+
+void string_builder_append_n(string_builder* builder, const char* str, u64 length) {
+    if (!length || !string_builder_reserve(builder, length)) {
+        return;
+    }
+    pancake_copy_memory(builder->data + builder->length, str, length);
+    builder->length += length;
+    builder->data[builder->length] = 0;
+}
+
+void string_builder_append(string_builder* builder, const char* str) {
+    if (str) {
+        string_builder_append_n(builder, str, string_length(str));
+    }
+}
+
+void string_builder_append_char(string_builder* builder, char c) {
+    string_builder_append_n(builder, &c, 1);
+}
+
+i32 string_builder_append_format(string_builder* builder, const char* format, ...) {
+    __builtin_va_list arg_ptr;
+    va_start(arg_ptr, format);
+    i32 written = string_builder_append_format_v(builder, format, arg_ptr);
+    va_end(arg_ptr);
+    return written;
+}
+
+i32 string_builder_append_format_v(string_builder* builder, const char* format, __builtin_va_list args) {
+    if (!builder || !format) {
+        return -1;
+    }
+
+    // Try to format straight into the free space first; args is needed again if it does not fit.
+    __builtin_va_list args_copy;
+    va_copy(args_copy, args);
+    u64 available = builder->capacity > builder->length ? builder->capacity - builder->length : 0;
+    i32 written = vsnprintf(available ? builder->data + builder->length : 0, available, format, args_copy);
+    va_end(args_copy);
+    if (written < 0) {
+        return -1;
+    }
+
+    if ((u64)written >= available) {
+        if (!string_builder_reserve(builder, written)) {
+            if (builder->data && available) {
+                // Keep the terminator where it was; the partial output is dropped.
+                builder->data[builder->length] = 0;
+            }
+            return -1;
+        }
+        vsnprintf(builder->data + builder->length, builder->capacity - builder->length, format, args);
+    }
+
+    builder->length += written;
+    return written;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "defines.h"
+
+struct linear_allocator;
+
+/*
+    Appends text into a growable buffer, tracking its length so nothing has to be
+    re-scanned or copied through an intermediate buffer. The data is always null-terminated.
+
+    Backing memory can be:
+    - the heap (arena = 0), grown by doubling.
+    - a linear allocator (frame/arena memory), extended in place while the builder's block
+      is the last allocation of the arena, otherwise moved to a new block of the arena.
+      Nothing is freed; the memory goes away with the arena.
+    - a caller provided buffer (usually on the stack), which spills to the heap once full.
+      Untracked builders spill straight to the platform allocator instead, skipping the memory
+      system's counters, which are not thread safe (for builders used off the main thread).
+*/
+typedef struct string_builder {
+    char* data;
+    u64 length;
+    u64 capacity;
+    struct linear_allocator* arena;
+    b8 owns_memory;
+    b8 untracked;
+} string_builder;
+
+/**
+ * Creates a string builder.
+ * @param initial_capacity The number of bytes to reserve up front, including the terminator.
+ * @param arena The linear allocator to take memory from, or 0 to use the heap.
+ * @param out_builder A pointer to hold the created builder.
+ */
+PANCAKE_API void string_builder_create(u64 initial_capacity, struct linear_allocator* arena, string_builder* out_builder);
+
+/**
+ * Creates a string builder writing into the given buffer. Appends past its end move the
+ * contents to the heap, so string_builder_destroy must still be called.
+ * @param buffer The memory to write into.
+ * @param size The size of buffer in bytes.
+ * @param out_builder A pointer to hold the created builder.
+ */
+PANCAKE_API void string_builder_create_from_buffer(char* buffer, u64 size, string_builder* out_builder);
+
+// Same as string_builder_create_from_buffer, spilling to memory taken straight from the platform.
+PANCAKE_API void string_builder_create_from_buffer_untracked(char* buffer, u64 size, string_builder* out_builder);
+
+// Releases heap memory held by the builder. Arena and caller buffers are left alone.
+PANCAKE_API void string_builder_destroy(string_builder* builder);
+
+// Resets the length to 0, keeping the memory.
+PANCAKE_API void string_builder_clear(string_builder* builder);
+
+// Makes sure at least additional more characters (plus the terminator) fit without growing.
+PANCAKE_API b8 string_builder_reserve(string_builder* builder, u64 additional);
+
+PANCAKE_API void string_builder_append(string_builder* builder, const char* str);
+PANCAKE_API void string_builder_append_n(string_builder* builder, const char* str, u64 length);
+PANCAKE_API void string_builder_append_char(string_builder* builder, char c);
+
+/**
+ * Appends formatted text directly to the end of the builder.
+ * @returns The number of characters appended, or -1 on error.
+ */
+PANCAKE_API i32 string_builder_append_format(string_builder* builder, const char* format, ...);
+
+/**
+ * Performs variadic formatting directly to the end of the builder. The text is formatted once
+ * when it fits in the remaining capacity, and a second time only after the builder had to grow.
+ * @param builder The builder to append to.
+ * @param format The string to be formatted.
+ * @param args The variadic argument list.
+ * @returns The number of characters appended, or -1 on error.
+ */
+PANCAKE_API i32 string_builder_append_format_v(string_builder* builder, const char* format, __builtin_va_list args);
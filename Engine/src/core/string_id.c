@@ -0,0 +1,101 @@
+#include "string_id.h"
+#include "pancake_memory.h"
+#include "pancake_string.h"
+#include "logger.h"
+
+// Must be a power of 2, ids are probed linearly from (id & (capacity - 1)).
+#define STRING_ID_TABLE_CAPACITY 4096
+
+typedef struct string_id_entry {
+    string_id id;
+    char* str;
+} string_id_entry;
+
+typedef struct string_id_system_state {
+    u32 count;
+    string_id_entry entries[STRING_ID_TABLE_CAPACITY];
+} string_id_system_state;
+
+static string_id_system_state* state_ptr;
+
+void initialize_string_id_system(u64* memory_requirement, void* state) {
+    *memory_requirement = sizeof(string_id_system_state);
+    if (state == 0) {
+        return;
+    }
+    pancake_zero_memory(state, sizeof(string_id_system_state));
+    state_ptr = state;
+}
+
+void shutdown_string_id_system(void* state) {
+    if (state_ptr) {
+        // Free the interned copies.
+        for (u32 i = 0; i < STRING_ID_TABLE_CAPACITY; ++i) {
+            string_id_entry* e = &state_ptr->entries[i];
+            if (e->str) {
+                pancake_free(e->str, string_length(e->str) + 1, MEMORY_TAG_STRING);
+                e->str = 0;
+                e->id = INVALID_STRING_ID;
+            }
+        }
+        state_ptr->count = 0;
+    }
+    state_ptr = 0;
+}
+
+string_id string_hash(const char* str) {
+    if (!str) {
+        return INVALID_STRING_ID;
+    }
+    return string_hash_n(str, string_length(str));
+}
+
+string_id string_intern(const char* str) {
+    string_id id = string_hash(str);
+    if (!state_ptr || id == INVALID_STRING_ID) {
+        return id;
+    }
+
+    u32 mask = STRING_ID_TABLE_CAPACITY - 1;
+    for (u32 probe = 0; probe < STRING_ID_TABLE_CAPACITY; ++probe) {
+        string_id_entry* e = &state_ptr->entries[(id + probe) & mask];
+        if (e->id == id) {
+            // Already interned. Only a full compare can tell a collision apart.
+            if (!strings_equal(e->str, str)) {
+                PANCAKE_ERROR("string_intern - hash collision between '%s' and '%s'.", e->str, str);
+            }
+            return id;
+        }
+        if (e->id == INVALID_STRING_ID) {
+            // Keep the table at most 3/4 full so probes stay short.
+            if (state_ptr->count >= (STRING_ID_TABLE_CAPACITY / 4) * 3) {
+                PANCAKE_WARN("string_intern - table is full, '%s' will not be reverse-lookupable.", str);
+                return id;
+            }
+            e->id = id;
+            e->str = string_duplicate(str);
+            state_ptr->count++;
+            return id;
+        }
+    }
+
+    return id;
+}
+
+const char* string_id_to_string(string_id id) {
+    if (!state_ptr || id == INVALID_STRING_ID) {
+        return 0;
+    }
+
+    u32 mask = STRING_ID_TABLE_CAPACITY - 1;
+    for (u32 probe = 0; probe < STRING_ID_TABLE_CAPACITY; ++probe) {
+        string_id_entry* e = &state_ptr->entries[(id + probe) & mask];
+        if (e->id == id) {
+            return e->str;
+        }
+        if (e->id == INVALID_STRING_ID) {
+            return 0;
+        }
+    }
+    return 0;
+}
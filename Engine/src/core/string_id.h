@@ -0,0 +1,74 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    A string id is the 64-bit FNV-1a hash of a string. Two ids are equal exactly when
+    their strings are equal (barring a hash collision, which the intern table reports),
+    so name comparisons become a single integer compare and lookup tables can key on ids.
+    0 is the invalid id: the rare string whose hash is 0 gets STRING_ID_ZERO_HASH instead,
+    so no valid string ever hashes to it.
+*/
+typedef u64 string_id;
+
+#define INVALID_STRING_ID 0
+
+#define STRING_ID_FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define STRING_ID_FNV_PRIME 0x100000001b3ULL
+// What a string hashing to 0 (INVALID_STRING_ID) gets instead, any fixed nonzero value does.
+#define STRING_ID_ZERO_HASH STRING_ID_FNV_PRIME
+
+/**
+ * Hashes length bytes of the given string. Being inline with a constant input, the
+ * compiler folds this to a constant for literals (see STRING_ID).
+ * @param str The string to be hashed.
+ * @param length The number of characters to hash.
+ * @returns The 64-bit FNV-1a hash of the string, never INVALID_STRING_ID.
+ */
+PANCAKE_INLINE string_id string_hash_n(const char* str, u64 length) {
+    u64 hash = STRING_ID_FNV_OFFSET_BASIS;
+    for (u64 i = 0; i < length; ++i) {
+        hash ^= (u8)str[i];
+        hash *= STRING_ID_FNV_PRIME;
+    }
+    return hash != INVALID_STRING_ID ? hash : STRING_ID_ZERO_HASH;
+}
+
+// Hashes a string literal, folded to a constant at compile time by the optimizer.
+#define STRING_ID(literal) string_hash_n("" literal, sizeof(literal) - 1)
+
+// Returns the 32-bit form of an id, for tables that want to store narrower keys.
+#define STRING_ID_32(id) ((u32)((id) ^ ((id) >> 32)))
+
+/**
+ * @brief Initializes the string id system. Call twice; once with state = 0 to get required memory size,
+ * then a second time passing allocated memory to state.
+ *
+ * @param memory_requirement A pointer to hold the required memory size of internal state.
+ * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ */
+PANCAKE_API void initialize_string_id_system(u64* memory_requirement, void* state);
+PANCAKE_API void shutdown_string_id_system(void* state);
+
+/**
+ * Hashes a null-terminated string. Does not touch the intern table.
+ * @param str The string to be hashed.
+ * @returns The id of the string.
+ */
+PANCAKE_API string_id string_hash(const char* str);
+
+/**
+ * Interns the given string: stores a copy in the global table (if not already there) and
+ * returns its id. The id is valid even if the system is not initialized or the table is full,
+ * only the reverse lookup through string_id_to_string is lost in that case.
+ * @param str The string to be interned.
+ * @returns The id of the string.
+ */
+PANCAKE_API string_id string_intern(const char* str);
+
+/**
+ * Looks up the interned copy of the string with the given id.
+ * @param id The id to look up.
+ * @returns The interned string, or 0 if the id was never interned.
+ */
+PANCAKE_API const char* string_id_to_string(string_id id);
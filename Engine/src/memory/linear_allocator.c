@@ -9,7 +9,9 @@ void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out
         out_allocator->allocated = 0;
         out_allocator->owns_memory = memory == 0;
         if (memory) {
+            // Zeroed like the memory it allocates itself, free_all counts on it.
             out_allocator->memory = memory;
+            pancake_zero_memory(memory, total_size);
         } else {
             out_allocator->memory = pancake_allocate(total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
         }
@@ -46,7 +48,8 @@ void* linear_allocator_allocate(linear_allocator* allocator, u64 size) {
 
 void linear_allocator_free_all(linear_allocator* allocator) {
     if (allocator && allocator->memory) {
+        // Only the allocated part can have been written to, the rest is still zeroed from create.
+        pancake_zero_memory(allocator->memory, allocator->allocated);
         allocator->allocated = 0;
-        pancake_zero_memory(allocator->memory, allocator->total_size);
     }
 }
\ No newline at end of file
@@ -1,11 +1,31 @@
 #include "filesystem.h"
+#include "pack_file.h"
+#include "lz.h"
 
 #include "core/logger.h"
 #include "core/pancake_memory.h"
+#include "core/pancake_string.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#if PANCAKE_PLATFORM_WINDOWS
+#include <Windows.h>  // MoveFileExA
+#include <direct.h>
+#include <io.h>  // _findfirst, _open
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+// Compressed files of at least this many blocks are decompressed on more than one thread.
+#define FILESYSTEM_PARALLEL_BLOCKS 8
+#define FILESYSTEM_DECOMPRESS_THREADS 4
+
+// Mounted packs, searched from the last one.
+static pack_file mounted_packs[FILESYSTEM_MAX_PACKS];
+static u32 mounted_pack_count;
 
 b8 filesystem_exists(const char* path) {
     struct stat buffer;
@@ -17,7 +37,30 @@ b8 filesystem_open(const char* path, file_modes mode, b8 binary, file_handle* ou
     out_handle->handle = 0;
     const char* mode_str;
 
-    if ((mode & FILE_MODE_READ) != 0 && (mode & FILE_MODE_WRITE) != 0) {
+    if ((mode & FILE_MODE_WRITE) != 0 && (mode & FILE_MODE_KEEP) != 0) {
+        // "r+" can't create the file and "w+" truncates it, and checking whether it exists first
+        // races with whoever creates it meanwhile. Opened (and created if missing) in one call instead.
+#if PANCAKE_PLATFORM_WINDOWS
+        int descriptor = _open(path, _O_RDWR | _O_CREAT | (binary ? _O_BINARY : _O_TEXT), _S_IREAD | _S_IWRITE);
+        FILE* file = descriptor >= 0 ? _fdopen(descriptor, binary ? "r+b" : "r+") : 0;
+        if (descriptor >= 0 && !file) {
+            _close(descriptor);
+        }
+#else
+        int descriptor = open(path, O_RDWR | O_CREAT, 0644);
+        FILE* file = descriptor >= 0 ? fdopen(descriptor, binary ? "r+b" : "r+") : 0;
+        if (descriptor >= 0 && !file) {
+            close(descriptor);
+        }
+#endif
+        if (!file) {
+            PANCAKE_ERROR("Error opening file: '%s'", path);
+            return false;
+        }
+        out_handle->handle = file;
+        out_handle->is_valid = true;
+        return true;
+    } else if ((mode & FILE_MODE_READ) != 0 && (mode & FILE_MODE_WRITE) != 0) {
         mode_str = binary ? "w+b" : "w+";
     } else if ((mode & FILE_MODE_READ) != 0 && (mode & FILE_MODE_WRITE) == 0) {
         mode_str = binary ? "rb" : "r";
@@ -108,12 +151,259 @@ b8 filesystem_read_all_bytes(file_handle* handle, u8** out_bytes, u64* out_bytes
 
 b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* out_bytes_written) {
     if (handle->handle) {
+        // Buffered; call filesystem_flush where the data must reach the OS right away.
         *out_bytes_written = fwrite(data, 1, data_size, (FILE*)handle->handle);
         if (*out_bytes_written != data_size) {
             return false;
         }
-        fflush((FILE*)handle->handle);
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
+
+b8 filesystem_seek(file_handle* handle, u64 offset) {
+    if (handle->handle) {
+#if PANCAKE_PLATFORM_WINDOWS
+        return _fseeki64((FILE*)handle->handle, (__int64)offset, SEEK_SET) == 0;
+#else
+        return fseeko((FILE*)handle->handle, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+    return false;
+}
+
+b8 filesystem_flush(file_handle* handle) {
+    if (handle->handle) {
+        return fflush((FILE*)handle->handle) == 0;
+    }
+    return false;
+}
+
+b8 filesystem_rename(const char* old_path, const char* new_path) {
+#if PANCAKE_PLATFORM_WINDOWS
+    // rename() refuses to replace an existing file there.
+    return MoveFileExA(old_path, new_path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    // Replaces new_path in one step, it is never missing in between.
+    return rename(old_path, new_path) == 0;
+#endif
+}
+
+b8 filesystem_delete(const char* path) {
+    return remove(path) == 0;
+}
+
+b8 filesystem_create_directory(const char* path) {
+    struct stat buffer;
+    if (stat(path, &buffer) == 0) {
+        return (buffer.st_mode & S_IFMT) == S_IFDIR;
+    }
+#if PANCAKE_PLATFORM_WINDOWS
+    return _mkdir(path) == 0;
+#else
+    return mkdir(path, 0755) == 0;
+#endif
+}
+
+b8 filesystem_list_directory(const char* path, pfn_directory_file callback, void* user_data) {
+    char file_path[512];
+#if PANCAKE_PLATFORM_WINDOWS
+    if (string_length(path) + 3 > sizeof(file_path)) {
+        return false;
+    }
+    string_format(file_path, "%s/*", path);
+    struct _finddata_t file;
+    intptr_t find = _findfirst(file_path, &file);
+    if (find == -1) {
+        return false;
+    }
+    do {
+        if (!strings_equal(file.name, ".") && !strings_equal(file.name, "..")) {
+            callback(file.name, (file.attrib & _A_SUBDIR) != 0, user_data);
+        }
+    } while (_findnext(find, &file) == 0);
+    _findclose(find);
+    return true;
+#else
+    DIR* directory = opendir(path);
+    if (!directory) {
+        return false;
+    }
+    u64 path_length = string_length(path);
+    struct dirent* file;
+    while ((file = readdir(directory))) {
+        if (strings_equal(file->d_name, ".") || strings_equal(file->d_name, "..")
+            || path_length + string_length(file->d_name) + 2 > sizeof(file_path)) {
+            continue;
+        }
+        // Not every filesystem fills d_type, stat tells directories apart either way.
+        string_format(file_path, "%s/%s", path, file->d_name);
+        struct stat buffer;
+        if (stat(file_path, &buffer) == 0) {
+            callback(file->d_name, (buffer.st_mode & S_IFMT) == S_IFDIR, user_data);
+        }
+    }
+    closedir(directory);
+    return true;
+#endif
+}
+
+b8 filesystem_map(const char* path, file_map_hint hint, file_view* out_view) {
+    out_view->data = 0;
+    out_view->size = 0;
+    out_view->owned_data = 0;
+    if (!platform_file_map_read(path, hint == FILE_MAP_HINT_SEQUENTIAL, &out_view->mapping)) {
+        return false;
+    }
+    out_view->data = out_view->mapping.memory;
+    out_view->size = out_view->mapping.size;
+    return true;
+}
+
+void filesystem_unmap(file_view* view) {
+    if (view->owned_data) {
+        pancake_free(view->owned_data, view->size, MEMORY_TAG_STRING);
+        view->owned_data = 0;
+    }
+    platform_file_unmap(&view->mapping);
+    view->data = 0;
+    view->size = 0;
+}
+
+void filesystem_line_reader_create(file_handle* handle, u64 buffer_size, file_line_reader* out_reader) {
+    pancake_zero_memory(out_reader, sizeof(file_line_reader));
+    out_reader->handle = handle;
+    out_reader->capacity = buffer_size > 16 ? buffer_size : 16;
+    out_reader->buffer = pancake_allocate(out_reader->capacity, MEMORY_TAG_STRING);
+}
+
+void filesystem_line_reader_create_from_view(const file_view* view, file_line_reader* out_reader) {
+    pancake_zero_memory(out_reader, sizeof(file_line_reader));
+    // The whole file is already in the "buffer".
+    out_reader->buffer = (char*)view->data;
+    out_reader->end = view->size;
+    out_reader->end_of_file = true;
+}
+
+// Reads more of the file after the unread part, moving it to the front of the buffer and growing the buffer if it is full.
+static void line_reader_fill(file_line_reader* reader) {
+    if (reader->start) {
+        u64 unread = reader->end - reader->start;
+        memmove(reader->buffer, reader->buffer + reader->start, unread);
+        reader->scanned -= reader->start;
+        reader->end = unread;
+        reader->start = 0;
+    }
+    if (reader->end == reader->capacity) {
+        u64 capacity = reader->capacity * 2;
+        char* buffer = pancake_allocate(capacity, MEMORY_TAG_STRING);
+        pancake_copy_memory(buffer, reader->buffer, reader->end);
+        pancake_free(reader->buffer, reader->capacity, MEMORY_TAG_STRING);
+        reader->buffer = buffer;
+        reader->capacity = capacity;
+    }
+
+    u64 read = 0;
+    // A short read means the end of the file (or an error, which ends it too).
+    if (!filesystem_read(reader->handle, reader->capacity - reader->end, reader->buffer + reader->end, &read)) {
+        reader->end_of_file = true;
+    }
+    reader->end += read;
+}
+
+b8 filesystem_line_reader_next(file_line_reader* reader, const char** out_line, u64* out_length) {
+    for (;;) {
+        const char* found = reader->end > reader->scanned ? memchr(reader->buffer + reader->scanned, '\n', reader->end - reader->scanned) : 0;
+        u64 line_end;
+        if (found) {
+            line_end = found - reader->buffer;
+        } else if (reader->end_of_file) {
+            if (reader->start == reader->end) {
+                return false;
+            }
+            // The last line, without a line break.
+            line_end = reader->end;
+        } else {
+            reader->scanned = reader->end;
+            line_reader_fill(reader);
+            continue;
+        }
+
+        u64 length = line_end - reader->start;
+        if (length && reader->buffer[line_end - 1] == '\r') {
+            length--;
+        }
+        *out_line = reader->buffer + reader->start;
+        *out_length = length;
+        reader->start = line_end < reader->end ? line_end + 1 : line_end;
+        reader->scanned = reader->start;
+        return true;
+    }
+}
+
+void filesystem_line_reader_destroy(file_line_reader* reader) {
+    if (reader->handle && reader->buffer) {
+        pancake_free(reader->buffer, reader->capacity, MEMORY_TAG_STRING);
+    }
+    pancake_zero_memory(reader, sizeof(file_line_reader));
+}
+
+b8 filesystem_mount_pack(const char* path) {
+    if (mounted_pack_count == FILESYSTEM_MAX_PACKS) {
+        PANCAKE_ERROR("filesystem_mount_pack - all %d packs are mounted.", FILESYSTEM_MAX_PACKS);
+        return false;
+    }
+    if (!pack_file_open(path, &mounted_packs[mounted_pack_count])) {
+        return false;
+    }
+    PANCAKE_INFO("Mounted pack '%s', %u files.", path, mounted_packs[mounted_pack_count].header->entry_count);
+    mounted_pack_count++;
+    return true;
+}
+
+void filesystem_unmount_packs() {
+    for (u32 i = 0; i < mounted_pack_count; ++i) {
+        pack_file_close(&mounted_packs[i]);
+    }
+    mounted_pack_count = 0;
+}
+
+b8 filesystem_load(const char* path, file_map_hint hint, file_view* out_view) {
+    for (u32 i = mounted_pack_count; i > 0; --i) {
+        const pack_file* pack = &mounted_packs[i - 1];
+        const pack_entry* entry = pack_file_find(pack, path);
+        if (!entry) {
+            continue;
+        }
+        pancake_zero_memory(out_view, sizeof(file_view));
+        if (entry->compression == PACK_COMPRESSION_NONE) {
+            // A view into the pack's mapping, which stays mapped: nothing to unmap.
+            out_view->data = pack_file_entry_data(pack, entry);
+            out_view->size = entry->size;
+            return true;
+        }
+        if (entry->compression != PACK_COMPRESSION_LZ) {
+            PANCAKE_ERROR("filesystem_load - '%s' uses an unknown compression (%u).", path, entry->compression);
+            return false;
+        }
+
+        lz_frame_info info;
+        const u8* frame = pack_file_entry_data(pack, entry);
+        if (!lz_frame_get_info(frame, entry->stored_size, &info) || info.size != entry->size) {
+            PANCAKE_ERROR("filesystem_load - '%s' is corrupted in its pack.", path);
+            return false;
+        }
+        u8* data = pancake_allocate(entry->size, MEMORY_TAG_STRING);
+        u32 threads = info.block_count >= FILESYSTEM_PARALLEL_BLOCKS ? FILESYSTEM_DECOMPRESS_THREADS : 1;
+        if (!lz_frame_decompress(frame, entry->stored_size, data, entry->size, threads)) {
+            PANCAKE_ERROR("filesystem_load - '%s' failed to decompress.", path);
+            pancake_free(data, entry->size, MEMORY_TAG_STRING);
+            return false;
+        }
+        out_view->data = data;
+        out_view->size = entry->size;
+        out_view->owned_data = data;
+        return true;
+    }
+    return filesystem_map(path, hint, out_view);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.h"
+#include "platform/platform.h"
 
 // Holds a handle to a file.
 typedef struct file_handle {
@@ -11,9 +12,46 @@ typedef struct file_handle {
 
 typedef enum file_modes {
     FILE_MODE_READ = 0x1,
-    FILE_MODE_WRITE = 0x2
+    FILE_MODE_WRITE = 0x2,
+    // With FILE_MODE_WRITE: keep what the file holds instead of truncating it, creating it if missing.
+    FILE_MODE_KEEP = 0x4
 } file_modes;
 
+// How a mapped file is going to be read, see filesystem_map.
+typedef enum file_map_hint {
+    // Front to back (assets, shaders): read ahead of the first access, pages behind can be dropped early.
+    FILE_MAP_HINT_SEQUENTIAL,
+    // Scattered reads (packs, tables): only the pages touched are read.
+    FILE_MAP_HINT_RANDOM
+} file_map_hint;
+
+/*
+    Iterates over the lines of a file as (pointer, length) views, without allocating per line.
+    Reading a file_handle, lines are views into a buffer refilled in large reads (grown when a line
+    doesn't fit); reading a file_view they point into the mapping. Either way a line is valid until
+    the next call. The line break ("\n" or "\r\n") is not part of the line, nor is there a terminator.
+*/
+typedef struct file_line_reader {
+    // 0 when reading a file_view.
+    file_handle* handle;
+    char* buffer;
+    u64 capacity;
+    // The unread part of the buffer, and how far into it a line break was looked for.
+    u64 start;
+    u64 end;
+    u64 scanned;
+    b8 end_of_file;
+} file_line_reader;
+
+// A read only view of a whole file, mapped in memory.
+typedef struct file_view {
+    const u8* data;
+    u64 size;
+    platform_file_mapping mapping;
+    // Set when the file was decompressed from a pack into memory of its own, freed by filesystem_unmap.
+    u8* owned_data;
+} file_view;
+
 /**
  * Checks if a file with the given path exists.
  * @param path The path of the file to be checked.
@@ -39,6 +77,7 @@ PANCAKE_API void filesystem_close(file_handle* handle);
 
 /** 
  * Reads up to a newline or EOF. Allocates *line_buf, which must be freed by the caller.
+ * Use a file_line_reader to go through many lines without an allocation each.
  * @param handle A pointer to a file_handle structure.
  * @param line_buf A pointer to a character array which will be allocated and populated by this method.
  * @returns True if successful; otherwise false.
@@ -75,11 +114,128 @@ PANCAKE_API b8 filesystem_read(file_handle* handle, u64 data_size, void* out_dat
 PANCAKE_API b8 filesystem_read_all_bytes(file_handle* handle, u8** out_bytes, u64* out_bytes_read);
 
 /** 
- * Writes provided data to the file.
+ * Writes provided data to the file. Writes are buffered, see filesystem_flush.
  * @param handle A pointer to a file_handle structure.
  * @param data_size The size of the data in bytes.
  * @param data The data to be written.
  * @param out_bytes_written A pointer to a number which will be populated with the number of bytes actually written to the file.
  * @returns True if successful; otherwise false.
  */
-PANCAKE_API b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* out_bytes_written);
\ No newline at end of file
+PANCAKE_API b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* out_bytes_written);
+
+/**
+ * Moves the position the next read or write happens at.
+ * @param handle A pointer to a file_handle structure.
+ * @param offset The position from the start of the file, in bytes.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_seek(file_handle* handle, u64 offset);
+
+/**
+ * Hands everything written to the file so far over to the OS, so it survives the process crashing.
+ * @param handle A pointer to a file_handle structure.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_flush(file_handle* handle);
+
+/**
+ * Renames (moves) a file, replacing new_path if it exists.
+ * @param old_path The path of the file to be renamed.
+ * @param new_path The new path of the file.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_rename(const char* old_path, const char* new_path);
+
+/**
+ * Deletes a file.
+ * @param path The path of the file to be deleted.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_delete(const char* path);
+
+/**
+ * Creates a directory, its parent must exist.
+ * @param path The path of the directory.
+ * @returns True if the directory was created or already exists; otherwise false.
+ */
+PANCAKE_API b8 filesystem_create_directory(const char* path);
+
+// Called with the name (not the path) of each file or sub directory found by filesystem_list_directory.
+typedef void (*pfn_directory_file)(const char* name, b8 is_directory, void* user_data);
+
+/**
+ * Calls callback for every file and sub directory in a directory ("." and ".." aside), without
+ * going into the sub directories. The callback may delete the file it is given.
+ * @param path The path of the directory.
+ * @param callback The function called with each name.
+ * @param user_data Passed to callback as is.
+ * @returns True if the directory could be read; otherwise false.
+ */
+PANCAKE_API b8 filesystem_list_directory(const char* path, pfn_directory_file callback, void* user_data);
+
+/**
+ * Maps the file at path in memory, read only. Nothing is copied: pages are read from the file when
+ * touched, shared with the OS file cache, and can be dropped by the OS under memory pressure.
+ * @param path The path of the file to be mapped.
+ * @param hint How the view is going to be read.
+ * @param out_view A pointer to hold the view. An empty file gives data = 0 and size = 0.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_map(const char* path, file_map_hint hint, file_view* out_view);
+
+/**
+ * Unmaps a view given by filesystem_map or filesystem_load, its data can't be used afterwards.
+ * @param view A pointer to the view.
+ */
+PANCAKE_API void filesystem_unmap(file_view* view);
+
+/**
+ * Creates a line reader over an opened file, reading from its current position.
+ * @param handle A pointer to a file_handle structure, which must outlive the reader.
+ * @param buffer_size The size of the read buffer, grown if a line is longer.
+ * @param out_reader A pointer to hold the reader.
+ */
+PANCAKE_API void filesystem_line_reader_create(file_handle* handle, u64 buffer_size, file_line_reader* out_reader);
+
+/**
+ * Creates a line reader over a mapped file. Nothing is copied or allocated.
+ * @param view A pointer to the view, which must outlive the reader.
+ * @param out_reader A pointer to hold the reader.
+ */
+PANCAKE_API void filesystem_line_reader_create_from_view(const file_view* view, file_line_reader* out_reader);
+
+/**
+ * Gets the next line.
+ * @param reader A pointer to the reader.
+ * @param out_line A pointer to hold the start of the line, valid until the next call.
+ * @param out_length A pointer to hold the length of the line.
+ * @returns True if there was a line; false at the end of the file.
+ */
+PANCAKE_API b8 filesystem_line_reader_next(file_line_reader* reader, const char** out_line, u64* out_length);
+
+// Frees the read buffer of the reader.
+PANCAKE_API void filesystem_line_reader_destroy(file_line_reader* reader);
+
+#define FILESYSTEM_MAX_PACKS 8
+
+/**
+ * Mounts a pack (see pack_file.h), so filesystem_load finds the files it holds. Packs mounted
+ * later take precedence over the ones mounted before, and all of them over loose files.
+ * @param path The path of the pack.
+ * @returns True if the pack was opened and mounted; otherwise false.
+ */
+PANCAKE_API b8 filesystem_mount_pack(const char* path);
+
+// Unmounts every pack, views loaded from them can't be used afterwards.
+PANCAKE_API void filesystem_unmount_packs();
+
+/**
+ * Loads a whole file, read only: from the mounted packs if one holds path, otherwise mapped from
+ * the loose file. Nothing is copied unless the file is compressed in its pack, in which case it is
+ * decompressed (across threads when large). Release the view with filesystem_unmap.
+ * @param path The path of the file.
+ * @param hint How the view is going to be read.
+ * @param out_view A pointer to hold the view.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 filesystem_load(const char* path, file_map_hint hint, file_view* out_view);
@@ -0,0 +1,450 @@
+#include "lz.h"
+
+#include "core/logger.h"
+#include "platform/pancake_thread.h"
+#include "containers/ring_queue.h"
+
+#include <string.h>  // memcpy, memset
+
+STATIC_ASSERT(sizeof(lz_frame_header) == 24, "lz_frame_header is read from files as is");
+
+#define LZ_HASH_BITS 12
+// Matches don't start in the last bytes of a block, which always end on literals.
+#define LZ_MATCH_START_LIMIT 12
+// Each miss in a row makes the search skip a little further, so incompressible data goes fast.
+#define LZ_SKIP_TRIGGER 6
+#define LZ_MAX_THREADS 16
+// Helpers asked for by frames being decompressed and not picked up by a worker yet.
+#define LZ_TICKET_CAPACITY 256
+
+static PANCAKE_INLINE u32 lz_read32(const u8* p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static PANCAKE_INLINE u64 lz_read64(const u8* p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// size / block_size rounded up, without overflowing for sizes near the top of u64.
+static PANCAKE_INLINE u64 lz_block_count(u64 size, u32 block_size) {
+    return size / block_size + (size % block_size != 0);
+}
+
+static PANCAKE_INLINE u32 lz_hash(u32 sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// The bytes taken by the extension of a length past its 4 bit field.
+static PANCAKE_INLINE u64 lz_length_size(u64 length) {
+    return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+static u8* lz_write_length(u8* op, u64 length) {
+    length -= 15;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+static u8* lz_write_literals(u8* op, const u8* literals, u64 count, u8 token) {
+    *op++ = token | (u8)((count < 15 ? count : 15) << 4);
+    if (count >= 15) {
+        op = lz_write_length(op, count);
+    }
+    memcpy(op, literals, count);
+    return op + count;
+}
+
+u64 lz_compress_block(const void* source, u64 size, void* dest, u64 capacity) {
+    const u8* src = source;
+    const u8* end = src + size;
+    const u8* anchor = src;
+    u8* op = dest;
+    u8* op_end = op + capacity;
+
+    if (size > LZ_MATCH_START_LIMIT && size <= 0xFFFFFFFF) {
+        u32 table[1 << LZ_HASH_BITS];
+        memset(table, 0, sizeof(table));
+        const u8* match_limit = end - LZ_LAST_LITERALS;
+        const u8* start_limit = end - LZ_MATCH_START_LIMIT;
+        const u8* ip = src;
+        u32 misses = 0;
+
+        while (ip < start_limit) {
+            u32 sequence = lz_read32(ip);
+            u32 hash = lz_hash(sequence);
+            const u8* candidate = src + table[hash];
+            table[hash] = (u32)(ip - src);
+            if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET || lz_read32(candidate) != sequence) {
+                ip += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            // The match may start before the position that found it.
+            while (ip > anchor && candidate > src && ip[-1] == candidate[-1]) {
+                --ip;
+                --candidate;
+            }
+            const u8* match_end = ip + LZ_MIN_MATCH;
+            const u8* from = candidate + LZ_MIN_MATCH;
+            while (match_end < match_limit && *match_end == *from) {
+                ++match_end;
+                ++from;
+            }
+
+            u64 literal_count = (u64)(ip - anchor);
+            u64 match_length = (u64)(match_end - ip) - LZ_MIN_MATCH;
+            u64 needed = 1 + lz_length_size(literal_count) + literal_count + 2 + lz_length_size(match_length);
+            if (needed > (u64)(op_end - op)) {
+                return 0;
+            }
+            op = lz_write_literals(op, anchor, literal_count, (u8)(match_length < 15 ? match_length : 15));
+            u64 offset = (u64)(ip - candidate);
+            *op++ = (u8)offset;
+            *op++ = (u8)(offset >> 8);
+            if (match_length >= 15) {
+                op = lz_write_length(op, match_length);
+            }
+
+            ip = match_end;
+            anchor = ip;
+            // Remember a position inside the match too, repeats often line up with it.
+            if (ip - 2 > src && ip < start_limit) {
+                table[lz_hash(lz_read32(ip - 2))] = (u32)(ip - 2 - src);
+            }
+        }
+    }
+
+    u64 literal_count = (u64)(end - anchor);
+    if (1 + lz_length_size(literal_count) + literal_count > (u64)(op_end - op)) {
+        return 0;
+    }
+    op = lz_write_literals(op, anchor, literal_count, 0);
+    return (u64)(op - (u8*)dest);
+}
+
+// Reads the extension of a length, false if it runs past the end.
+static PANCAKE_INLINE b8 lz_read_length(const u8** ip, const u8* ip_end, u64* length) {
+    u8 byte;
+    do {
+        if (*ip >= ip_end) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+b8 lz_decompress_block(const void* source, u64 size, void* dest, u64 dest_size) {
+    const u8* ip = source;
+    const u8* ip_end = ip + size;
+    u8* op = dest;
+    u8* op_start = op;
+    u8* op_end = op + dest_size;
+
+    while (ip < ip_end) {
+        u8 token = *ip++;
+
+        u64 literal_count = token >> 4;
+        if (literal_count == 15 && !lz_read_length(&ip, ip_end, &literal_count)) {
+            return false;
+        }
+        if (literal_count > (u64)(ip_end - ip) || literal_count > (u64)(op_end - op)) {
+            return false;
+        }
+        if (literal_count <= 16 && ip_end - ip >= 16 && op_end - op >= 16) {
+            // A fixed size copy is a couple of moves, the bytes past the literals get written over later.
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, literal_count);
+        }
+        ip += literal_count;
+        op += literal_count;
+        if (ip == ip_end) {
+            // The last sequence has no match.
+            break;
+        }
+
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        u64 offset = (u64)ip[0] | ((u64)ip[1] << 8);
+        ip += 2;
+        u64 match_length = token & 15;
+        if (match_length == 15 && !lz_read_length(&ip, ip_end, &match_length)) {
+            return false;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (u64)(op - op_start) || match_length > (u64)(op_end - op)) {
+            return false;
+        }
+
+        const u8* match = op - offset;
+        u8* match_end = op + match_length;
+        if (offset >= 8 && (u64)(op_end - op) >= match_length + 8) {
+            // 8 bytes at a time never read what they are about to write, even overlapping. The last
+            // copy may run past the match, into bytes written over later.
+            do {
+                memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            } while (op < match_end);
+        } else {
+            // Short repeating patterns (runs), and the end of the block.
+            while (op < match_end) {
+                *op++ = *match++;
+            }
+        }
+        op = match_end;
+    }
+    return op == op_end;
+}
+
+u64 lz_frame_bound(u64 size, u32 block_size) {
+    if (block_size == 0) {
+        block_size = LZ_DEFAULT_BLOCK_SIZE;
+    }
+    u64 block_count = lz_block_count(size, block_size);
+    return sizeof(lz_frame_header) + block_count * sizeof(u64) + size;
+}
+
+u64 lz_frame_compress(const void* source, u64 size, u32 block_size, void* dest, u64 capacity) {
+    if (block_size == 0) {
+        block_size = LZ_DEFAULT_BLOCK_SIZE;
+    }
+    u64 block_count = lz_block_count(size, block_size);
+    if (block_count > 0xFFFFFFFF) {
+        PANCAKE_ERROR("lz_frame_compress - %llu bytes is too many blocks of %u.", size, block_size);
+        return 0;
+    }
+    u64 data_offset = sizeof(lz_frame_header) + block_count * sizeof(u64);
+    if (capacity < data_offset) {
+        return 0;
+    }
+
+    const u8* src = source;
+    u8* frame = dest;
+    lz_frame_header header = {0};
+    header.magic = LZ_FRAME_MAGIC;
+    header.block_size = block_size;
+    header.size = size;
+    header.block_count = (u32)block_count;
+    memcpy(frame, &header, sizeof(header));
+
+    u64 position = data_offset;
+    for (u64 i = 0; i < block_count; ++i) {
+        u64 offset = i * block_size;
+        u64 length = size - offset < block_size ? size - offset : block_size;
+        u64 room = capacity - position;
+        // Anything not smaller than the block is stored as is.
+        u64 stored = lz_compress_block(src + offset, length, frame + position, room < length ? room : length - 1);
+        if (stored == 0) {
+            if (room < length) {
+                return 0;
+            }
+            memcpy(frame + position, src + offset, length);
+            stored = length;
+        }
+        position += stored;
+        u64 block_end = position - data_offset;
+        memcpy(frame + sizeof(lz_frame_header) + i * sizeof(u64), &block_end, sizeof(u64));
+    }
+    return position;
+}
+
+b8 lz_frame_get_info(const void* frame, u64 frame_size, lz_frame_info* out_info) {
+    if (frame_size < sizeof(lz_frame_header)) {
+        return false;
+    }
+    lz_frame_header header;
+    memcpy(&header, frame, sizeof(header));
+    if (header.magic != LZ_FRAME_MAGIC || header.block_size == 0
+        || lz_block_count(header.size, header.block_size) != header.block_count
+        || header.block_count > (frame_size - sizeof(lz_frame_header)) / sizeof(u64)) {
+        return false;
+    }
+
+    // Block ends only go forward and stay inside the frame.
+    const u8* table = (const u8*)frame + sizeof(lz_frame_header);
+    u64 data_size = frame_size - sizeof(lz_frame_header) - header.block_count * sizeof(u64);
+    u64 previous = 0;
+    for (u32 i = 0; i < header.block_count; ++i) {
+        u64 block_end = lz_read64(table + i * sizeof(u64));
+        if (block_end <= previous || block_end > data_size) {
+            return false;
+        }
+        previous = block_end;
+    }
+
+    out_info->size = header.size;
+    out_info->block_size = header.block_size;
+    out_info->block_count = header.block_count;
+    return true;
+}
+
+// Decompresses a block of a frame already checked by lz_frame_get_info.
+static b8 lz_frame_block(const u8* frame, const lz_frame_info* info, u32 index, void* dest) {
+    const u8* table = frame + sizeof(lz_frame_header);
+    const u8* data = table + (u64)info->block_count * sizeof(u64);
+    u64 start = index ? lz_read64(table + (index - 1) * sizeof(u64)) : 0;
+    u64 stored = lz_read64(table + index * sizeof(u64)) - start;
+    u64 offset = (u64)index * info->block_size;
+    u64 length = info->size - offset < info->block_size ? info->size - offset : info->block_size;
+
+    if (stored == length) {
+        memcpy(dest, data + start, length);
+        return true;
+    }
+    return stored < length && lz_decompress_block(data + start, stored, dest, length);
+}
+
+b8 lz_frame_decompress_block(const void* frame, u64 frame_size, u32 block_index, void* dest) {
+    lz_frame_info info;
+    if (!lz_frame_get_info(frame, frame_size, &info) || block_index >= info.block_count) {
+        return false;
+    }
+    return lz_frame_block(frame, &info, block_index, dest);
+}
+
+typedef struct lz_decompress_work {
+    const u8* frame;
+    lz_frame_info info;
+    u8* dest;
+    // Blocks are claimed one by one, so threads that get easy ones take more.
+    u32 next_block;
+    // Workers asked to help and not done yet, the work lives on the caller's stack until then.
+    u32 tickets;
+    b8 failed;
+} lz_decompress_work;
+
+typedef struct lz_workers_state {
+    pancake_thread threads[LZ_MAX_THREADS];
+    u32 thread_count;
+    // of lz_decompress_work*, one for each worker asked to help with it.
+    ring_queue tickets;
+    // Counts the tickets queued, and the threads to stop at shutdown.
+    pancake_semaphore wake;
+    b8 running;
+} lz_workers_state;
+
+static lz_workers_state* workers_ptr;
+
+static void lz_decompress_run(lz_decompress_work* work) {
+    for (;;) {
+        u32 index = __atomic_fetch_add(&work->next_block, 1, __ATOMIC_RELAXED);
+        if (index >= work->info.block_count) {
+            break;
+        }
+        if (!lz_frame_block(work->frame, &work->info, index, work->dest + (u64)index * work->info.block_size)) {
+            __atomic_store_n(&work->failed, true, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static u32 lz_worker_run(void* params) {
+    for (;;) {
+        pancake_semaphore_wait(&workers_ptr->wake);
+        lz_decompress_work* work;
+        // A ticket pushed meanwhile by another thread can hold the queue up for a moment.
+        while (!ring_queue_pop(&workers_ptr->tickets, &work)) {
+            if (!__atomic_load_n(&workers_ptr->running, __ATOMIC_ACQUIRE)) {
+                return 0;
+            }
+            pancake_thread_yield();
+        }
+        lz_decompress_run(work);
+        __atomic_sub_fetch(&work->tickets, 1, __ATOMIC_RELEASE);
+    }
+}
+
+b8 initialize_lz_workers(u64* memory_requirement, void* state, u32 thread_count) {
+    *memory_requirement = sizeof(lz_workers_state);
+    if (state == 0) {
+        return true;
+    }
+    lz_workers_state* workers = state;
+    memset(workers, 0, sizeof(lz_workers_state));
+    if (!ring_queue_create(sizeof(lz_decompress_work*), LZ_TICKET_CAPACITY, &workers->tickets)) {
+        return false;
+    }
+    if (!pancake_semaphore_create(0, &workers->wake)) {
+        ring_queue_destroy(&workers->tickets);
+        return false;
+    }
+
+    workers->running = true;
+    workers_ptr = workers;
+    if (thread_count > LZ_MAX_THREADS) {
+        thread_count = LZ_MAX_THREADS;
+    }
+    // Frames are still decompressed without the threads that could not be started.
+    for (u32 i = 0; i < thread_count; ++i) {
+        if (pancake_thread_create(lz_worker_run, 0, &workers_ptr->threads[workers_ptr->thread_count])) {
+            workers_ptr->thread_count++;
+        }
+    }
+    return true;
+}
+
+void shutdown_lz_workers(void* state) {
+    if (!workers_ptr) {
+        return;
+    }
+    __atomic_store_n(&workers_ptr->running, false, __ATOMIC_RELEASE);
+    pancake_semaphore_signal(&workers_ptr->wake, workers_ptr->thread_count);
+    for (u32 i = 0; i < workers_ptr->thread_count; ++i) {
+        pancake_thread_wait(&workers_ptr->threads[i]);
+    }
+    pancake_semaphore_destroy(&workers_ptr->wake);
+    ring_queue_destroy(&workers_ptr->tickets);
+    workers_ptr = 0;
+}
+
+b8 lz_frame_decompress(const void* frame, u64 frame_size, void* dest, u64 dest_size, u32 thread_count) {
+    lz_decompress_work work = {0};
+    if (!lz_frame_get_info(frame, frame_size, &work.info) || work.info.size != dest_size) {
+        PANCAKE_ERROR("lz_frame_decompress - not a valid frame of %llu bytes.", dest_size);
+        return false;
+    }
+    work.frame = frame;
+    work.dest = dest;
+
+    // The calling thread works too, and does it all without workers.
+    u32 helpers = thread_count > 1 ? thread_count - 1 : 0;
+    u32 worker_count = workers_ptr ? workers_ptr->thread_count : 0;
+    if (helpers > worker_count) {
+        helpers = worker_count;
+    }
+    if (helpers >= work.info.block_count) {
+        helpers = work.info.block_count ? work.info.block_count - 1 : 0;
+    }
+    work.tickets = helpers;
+    lz_decompress_work* ticket = &work;
+    for (u32 i = 0; i < helpers; ++i) {
+        if (!ring_queue_push(&workers_ptr->tickets, &ticket)) {
+            // Busy enough already, the blocks are shared by the helpers that got in.
+            __atomic_sub_fetch(&work.tickets, helpers - i, __ATOMIC_RELEASE);
+            helpers = i;
+            break;
+        }
+    }
+    if (helpers) {
+        pancake_semaphore_signal(&workers_ptr->wake, helpers);
+    }
+
+    lz_decompress_run(&work);
+    // Every block is done, but a worker holding a ticket may still be looking at work.
+    while (__atomic_load_n(&work.tickets, __ATOMIC_ACQUIRE)) {
+        pancake_thread_yield();
+    }
+    return !__atomic_load_n(&work.failed, __ATOMIC_RELAXED);
+}
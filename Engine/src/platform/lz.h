@@ -0,0 +1,110 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    A fast LZ compressor (LZ4 family, byte oriented, no entropy coding) for assets: decompression
+    runs at memory speed, far ahead of the disk, so compressed assets load faster than raw ones.
+
+    Block format, a run of sequences:
+    token: literal count in the high 4 bits, match length - 4 in the low 4 bits, 15 meaning more
+           follows as bytes of 255 ended by a smaller byte
+    [literal count bytes] literals
+    u16 offset of the match, back from the current output position (little endian)
+    [match length bytes]
+    The last sequence stops after its literals. Matches end at least LZ_LAST_LITERALS before the
+    end of the block.
+
+    Frames cut the data into blocks compressed on their own, so any block can be decompressed
+    without the ones before it (random access), and blocks can be decompressed in parallel.
+    Frame layout (little endian)
+    lz_frame_header
+    u64 block_ends[block_count], the end of each block's data, from the end of this table
+    block data; a block as long as its uncompressed size is stored as is
+*/
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MAX_OFFSET 65535
+
+#define LZ_FRAME_MAGIC 0x5A4C4B50 // "PKLZ"
+#define LZ_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct lz_frame_header{
+    u32 magic;
+    u32 block_size;
+    // Uncompressed.
+    u64 size;
+    u32 block_count;
+    u32 reserved;
+} lz_frame_header;
+
+typedef struct lz_frame_info{
+    u64 size;
+    u32 block_size;
+    u32 block_count;
+} lz_frame_info;
+
+// The most a block of size bytes can take once compressed.
+PANCAKE_INLINE u64 lz_compress_bound(u64 size) {
+    return size + size / 255 + 16;
+}
+
+/**
+ * Compresses a block.
+ * @returns The compressed size, or 0 if it doesn't fit in capacity.
+ */
+PANCAKE_API u64 lz_compress_block(const void* source, u64 size, void* dest, u64 capacity);
+
+/**
+ * Decompresses a block, checking every length and offset against the buffers.
+ * @param dest_size The exact uncompressed size of the block.
+ * @returns True if the block is valid and decompressed to exactly dest_size bytes; otherwise false.
+ */
+PANCAKE_API b8 lz_decompress_block(const void* source, u64 size, void* dest, u64 dest_size);
+
+// The most a frame of size bytes can take.
+PANCAKE_API u64 lz_frame_bound(u64 size, u32 block_size);
+
+/**
+ * Compresses data into a frame of block_size blocks.
+ * @param block_size The uncompressed size of the blocks, 0 for LZ_DEFAULT_BLOCK_SIZE.
+ * @returns The size of the frame, or 0 if it doesn't fit in capacity (see lz_frame_bound).
+ */
+PANCAKE_API u64 lz_frame_compress(const void* source, u64 size, u32 block_size, void* dest, u64 capacity);
+
+/**
+ * Reads and checks the header and block table of a frame.
+ * @returns True if the frame is valid; otherwise false.
+ */
+PANCAKE_API b8 lz_frame_get_info(const void* frame, u64 frame_size, lz_frame_info* out_info);
+
+/**
+ * Decompresses a single block of a frame.
+ * @param dest Receives the block, block_size bytes (less for the last block).
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 lz_frame_decompress_block(const void* frame, u64 frame_size, u32 block_index, void* dest);
+
+/**
+ * @brief Starts the threads lz_frame_decompress spreads blocks over, kept until shutdown. Call twice;
+ * once with state = 0 to get required memory size, then a second time passing allocated memory to state.
+ * Without them frames are decompressed on the calling thread alone.
+ *
+ * @param memory_requirement A pointer to hold the required memory size of internal state.
+ * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ * @param thread_count The number of worker threads, at most 16.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 initialize_lz_workers(u64* memory_requirement, void* state, u32 thread_count);
+
+// Stops the worker threads, no frame may be being decompressed.
+PANCAKE_API void shutdown_lz_workers(void* state);
+
+/**
+ * Decompresses a whole frame, its blocks spread over up to thread_count threads: the calling one,
+ * and idle workers (see initialize_lz_workers). Safe to call from several threads at once.
+ * @param dest_size The size of dest, which must be the uncompressed size of the frame.
+ * @returns True if successful; otherwise false.
+ */
+PANCAKE_API b8 lz_frame_decompress(const void* frame, u64 frame_size, void* dest, u64 dest_size, u32 thread_count);
@@ -0,0 +1,328 @@
+#include "pack_file.h"
+#include "lz.h"
+
+#include "core/logger.h"
+#include "core/pancake_memory.h"
+#include "core/pancake_string.h"
+#include "core/string_id.h"
+#include "containers/list.h"
+
+#include <stdlib.h>  // qsort
+
+STATIC_ASSERT(sizeof(pack_header) == 48, "pack_header is read from files as is");
+STATIC_ASSERT(sizeof(pack_entry) == 40, "pack_entry is read from files as is");
+
+b8 pack_file_open(const char* path, pack_file* out_pack) {
+    pancake_zero_memory(out_pack, sizeof(pack_file));
+    if (!filesystem_map(path, FILE_MAP_HINT_RANDOM, &out_pack->view)) {
+        return false;
+    }
+
+    const u8* data = out_pack->view.data;
+    u64 size = out_pack->view.size;
+    const pack_header* header = (const pack_header*)data;
+    b8 valid = size >= sizeof(pack_header)
+        && header->magic == PACK_MAGIC
+        && header->version == PACK_VERSION
+        && header->index_offset % sizeof(u64) == 0
+        && header->index_offset <= size
+        && header->entry_count <= (size - header->index_offset) / sizeof(pack_entry)
+        && header->names_offset <= size
+        && header->names_size <= size - header->names_offset
+        && (header->names_size == 0 || data[header->names_offset + header->names_size - 1] == 0);
+    if (valid) {
+        const pack_entry* entries = (const pack_entry*)(data + header->index_offset);
+        for (u32 i = 0; i < header->entry_count && valid; ++i) {
+            // Stored entries are read as is, so they must be as large as they claim.
+            valid = entries[i].offset <= size
+                && entries[i].stored_size <= size - entries[i].offset
+                && entries[i].name_offset < header->names_size
+                && (entries[i].compression == PACK_COMPRESSION_LZ
+                    || (entries[i].compression == PACK_COMPRESSION_NONE && entries[i].size == entries[i].stored_size));
+        }
+    }
+    if (!valid) {
+        PANCAKE_ERROR("pack_file_open - '%s' is not a valid pack.", path);
+        filesystem_unmap(&out_pack->view);
+        return false;
+    }
+
+    out_pack->header = header;
+    out_pack->entries = (const pack_entry*)(data + header->index_offset);
+    out_pack->names = (const char*)data + header->names_offset;
+    return true;
+}
+
+void pack_file_close(pack_file* pack) {
+    filesystem_unmap(&pack->view);
+    pancake_zero_memory(pack, sizeof(pack_file));
+}
+
+const pack_entry* pack_file_find(const pack_file* pack, const char* path) {
+    if (!pack->header) {
+        return 0;
+    }
+    u64 hash = string_hash(path);
+
+    // First entry with a hash not below the one looked for.
+    u32 low = 0;
+    u32 high = pack->header->entry_count;
+    while (low < high) {
+        u32 middle = low + (high - low) / 2;
+        if (pack->entries[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    // Colliding paths sit next to each other.
+    for (u32 i = low; i < pack->header->entry_count && pack->entries[i].hash == hash; ++i) {
+        if (strings_equal(pack->names + pack->entries[i].name_offset, path)) {
+            return &pack->entries[i];
+        }
+    }
+    return 0;
+}
+
+static b8 pack_builder_write(pack_builder* builder, const void* data, u64 size) {
+    u64 written = 0;
+    if (size && !filesystem_write(&builder->file, size, data, &written)) {
+        PANCAKE_ERROR("pack_builder - failed to write %llu bytes.", size);
+        return false;
+    }
+    builder->offset += size;
+    return true;
+}
+
+// Pads the file with zeros up to the next multiple of alignment.
+static b8 pack_builder_align(pack_builder* builder, u64 alignment) {
+    static const u8 zeros[64] = {0};
+    u64 padding = (alignment - builder->offset % alignment) % alignment;
+    while (padding) {
+        u64 chunk = padding < sizeof(zeros) ? padding : sizeof(zeros);
+        if (!pack_builder_write(builder, zeros, chunk)) {
+            return false;
+        }
+        padding -= chunk;
+    }
+    return true;
+}
+
+b8 pack_builder_begin(const char* path, u32 alignment, pack_builder* out_builder) {
+    pancake_zero_memory(out_builder, sizeof(pack_builder));
+    if (alignment == 0) {
+        alignment = PACK_DEFAULT_ALIGNMENT;
+    }
+    if ((alignment & (alignment - 1)) != 0 || alignment < PACK_MIN_ALIGNMENT) {
+        PANCAKE_ERROR("pack_builder_begin - the alignment must be a power of 2 of at least %d, got %u.", PACK_MIN_ALIGNMENT, alignment);
+        return false;
+    }
+    if (!filesystem_open(path, FILE_MODE_WRITE, true, &out_builder->file)) {
+        return false;
+    }
+    out_builder->path = string_duplicate(path);
+    out_builder->alignment = alignment;
+    out_builder->entries = list_create(pack_entry);
+    string_builder_create(1024, 0, &out_builder->names);
+
+    // Written for real by pack_builder_end, once the index is known.
+    pack_header header = {0};
+    return pack_builder_write(out_builder, &header, sizeof(header));
+}
+
+static b8 pack_builder_add_entry(pack_builder* builder, const char* path, const void* data, u64 stored_size, u64 size, pack_compression compression) {
+    u64 hash = string_hash(path);
+    u64 count = list_length(builder->entries);
+    for (u64 i = 0; i < count; ++i) {
+        if (builder->entries[i].hash == hash && strings_equal(builder->names.data + builder->entries[i].name_offset, path)) {
+            PANCAKE_ERROR("pack_builder_add - '%s' is already in the pack.", path);
+            return false;
+        }
+    }
+    if (!pack_builder_align(builder, builder->alignment)) {
+        return false;
+    }
+
+    pack_entry entry = {0};
+    entry.hash = hash;
+    entry.offset = builder->offset;
+    entry.stored_size = stored_size;
+    entry.size = size;
+    entry.name_offset = (u32)builder->names.length;
+    entry.compression = (u16)compression;
+    if (!pack_builder_write(builder, data, stored_size)) {
+        return false;
+    }
+    list_push(builder->entries, entry);
+    // Names are separated by their terminators.
+    string_builder_append(&builder->names, path);
+    string_builder_append_char(&builder->names, 0);
+    return true;
+}
+
+b8 pack_builder_add(pack_builder* builder, const char* path, const void* data, u64 size) {
+    return pack_builder_add_entry(builder, path, data, size, size, PACK_COMPRESSION_NONE);
+}
+
+b8 pack_builder_add_compressed(pack_builder* builder, const char* path, const void* data, u64 size, u32 block_size) {
+    u64 capacity = lz_frame_bound(size, block_size);
+    u8* frame = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u64 frame_size = lz_frame_compress(data, size, block_size, frame, capacity);
+    b8 result;
+    if (frame_size && frame_size < size) {
+        result = pack_builder_add_entry(builder, path, frame, frame_size, size, PACK_COMPRESSION_LZ);
+    } else {
+        result = pack_builder_add_entry(builder, path, data, size, size, PACK_COMPRESSION_NONE);
+    }
+    pancake_free(frame, capacity, MEMORY_TAG_STRING);
+    return result;
+}
+
+b8 pack_builder_add_file(pack_builder* builder, const char* path, const char* source_path) {
+    file_view view;
+    if (!filesystem_map(source_path, FILE_MAP_HINT_SEQUENTIAL, &view)) {
+        return false;
+    }
+    b8 result = pack_builder_add(builder, path, view.data, view.size);
+    filesystem_unmap(&view);
+    return result;
+}
+
+#define PACK_MAX_PATH_LENGTH 512
+
+typedef struct pack_directory_walk {
+    pack_builder* builder;
+    b8 compress;
+    // The source path of the directory being walked.
+    char source[PACK_MAX_PATH_LENGTH];
+    u64 source_length;
+    // Its path in the pack.
+    char path[PACK_MAX_PATH_LENGTH];
+    u64 path_length;
+    b8 failed;
+} pack_directory_walk;
+
+static b8 pack_builder_add_walked_file(pack_directory_walk* walk) {
+    // The path in the pack starts after the '/' joining it to an empty prefix.
+    const char* path = walk->path[0] == '/' ? walk->path + 1 : walk->path;
+    if (!walk->compress) {
+        return pack_builder_add_file(walk->builder, path, walk->source);
+    }
+    file_view view;
+    if (!filesystem_map(walk->source, FILE_MAP_HINT_SEQUENTIAL, &view)) {
+        return false;
+    }
+    b8 result = pack_builder_add_compressed(walk->builder, path, view.data, view.size, 0);
+    filesystem_unmap(&view);
+    return result;
+}
+
+static void pack_builder_visit(const char* name, b8 is_directory, void* user_data) {
+    pack_directory_walk* walk = user_data;
+    u64 name_length = string_length(name);
+    if (walk->failed) {
+        return;
+    }
+    if (walk->source_length + name_length + 2 > PACK_MAX_PATH_LENGTH || walk->path_length + name_length + 2 > PACK_MAX_PATH_LENGTH) {
+        PANCAKE_ERROR("pack_builder_add_directory - the path of '%s' in '%s' is too long.", name, walk->source);
+        walk->failed = true;
+        return;
+    }
+
+    // Appended for the visit, cut off again after it.
+    u64 source_length = walk->source_length;
+    u64 path_length = walk->path_length;
+    walk->source[source_length] = '/';
+    pancake_copy_memory(walk->source + source_length + 1, name, name_length + 1);
+    walk->source_length = source_length + 1 + name_length;
+    walk->path[path_length] = '/';
+    pancake_copy_memory(walk->path + path_length + 1, name, name_length + 1);
+    walk->path_length = path_length + 1 + name_length;
+
+    if (is_directory) {
+        if (!filesystem_list_directory(walk->source, pack_builder_visit, walk)) {
+            PANCAKE_ERROR("pack_builder_add_directory - could not read the directory '%s'.", walk->source);
+            walk->failed = true;
+        }
+    } else if (!strings_equal(walk->source, walk->builder->path)) {
+        if (!pack_builder_add_walked_file(walk)) {
+            PANCAKE_ERROR("pack_builder_add_directory - could not add '%s'.", walk->source);
+            walk->failed = true;
+        }
+    }
+
+    walk->source_length = source_length;
+    walk->source[source_length] = 0;
+    walk->path_length = path_length;
+    walk->path[path_length] = 0;
+}
+
+b8 pack_builder_add_directory(pack_builder* builder, const char* directory, const char* prefix, b8 compress) {
+    pack_directory_walk walk = {0};
+    walk.builder = builder;
+    walk.compress = compress;
+
+    // Without a trailing separator, so the paths never hold two in a row.
+    u64 length = string_length(directory);
+    while (length > 1 && (directory[length - 1] == '/' || directory[length - 1] == '\\')) {
+        length--;
+    }
+    if (!prefix) {
+        u64 name_start = length;
+        while (name_start > 0 && directory[name_start - 1] != '/' && directory[name_start - 1] != '\\') {
+            name_start--;
+        }
+        prefix = directory + name_start;
+        walk.path_length = length - name_start;
+    } else {
+        walk.path_length = string_length(prefix);
+    }
+    if (length + 2 > PACK_MAX_PATH_LENGTH || walk.path_length + 2 > PACK_MAX_PATH_LENGTH) {
+        PANCAKE_ERROR("pack_builder_add_directory - the path of '%s' is too long.", directory);
+        return false;
+    }
+    pancake_copy_memory(walk.source, directory, length);
+    walk.source_length = length;
+    pancake_copy_memory(walk.path, prefix, walk.path_length);
+
+    if (!filesystem_list_directory(walk.source, pack_builder_visit, &walk)) {
+        PANCAKE_ERROR("pack_builder_add_directory - could not read the directory '%s'.", walk.source);
+        return false;
+    }
+    return !walk.failed;
+}
+
+static int pack_entry_compare(const void* a, const void* b) {
+    u64 hash_a = ((const pack_entry*)a)->hash;
+    u64 hash_b = ((const pack_entry*)b)->hash;
+    return hash_a < hash_b ? -1 : (hash_a > hash_b ? 1 : 0);
+}
+
+b8 pack_builder_end(pack_builder* builder) {
+    pack_header header = {0};
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.alignment = builder->alignment;
+    header.entry_count = (u32)list_length(builder->entries);
+    header.names_size = builder->names.length;
+    qsort(builder->entries, header.entry_count, sizeof(pack_entry), pack_entry_compare);
+
+    b8 result = pack_builder_align(builder, sizeof(u64));
+    header.index_offset = builder->offset;
+    result = result && pack_builder_write(builder, builder->entries, header.entry_count * sizeof(pack_entry));
+    header.names_offset = builder->offset;
+    result = result && pack_builder_write(builder, builder->names.data, builder->names.length);
+
+    u64 written = 0;
+    result = result
+        && filesystem_seek(&builder->file, 0)
+        && filesystem_write(&builder->file, sizeof(header), &header, &written);
+
+    filesystem_close(&builder->file);
+    pancake_free(builder->path, string_length(builder->path) + 1, MEMORY_TAG_STRING);
+    builder->path = 0;
+    list_destroy(builder->entries);
+    string_builder_destroy(&builder->names);
+    builder->entries = 0;
+    return result;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "defines.h"
+#include "platform/filesystem.h"
+#include "core/string_builder.h"
+
+/*
+    A pack holds many files (assets) in one, so loading them takes one open and one mapping
+    instead of an open per file. Mounted with filesystem_mount_pack, its files are then found by
+    filesystem_load under the path they were added with.
+
+    File layout (little endian)
+    pack_header
+    file data, each entry starting at a multiple of the alignment, stored as is or compressed
+    pack_entry[entry_count], sorted by hash
+    the paths of the entries, null-terminated
+*/
+
+#define PACK_MAGIC 0x4B504B50 // "PKPK"
+#define PACK_VERSION 1
+#define PACK_DEFAULT_ALIGNMENT 16
+// Entries are used in place from the mapping: SPIR-V handed to Vulkan must be 4 byte aligned,
+// and tables of u64 need 8.
+#define PACK_MIN_ALIGNMENT 8
+
+typedef enum pack_compression{
+    PACK_COMPRESSION_NONE = 0,
+    // An lz frame (see lz.h), its blocks can be decompressed on their own and in parallel.
+    PACK_COMPRESSION_LZ = 1
+} pack_compression;
+
+typedef struct pack_header{
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 alignment;
+    u64 index_offset;
+    u64 names_offset;
+    u64 names_size;
+    u64 reserved;
+} pack_header;
+
+typedef struct pack_entry{
+    // string_hash of the path.
+    u64 hash;
+    // From the start of the file.
+    u64 offset;
+    // The size in the pack, and once decompressed.
+    u64 stored_size;
+    u64 size;
+    // From names_offset.
+    u32 name_offset;
+    u16 compression;
+    u16 reserved;
+} pack_entry;
+
+// A pack opened for reading, mapped as a whole.
+typedef struct pack_file{
+    file_view view;
+    const pack_header* header;
+    const pack_entry* entries;
+    const char* names;
+} pack_file;
+
+/**
+ * Opens the pack at path, checking its header and index.
+ * @returns True if the file is a valid pack; otherwise false.
+ */
+PANCAKE_API b8 pack_file_open(const char* path, pack_file* out_pack);
+PANCAKE_API void pack_file_close(pack_file* pack);
+
+/**
+ * Looks an entry up by path, a binary search over the hashes.
+ * @returns The entry, or 0 if the pack has no such path.
+ */
+PANCAKE_API const pack_entry* pack_file_find(const pack_file* pack, const char* path);
+
+// The stored data of an entry, inside the mapping.
+PANCAKE_INLINE const u8* pack_file_entry_data(const pack_file* pack, const pack_entry* entry) {
+    return pack->view.data + entry->offset;
+}
+
+// Writes a pack: begin, add every file, end.
+typedef struct pack_builder{
+    file_handle file;
+    // The pack being written, never added to itself by pack_builder_add_directory.
+    char* path;
+    u32 alignment;
+    u64 offset;
+    // list of pack_entry
+    pack_entry* entries;
+    string_builder names;
+} pack_builder;
+
+/**
+ * Creates the pack file at path, replacing it.
+ * @param alignment Entries start at multiples of it, a power of 2 of at least PACK_MIN_ALIGNMENT;
+ * 0 for PACK_DEFAULT_ALIGNMENT.
+ */
+PANCAKE_API b8 pack_builder_begin(const char* path, u32 alignment, pack_builder* out_builder);
+
+// Adds a file to the pack under path, from memory.
+PANCAKE_API b8 pack_builder_add(pack_builder* builder, const char* path, const void* data, u64 size);
+
+/**
+ * Adds a file to the pack under path, from memory, compressed with lz. Stored as is if it
+ * doesn't get any smaller.
+ * @param block_size The lz block size, 0 for LZ_DEFAULT_BLOCK_SIZE.
+ */
+PANCAKE_API b8 pack_builder_add_compressed(pack_builder* builder, const char* path, const void* data, u64 size, u32 block_size);
+
+// Adds the file at source_path to the pack under path.
+PANCAKE_API b8 pack_builder_add_file(pack_builder* builder, const char* path, const char* source_path);
+
+/**
+ * Adds every file under directory, sub directories included. Each one goes in under the prefix
+ * followed by its path from directory, with '/' separators: the path the engine loads it by
+ * when it is run from where directory is. Packing "bin/assets", the file
+ * "bin/assets/shaders/Builtin.ObjectShader.vert.spv" is loaded as "assets/shaders/Builtin.ObjectShader.vert.spv".
+ * @param prefix Put before the paths, 0 for the name of directory ("assets" above), "" for nothing.
+ * @param compress Compresses the files as pack_builder_add_compressed does.
+ * @returns True if every file was added; otherwise false.
+ */
+PANCAKE_API b8 pack_builder_add_directory(pack_builder* builder, const char* directory, const char* prefix, b8 compress);
+
+// Writes the index and closes the file.
+PANCAKE_API b8 pack_builder_end(pack_builder* builder);
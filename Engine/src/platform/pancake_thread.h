@@ -0,0 +1,58 @@
+#pragma once
+
+#include "defines.h"
+
+// The function run by a thread. The returned value is ignored for now.
+typedef u32 (*pfn_thread_start)(void* params);
+
+// Holds a handle to a thread.
+typedef struct pancake_thread {
+    // Opaque handle to the platform thread.
+    void* internal_data;
+    u64 thread_id;
+} pancake_thread;
+
+/**
+ * Starts a new thread running start_function.
+ * @param start_function The function the thread runs.
+ * @param params Passed to start_function as is.
+ * @param out_thread A pointer to hold the created thread.
+ * @returns True if the thread was started; otherwise false.
+ */
+PANCAKE_API b8 pancake_thread_create(pfn_thread_start start_function, void* params, pancake_thread* out_thread);
+
+/**
+ * Blocks until the thread has finished, then releases its handle.
+ * @param thread The thread to wait on.
+ * @returns True on success; otherwise false.
+ */
+PANCAKE_API b8 pancake_thread_wait(pancake_thread* thread);
+
+// Gives the rest of the calling thread's time slice back to the OS.
+PANCAKE_API void pancake_thread_yield();
+
+// Returns an identifier of the calling thread.
+PANCAKE_API u64 pancake_thread_current_id();
+
+// Counts signals; waiting blocks while the count is 0, so idle threads sleep until there is work.
+typedef struct pancake_semaphore {
+    // Opaque handle to the platform semaphore.
+    void* internal_data;
+} pancake_semaphore;
+
+/**
+ * Creates a semaphore.
+ * @param initial_count The count it starts with.
+ * @param out_semaphore A pointer to hold the created semaphore.
+ * @returns True if the semaphore was created; otherwise false.
+ */
+PANCAKE_API b8 pancake_semaphore_create(u32 initial_count, pancake_semaphore* out_semaphore);
+
+// Releases the semaphore, no thread may be waiting on it.
+PANCAKE_API void pancake_semaphore_destroy(pancake_semaphore* semaphore);
+
+// Adds count to the semaphore, waking up to count waiting threads.
+PANCAKE_API void pancake_semaphore_signal(pancake_semaphore* semaphore, u32 count);
+
+// Blocks until the count is above 0, then takes one from it.
+PANCAKE_API void pancake_semaphore_wait(pancake_semaphore* semaphore);
@@ -16,6 +16,11 @@ void platform_system_shutdown(void* plat_state);
 
 b8 platform_pump_messages();
 
+//starts a thread that reads the window's input as soon as it arrives, so it is timestamped on arrival
+//and queued in order; platform_pump_messages then consumes the queue instead of reading the window.
+//returns false if the platform can't do it, input is then read by platform_pump_messages as before.
+b8 platform_input_thread_start();
+
 void* platform_allocate(u64 size,b8 aligned);
 void platform_free(void* block,b8 aligned);
 void* platform_zero_memory(void* block, u64 size);
@@ -31,3 +36,27 @@ f64 platform_get_absolute_time();
 //should only be used to give time back to the OS for unused update power
 //there for it isn't exported.
 void platform_sleep(u64 ms);
+
+//called on the thread that crashed (fatal signal or unhandled exception), right before the process dies.
+typedef void (*pfn_crash_handler)();
+//installs the crash handler, 0 removes it. it runs inside a signal handler, with the process in an
+//unknown state: only async signal safe work belongs there (no locks, no allocation, no stdio or
+//printf style formatting), the code that crashed may hold any of them.
+//the main thread and those started with pancake_thread_create keep stack aside for it, so a stack
+//overflow runs the handler too.
+void platform_set_crash_handler(pfn_crash_handler handler);
+
+typedef struct platform_file_mapping{
+    void* memory;
+    u64 size;
+    //platform specific handles
+    void* internal[2];
+}platform_file_mapping;
+
+//maps the file at path into memory for reading and writing, creating it if needed and resizing it to size.
+//what is written to the memory reaches the file through the OS, even if the process dies right after.
+b8 platform_file_map_writable(const char* path, u64 size, platform_file_mapping* out_mapping);
+//maps the existing file at path into memory, read only. sequential hints the OS to read ahead of the
+//first access and drop pages behind it, otherwise pages are read as they are touched.
+b8 platform_file_map_read(const char* path, b8 sequential, platform_file_mapping* out_mapping);
+void platform_file_unmap(platform_file_mapping* mapping);
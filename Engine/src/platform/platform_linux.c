@@ -1,4 +1,5 @@
 #include "platform/platform.h"
+#include "platform/pancake_thread.h"
 
 // Linux platform layer.
 #if PANCAKE_PLATFORM_LINUX
@@ -7,6 +8,7 @@
 #include "core/event.h"
 #include "core/inputs.h"
 #include "containers/list.h"
+#include "containers/ring_queue.h"
 
 #include <xcb/xcb.h>
 #include <X11/keysym.h>
@@ -14,6 +16,13 @@
 #include <X11/Xlib.h>
 #include <X11/Xlib-xcb.h>  // sudo apt-get install libxkbcommon-x11-dev
 #include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>  // sched_yield
+#include <sys/mman.h>  // mmap
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h>
 
 #if _POSIX_C_SOURCE >= 199309L
 #include <time.h>  // nanosleep
@@ -38,8 +47,21 @@ typedef struct platform_state  {
     xcb_atom_t wm_protocols;
     xcb_atom_t wm_delete_win;
     VkSurfaceKHR surface;
+
+    //optional input thread, see platform_input_thread_start
+    b8 input_thread_running;
+    pancake_thread input_thread;
+    ring_queue input_queue;
 } platform_state ;
 
+//events read by the input thread, with the time they were received
+typedef struct queued_xcb_event {
+    xcb_generic_event_t* event;
+    f64 time;
+} queued_xcb_event;
+
+#define INPUT_THREAD_QUEUE_CAPACITY 1024
+
 static platform_state* state_ptr;
 
 // Key translation
@@ -60,6 +82,9 @@ b8 platform_system_startup(
 
     state_ptr = state;
 
+    // Xlib is used from the main thread while the input thread may be reading the connection.
+    XInitThreads();
+
     // Connect to X
     state_ptr->display = XOpenDisplay(NULL);
 
@@ -177,8 +202,12 @@ b8 platform_system_startup(
     return true;
 }
 
+static void input_thread_stop();
+
 void platform_system_shutdown(void* plat_state) {
     if(state_ptr){
+        input_thread_stop();
+
         // Turn key repeats back on since this is global for the OS... just... wow.
         XAutoRepeatOn(state_ptr->display);
 
@@ -186,29 +215,93 @@ void platform_system_shutdown(void* plat_state) {
     }
 }
 
+static u32 input_thread_run(void* params) {
+    while (__atomic_load_n(&state_ptr->input_thread_running, __ATOMIC_ACQUIRE)) {
+        // Blocks until something arrives, null once the connection is gone.
+        xcb_generic_event_t* event = xcb_wait_for_event(state_ptr->connection);
+        if (!event) {
+            break;
+        }
+
+        queued_xcb_event entry = {event, platform_get_absolute_time()};
+        // Never drop input, wait for the main thread to make room.
+        while (!ring_queue_push(&state_ptr->input_queue, &entry)) {
+            if (!__atomic_load_n(&state_ptr->input_thread_running, __ATOMIC_ACQUIRE)) {
+                free(event);
+                return 0;
+            }
+            pancake_thread_yield();
+        }
+    }
+    return 0;
+}
+
+b8 platform_input_thread_start() {
+    if (!state_ptr || state_ptr->input_thread_running) {
+        return false;
+    }
+
+    ring_queue_create(sizeof(queued_xcb_event), INPUT_THREAD_QUEUE_CAPACITY, &state_ptr->input_queue);
+    __atomic_store_n(&state_ptr->input_thread_running, true, __ATOMIC_RELEASE);
+    if (!pancake_thread_create(input_thread_run, 0, &state_ptr->input_thread)) {
+        state_ptr->input_thread_running = false;
+        ring_queue_destroy(&state_ptr->input_queue);
+        return false;
+    }
+    PANCAKE_INFO("Input thread started.");
+    return true;
+}
+
+static void input_thread_stop() {
+    if (!state_ptr->input_thread_running) {
+        return;
+    }
+    __atomic_store_n(&state_ptr->input_thread_running, false, __ATOMIC_RELEASE);
+
+    // Wake the thread out of xcb_wait_for_event with a message to our own window.
+    xcb_client_message_event_t wake = {0};
+    wake.response_type = XCB_CLIENT_MESSAGE;
+    wake.format = 32;
+    wake.window = state_ptr->window;
+    wake.type = state_ptr->wm_protocols;
+    xcb_send_event(state_ptr->connection, 0, state_ptr->window, XCB_EVENT_MASK_NO_EVENT, (const char*)&wake);
+    xcb_flush(state_ptr->connection);
+    pancake_thread_wait(&state_ptr->input_thread);
+
+    queued_xcb_event entry;
+    while (ring_queue_pop(&state_ptr->input_queue, &entry)) {
+        free(entry.event);
+    }
+    ring_queue_destroy(&state_ptr->input_queue);
+}
+
+// The next event to handle and when it arrived, from the input thread's queue if it runs.
+static xcb_generic_event_t* next_event(f64* out_time) {
+    if (state_ptr->input_thread_running) {
+        queued_xcb_event entry;
+        if (ring_queue_pop(&state_ptr->input_queue, &entry)) {
+            *out_time = entry.time;
+            return entry.event;
+        }
+        return 0;
+    }
+
+    xcb_generic_event_t* event = xcb_poll_for_event(state_ptr->connection);
+    *out_time = platform_get_absolute_time();
+    return event;
+}
+
 b8 platform_pump_messages() {
      if (state_ptr) {
 
         xcb_generic_event_t* event;
         xcb_client_message_event_t* cm;
+        f64 time = 0;
 
         b8 quit_flagged = false;
 
-        // Poll for events until null is returned.
-        while (event != 0) {
-            event = xcb_poll_for_event(state_ptr->connection);
-            if (event == 0) {
-                break;
-            }
-
-            // Input events
-            // Poll for events until null is returned.
-        while (event != 0) {
-            event = xcb_poll_for_event(state_ptr->connection);
-            if (event == 0) {
-                break;
-            }
-
+        // Handle events until null is returned.
+        while ((event = next_event(&time)) != 0) {
             // Input events
             switch (event->response_type & ~0x80) {
                 case XCB_KEY_PRESS:
@@ -226,13 +319,13 @@ b8 platform_pump_messages() {
                     keys key = translate_keycode(key_sym);
 
                     // Pass to the input subsystem for processing.
-                    input_process_key(key, pressed);
+                    input_process_key(key, pressed, time);
                 } break;
                 case XCB_BUTTON_PRESS:
                 case XCB_BUTTON_RELEASE: {
                     xcb_button_press_event_t* mouse_event = (xcb_button_press_event_t*)event;
                     b8 pressed = event->response_type == XCB_BUTTON_PRESS;
-                    buttons mouse_button = BUTTON_MAX_BUTTONS;
+                    m_buttons mouse_button = BUTTON_MAX_BUTTONS;
                     switch (mouse_event->detail) {
                         case XCB_BUTTON_INDEX_1:
                             mouse_button = BUTTON_LEFT;
@@ -247,15 +340,15 @@ b8 platform_pump_messages() {
 
                     // Pass over to the input subsystem.
                     if (mouse_button != BUTTON_MAX_BUTTONS) {
-                        input_process_button(mouse_button, pressed);
+                        input_process_mouse_button(mouse_button, pressed, time);
                     }
                 } break;
                 case XCB_MOTION_NOTIFY: {
                     // Mouse move
                     xcb_motion_notify_event_t* move_event = (xcb_motion_notify_event_t*)event;
 
-                    // Pass over to the input subsystem.
-                    input_process_mouse_move(move_event->event_x, move_event->event_y);
+                    // Pass over to the input subsystem, which coalesces all moves of a frame into one event.
+                    input_process_mouse_move(move_event->event_x, move_event->event_y, time);
                 } break;
                 case XCB_CONFIGURE_NOTIFY: {
                     // Resizing - note that this is also triggered by moving the window, but should be
@@ -268,7 +361,7 @@ b8 platform_pump_messages() {
                     event_context context;
                     context.data.u16[0] = configure_event->width;
                     context.data.u16[1] = configure_event->height;
-                    event_fire(EVENT_CODE_RESIZED, 0, context);
+                    fire_event(EVENT_CODE_RESIZED, 0, context);
 
                 } break;
 
@@ -339,6 +432,237 @@ void platform_sleep(u64 ms) {
 #endif
 }
 
+// Threads
+typedef struct linux_thread_start {
+    pfn_thread_start function;
+    void* params;
+} linux_thread_start;
+
+// The stack crash handlers run on, so they still run when a thread overflows its own.
+#define CRASH_STACK_SIZE (64 * 1024)
+
+static void* linux_thread_entry(void* arg) {
+    // Copy out and release the start info before running the thread's work.
+    linux_thread_start start = *(linux_thread_start*)arg;
+    free(arg);
+
+    stack_t crash_stack = {0};
+    crash_stack.ss_sp = malloc(CRASH_STACK_SIZE);
+    crash_stack.ss_size = CRASH_STACK_SIZE;
+    b8 has_crash_stack = crash_stack.ss_sp && sigaltstack(&crash_stack, 0) == 0;
+
+    start.function(start.params);
+
+    if (has_crash_stack) {
+        stack_t disable = {0};
+        disable.ss_flags = SS_DISABLE;
+        sigaltstack(&disable, 0);
+    }
+    free(crash_stack.ss_sp);
+    return 0;
+}
+
+b8 pancake_thread_create(pfn_thread_start start_function, void* params, pancake_thread* out_thread) {
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    linux_thread_start* start = malloc(sizeof(linux_thread_start));
+    start->function = start_function;
+    start->params = params;
+
+    pthread_t thread;
+    i32 result = pthread_create(&thread, 0, linux_thread_entry, start);
+    if (result != 0) {
+        PANCAKE_ERROR("pancake_thread_create - pthread_create failed with error %d.", result);
+        free(start);
+        return false;
+    }
+
+    out_thread->thread_id = (u64)thread;
+    out_thread->internal_data = malloc(sizeof(pthread_t));
+    *(pthread_t*)out_thread->internal_data = thread;
+    return true;
+}
+
+b8 pancake_thread_wait(pancake_thread* thread) {
+    if (!thread || !thread->internal_data) {
+        return false;
+    }
+
+    i32 result = pthread_join(*(pthread_t*)thread->internal_data, 0);
+    free(thread->internal_data);
+    thread->internal_data = 0;
+    thread->thread_id = 0;
+    return result == 0;
+}
+
+void pancake_thread_yield() {
+    sched_yield();
+}
+
+u64 pancake_thread_current_id() {
+    return (u64)pthread_self();
+}
+
+// Semaphores, from a mutex and a condition variable (macOS has no unnamed POSIX semaphores).
+typedef struct posix_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    u32 count;
+} posix_semaphore;
+
+b8 pancake_semaphore_create(u32 initial_count, pancake_semaphore* out_semaphore) {
+    posix_semaphore* semaphore = malloc(sizeof(posix_semaphore));
+    if (pthread_mutex_init(&semaphore->mutex, 0) != 0) {
+        free(semaphore);
+        return false;
+    }
+    if (pthread_cond_init(&semaphore->condition, 0) != 0) {
+        pthread_mutex_destroy(&semaphore->mutex);
+        free(semaphore);
+        return false;
+    }
+    semaphore->count = initial_count;
+    out_semaphore->internal_data = semaphore;
+    return true;
+}
+
+void pancake_semaphore_destroy(pancake_semaphore* semaphore) {
+    posix_semaphore* internal = semaphore->internal_data;
+    if (internal) {
+        pthread_cond_destroy(&internal->condition);
+        pthread_mutex_destroy(&internal->mutex);
+        free(internal);
+        semaphore->internal_data = 0;
+    }
+}
+
+void pancake_semaphore_signal(pancake_semaphore* semaphore, u32 count) {
+    posix_semaphore* internal = semaphore->internal_data;
+    pthread_mutex_lock(&internal->mutex);
+    internal->count += count;
+    if (count == 1) {
+        pthread_cond_signal(&internal->condition);
+    } else if (count > 1) {
+        pthread_cond_broadcast(&internal->condition);
+    }
+    pthread_mutex_unlock(&internal->mutex);
+}
+
+void pancake_semaphore_wait(pancake_semaphore* semaphore) {
+    posix_semaphore* internal = semaphore->internal_data;
+    pthread_mutex_lock(&internal->mutex);
+    while (internal->count == 0) {
+        pthread_cond_wait(&internal->condition, &internal->mutex);
+    }
+    internal->count--;
+    pthread_mutex_unlock(&internal->mutex);
+}
+
+// Crash handling
+static pfn_crash_handler crash_handler = 0;
+
+static void platform_on_crash_signal(int signal) {
+    // Only once, a crash inside the handler goes straight to the default action.
+    pfn_crash_handler handler = crash_handler;
+    crash_handler = 0;
+    if (handler) {
+        handler();
+    }
+    // SA_RESETHAND put the default action back, raising again ends the process as it would have.
+    raise(signal);
+}
+
+void platform_set_crash_handler(pfn_crash_handler handler) {
+    static const int signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+    // A stack overflow leaves no stack to run the handler on, give it its own. This covers the
+    // thread installing the handler, the main one; the others get theirs in linux_thread_entry.
+    static char alternate_stack[CRASH_STACK_SIZE];
+    crash_handler = handler;
+    if (handler) {
+        stack_t stack = {0};
+        stack.ss_sp = alternate_stack;
+        stack.ss_size = sizeof(alternate_stack);
+        sigaltstack(&stack, 0);
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = handler ? platform_on_crash_signal : SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    for (u32 i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+        sigaction(signals[i], &action, 0);
+    }
+}
+
+// File mapping
+b8 platform_file_map_writable(const char* path, u64 size, platform_file_mapping* out_mapping) {
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    i32 fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        PANCAKE_ERROR("platform_file_map_writable - could not open '%s'.", path);
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        PANCAKE_ERROR("platform_file_map_writable - could not resize '%s' to %llu bytes.", path, size);
+        close(fd);
+        return false;
+    }
+    void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open.
+    close(fd);
+    if (memory == MAP_FAILED) {
+        PANCAKE_ERROR("platform_file_map_writable - could not map '%s'.", path);
+        return false;
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = size;
+    return true;
+}
+
+b8 platform_file_map_read(const char* path, b8 sequential, platform_file_mapping* out_mapping) {
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PANCAKE_ERROR("platform_file_map_read - could not open '%s'.", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        PANCAKE_ERROR("platform_file_map_read - could not get the size of '%s'.", path);
+        close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        // Nothing to map, an empty view.
+        close(fd);
+        return true;
+    }
+    void* memory = mmap(0, (u64)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        PANCAKE_ERROR("platform_file_map_read - could not map '%s'.", path);
+        return false;
+    }
+    if (sequential) {
+        madvise(memory, (u64)info.st_size, MADV_SEQUENTIAL);
+        madvise(memory, (u64)info.st_size, MADV_WILLNEED);
+    } else {
+        madvise(memory, (u64)info.st_size, MADV_RANDOM);
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = (u64)info.st_size;
+    return true;
+}
+
+void platform_file_unmap(platform_file_mapping* mapping) {
+    if (mapping && mapping->memory) {
+        munmap(mapping->memory, mapping->size);
+        platform_zero_memory(mapping, sizeof(platform_file_mapping));
+    }
+}
+
 void platform_get_required_extensions(const char ***names_list){
     list_push(*names_list, &"VK_KHR_xcb_surface");
 }
@@ -1,10 +1,11 @@
 #include <platform/platform.h>
+#include "platform/pancake_thread.h"
 
 #if PANCAKE_PLATFORM_APPLE
 
 #include "containers\list.h"
 #include "core/event.h"
-#include "core/input.h"
+#include "core/inputs.h"
 #include "core/pancake_string.h"
 #include "core/logger.h"
 #include "renderer/vulkan/vulkan_types.inl"  // For surface creation.
@@ -21,6 +22,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>  // sched_yield
+#include <sys/mman.h>  // mmap
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h>
 
 typedef struct platform_state {
     GLFWwindow* glfw_window;
@@ -151,6 +159,243 @@ void platform_sleep(u64 ms) {
     nanosleep(&ts, 0);
 }
 
+b8 platform_input_thread_start(void) {
+    // GLFW callbacks only run on the main thread.
+    PANCAKE_WARN("platform_input_thread_start - not supported on macOS, input is read when messages are pumped.");
+    return false;
+}
+
+// Threads
+typedef struct macos_thread_start {
+    pfn_thread_start function;
+    void* params;
+} macos_thread_start;
+
+// The stack crash handlers run on, so they still run when a thread overflows its own.
+#define CRASH_STACK_SIZE (64 * 1024)
+
+static void* macos_thread_entry(void* arg) {
+    // Copy out and release the start info before running the thread's work.
+    macos_thread_start start = *(macos_thread_start*)arg;
+    free(arg);
+
+    stack_t crash_stack = {0};
+    crash_stack.ss_sp = malloc(CRASH_STACK_SIZE);
+    crash_stack.ss_size = CRASH_STACK_SIZE;
+    b8 has_crash_stack = crash_stack.ss_sp && sigaltstack(&crash_stack, 0) == 0;
+
+    start.function(start.params);
+
+    if (has_crash_stack) {
+        stack_t disable = {0};
+        disable.ss_flags = SS_DISABLE;
+        sigaltstack(&disable, 0);
+    }
+    free(crash_stack.ss_sp);
+    return 0;
+}
+
+b8 pancake_thread_create(pfn_thread_start start_function, void* params, pancake_thread* out_thread) {
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    macos_thread_start* start = malloc(sizeof(macos_thread_start));
+    start->function = start_function;
+    start->params = params;
+
+    pthread_t thread;
+    i32 result = pthread_create(&thread, 0, macos_thread_entry, start);
+    if (result != 0) {
+        PANCAKE_ERROR("pancake_thread_create - pthread_create failed with error %d.", result);
+        free(start);
+        return false;
+    }
+
+    out_thread->thread_id = (u64)thread;
+    out_thread->internal_data = malloc(sizeof(pthread_t));
+    *(pthread_t*)out_thread->internal_data = thread;
+    return true;
+}
+
+b8 pancake_thread_wait(pancake_thread* thread) {
+    if (!thread || !thread->internal_data) {
+        return false;
+    }
+
+    i32 result = pthread_join(*(pthread_t*)thread->internal_data, 0);
+    free(thread->internal_data);
+    thread->internal_data = 0;
+    thread->thread_id = 0;
+    return result == 0;
+}
+
+void pancake_thread_yield() {
+    sched_yield();
+}
+
+u64 pancake_thread_current_id() {
+    return (u64)pthread_self();
+}
+
+// Semaphores, from a mutex and a condition variable (macOS has no unnamed POSIX semaphores).
+typedef struct posix_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    u32 count;
+} posix_semaphore;
+
+b8 pancake_semaphore_create(u32 initial_count, pancake_semaphore* out_semaphore) {
+    posix_semaphore* semaphore = malloc(sizeof(posix_semaphore));
+    if (pthread_mutex_init(&semaphore->mutex, 0) != 0) {
+        free(semaphore);
+        return false;
+    }
+    if (pthread_cond_init(&semaphore->condition, 0) != 0) {
+        pthread_mutex_destroy(&semaphore->mutex);
+        free(semaphore);
+        return false;
+    }
+    semaphore->count = initial_count;
+    out_semaphore->internal_data = semaphore;
+    return true;
+}
+
+void pancake_semaphore_destroy(pancake_semaphore* semaphore) {
+    posix_semaphore* internal = semaphore->internal_data;
+    if (internal) {
+        pthread_cond_destroy(&internal->condition);
+        pthread_mutex_destroy(&internal->mutex);
+        free(internal);
+        semaphore->internal_data = 0;
+    }
+}
+
+void pancake_semaphore_signal(pancake_semaphore* semaphore, u32 count) {
+    posix_semaphore* internal = semaphore->internal_data;
+    pthread_mutex_lock(&internal->mutex);
+    internal->count += count;
+    if (count == 1) {
+        pthread_cond_signal(&internal->condition);
+    } else if (count > 1) {
+        pthread_cond_broadcast(&internal->condition);
+    }
+    pthread_mutex_unlock(&internal->mutex);
+}
+
+void pancake_semaphore_wait(pancake_semaphore* semaphore) {
+    posix_semaphore* internal = semaphore->internal_data;
+    pthread_mutex_lock(&internal->mutex);
+    while (internal->count == 0) {
+        pthread_cond_wait(&internal->condition, &internal->mutex);
+    }
+    internal->count--;
+    pthread_mutex_unlock(&internal->mutex);
+}
+
+// Crash handling
+static pfn_crash_handler crash_handler = 0;
+
+static void platform_on_crash_signal(int signal) {
+    // Only once, a crash inside the handler goes straight to the default action.
+    pfn_crash_handler handler = crash_handler;
+    crash_handler = 0;
+    if (handler) {
+        handler();
+    }
+    // SA_RESETHAND put the default action back, raising again ends the process as it would have.
+    raise(signal);
+}
+
+void platform_set_crash_handler(pfn_crash_handler handler) {
+    static const int signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+    // A stack overflow leaves no stack to run the handler on, give it its own. This covers the
+    // thread installing the handler, the main one; the others get theirs in macos_thread_entry.
+    static char alternate_stack[CRASH_STACK_SIZE];
+    crash_handler = handler;
+    if (handler) {
+        stack_t stack = {0};
+        stack.ss_sp = alternate_stack;
+        stack.ss_size = sizeof(alternate_stack);
+        sigaltstack(&stack, 0);
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = handler ? platform_on_crash_signal : SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    for (u32 i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+        sigaction(signals[i], &action, 0);
+    }
+}
+
+// File mapping
+b8 platform_file_map_writable(const char* path, u64 size, platform_file_mapping* out_mapping) {
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    i32 fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        PANCAKE_ERROR("platform_file_map_writable - could not open '%s'.", path);
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        PANCAKE_ERROR("platform_file_map_writable - could not resize '%s' to %llu bytes.", path, size);
+        close(fd);
+        return false;
+    }
+    void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open.
+    close(fd);
+    if (memory == MAP_FAILED) {
+        PANCAKE_ERROR("platform_file_map_writable - could not map '%s'.", path);
+        return false;
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = size;
+    return true;
+}
+
+b8 platform_file_map_read(const char* path, b8 sequential, platform_file_mapping* out_mapping) {
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PANCAKE_ERROR("platform_file_map_read - could not open '%s'.", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        PANCAKE_ERROR("platform_file_map_read - could not get the size of '%s'.", path);
+        close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        // Nothing to map, an empty view.
+        close(fd);
+        return true;
+    }
+    void* memory = mmap(0, (u64)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        PANCAKE_ERROR("platform_file_map_read - could not map '%s'.", path);
+        return false;
+    }
+    if (sequential) {
+        madvise(memory, (u64)info.st_size, MADV_SEQUENTIAL);
+        madvise(memory, (u64)info.st_size, MADV_WILLNEED);
+    } else {
+        madvise(memory, (u64)info.st_size, MADV_RANDOM);
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = (u64)info.st_size;
+    return true;
+}
+
+void platform_file_unmap(platform_file_mapping* mapping) {
+    if (mapping && mapping->memory) {
+        munmap(mapping->memory, mapping->size);
+        platform_zero_memory(mapping, sizeof(platform_file_mapping));
+    }
+}
+
 void platform_get_required_extensions(const char*** names_list) {
     u32 count = 0;
     const char** extensions = glfwGetRequiredInstanceExtensions(&count);
@@ -185,7 +430,7 @@ static void platform_key_callback(GLFWwindow* window, int key, int scancode, int
     keys our_key = translate_key(key);
     if (our_key != KEYS_MAX_KEYS) {
         b8 pressed = action == GLFW_PRESS || action == GLFW_REPEAT;
-        input_process_key(our_key, pressed);
+        input_process_key(our_key, pressed, platform_get_absolute_time());
     }
 }
 
@@ -208,12 +453,12 @@ static void platform_mouse_button_callback(GLFWwindow* window, int button, int a
 
     if (mouse_button != BUTTON_MAX_BUTTONS) {
         b8 pressed = action == GLFW_PRESS;
-        input_process_button(mouse_button, pressed);
+        input_process_mouse_button(mouse_button, pressed, platform_get_absolute_time());
     }
 }
 
 static void platform_cursor_position_callback(GLFWwindow* window, f64 xpos, f64 ypos) {
-    input_process_mouse_move((i16)xpos, (i16)ypos);
+    input_process_mouse_move((i16)xpos, (i16)ypos, platform_get_absolute_time());
 }
 
 static void platform_scroll_callback(GLFWwindow* window, f64 xoffset, f64 yoffset) {
@@ -222,7 +467,7 @@ static void platform_scroll_callback(GLFWwindow* window, f64 xoffset, f64 yoffse
     if (z_delta != 0) {
         z_delta = (z_delta < 0) ? -1 : 1;
     }
-    input_process_mouse_wheel(z_delta);
+    input_process_mouse_wheel(z_delta, platform_get_absolute_time());
 }
 
 static void platform_framebuffer_size_callback(GLFWwindow* window, int width, int height) {
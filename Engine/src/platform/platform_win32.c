@@ -1,5 +1,6 @@
 #include "defines.h"
 #include "platform/platform.h"
+#include "platform/pancake_thread.h"
 
 //Windows Platform Layer
 #if PANCAKE_PLATFORM_WINDOWS
@@ -12,6 +13,7 @@
 #include <Windows.h>
 #include <windowsx.h> // parameters input extraction
 #include <stdlib.h>
+#include <signal.h>
 
 //vulkan includes
 #include "vulkan/vulkan.h"
@@ -205,6 +207,214 @@ void platform_sleep(u64 ms){
     Sleep(ms);
 }
 
+b8 platform_input_thread_start(){
+    //window messages can only be read by the thread that created the window
+    PANCAKE_WARN("platform_input_thread_start - not supported on Windows, input is read when messages are pumped.");
+    return false;
+}
+
+//threads
+typedef struct win32_thread_start{
+    pfn_thread_start function;
+    void* params;
+}win32_thread_start;
+
+//stack kept back for crash handlers, so they still run when a thread overflows its own
+#define CRASH_STACK_SIZE (64 * 1024)
+
+static DWORD WINAPI win32_thread_entry(LPVOID arg){
+    //copy out and release the start info before running the thread's work
+    win32_thread_start start = *(win32_thread_start*)arg;
+    free(arg);
+    ULONG crash_stack_size = CRASH_STACK_SIZE;
+    SetThreadStackGuarantee(&crash_stack_size);
+    return start.function(start.params);
+}
+
+b8 pancake_thread_create(pfn_thread_start start_function, void* params, pancake_thread* out_thread){
+    if(!start_function || !out_thread){
+        return false;
+    }
+
+    win32_thread_start* start = malloc(sizeof(win32_thread_start));
+    start->function = start_function;
+    start->params = params;
+
+    DWORD thread_id = 0;
+    HANDLE thread = CreateThread(0, 0, win32_thread_entry, start, 0, &thread_id);
+    if(!thread){
+        PANCAKE_ERROR("pancake_thread_create - CreateThread failed with error %d.", GetLastError());
+        free(start);
+        return false;
+    }
+
+    out_thread->internal_data = thread;
+    out_thread->thread_id = thread_id;
+    return true;
+}
+
+b8 pancake_thread_wait(pancake_thread* thread){
+    if(!thread || !thread->internal_data){
+        return false;
+    }
+
+    DWORD result = WaitForSingleObject((HANDLE)thread->internal_data, INFINITE);
+    CloseHandle((HANDLE)thread->internal_data);
+    thread->internal_data = 0;
+    thread->thread_id = 0;
+    return result == WAIT_OBJECT_0;
+}
+
+void pancake_thread_yield(){
+    SwitchToThread();
+}
+
+u64 pancake_thread_current_id(){
+    return (u64)GetCurrentThreadId();
+}
+
+//semaphores
+b8 pancake_semaphore_create(u32 initial_count, pancake_semaphore* out_semaphore){
+    HANDLE semaphore = CreateSemaphoreA(0, initial_count, 0x7FFFFFFF, 0);
+    if(!semaphore){
+        PANCAKE_ERROR("pancake_semaphore_create - CreateSemaphore failed with error %d.", GetLastError());
+        return false;
+    }
+    out_semaphore->internal_data = semaphore;
+    return true;
+}
+
+void pancake_semaphore_destroy(pancake_semaphore* semaphore){
+    if(semaphore->internal_data){
+        CloseHandle((HANDLE)semaphore->internal_data);
+        semaphore->internal_data = 0;
+    }
+}
+
+void pancake_semaphore_signal(pancake_semaphore* semaphore, u32 count){
+    if(count){
+        ReleaseSemaphore((HANDLE)semaphore->internal_data, count, 0);
+    }
+}
+
+void pancake_semaphore_wait(pancake_semaphore* semaphore){
+    WaitForSingleObject((HANDLE)semaphore->internal_data, INFINITE);
+}
+
+// Crash handling
+static pfn_crash_handler crash_handler = 0;
+
+static void win32_run_crash_handler(){
+    //only once, a crash inside the handler goes straight to the OS
+    pfn_crash_handler handler = crash_handler;
+    crash_handler = 0;
+    if(handler){
+        handler();
+    }
+}
+
+static LONG WINAPI win32_on_unhandled_exception(EXCEPTION_POINTERS* info){
+    win32_run_crash_handler();
+    //let the OS (or a debugger) handle it as it would have
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void win32_on_abort(int signal){
+    win32_run_crash_handler();
+}
+
+void platform_set_crash_handler(pfn_crash_handler handler){
+    //the thread installing the handler, the main one; the others in win32_thread_entry
+    if(handler){
+        ULONG crash_stack_size = CRASH_STACK_SIZE;
+        SetThreadStackGuarantee(&crash_stack_size);
+    }
+    crash_handler = handler;
+    SetUnhandledExceptionFilter(handler ? win32_on_unhandled_exception : 0);
+    signal(SIGABRT, handler ? win32_on_abort : SIG_DFL);
+}
+
+// File mapping
+b8 platform_file_map_writable(const char* path, u64 size, platform_file_mapping* out_mapping){
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file == INVALID_HANDLE_VALUE){
+        PANCAKE_ERROR("platform_file_map_writable - could not open '%s'.", path);
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = (LONGLONG)size;
+    if(!SetFilePointerEx(file, file_size, 0, FILE_BEGIN) || !SetEndOfFile(file)){
+        PANCAKE_ERROR("platform_file_map_writable - could not resize '%s' to %llu bytes.", path, size);
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), 0);
+    void* memory = mapping ? MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size) : 0;
+    if(!memory){
+        PANCAKE_ERROR("platform_file_map_writable - could not map '%s'.", path);
+        if(mapping){
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = size;
+    out_mapping->internal[0] = file;
+    out_mapping->internal[1] = mapping;
+    return true;
+}
+
+b8 platform_file_map_read(const char* path, b8 sequential, platform_file_mapping* out_mapping){
+    platform_zero_memory(out_mapping, sizeof(platform_file_mapping));
+    DWORD flags = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | flags, 0);
+    if(file == INVALID_HANDLE_VALUE){
+        PANCAKE_ERROR("platform_file_map_read - could not open '%s'.", path);
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)){
+        PANCAKE_ERROR("platform_file_map_read - could not get the size of '%s'.", path);
+        CloseHandle(file);
+        return false;
+    }
+    if(size.QuadPart == 0){
+        // Nothing to map, an empty view.
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    void* memory = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+    if(!memory){
+        PANCAKE_ERROR("platform_file_map_read - could not map '%s'.", path);
+        if(mapping){
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    if(sequential){
+        WIN32_MEMORY_RANGE_ENTRY range = {memory, (SIZE_T)size.QuadPart};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+    out_mapping->memory = memory;
+    out_mapping->size = (u64)size.QuadPart;
+    out_mapping->internal[0] = file;
+    out_mapping->internal[1] = mapping;
+    return true;
+}
+
+void platform_file_unmap(platform_file_mapping* mapping){
+    if(mapping && mapping->memory){
+        UnmapViewOfFile(mapping->memory);
+        CloseHandle(mapping->internal[1]);
+        CloseHandle(mapping->internal[0]);
+        platform_zero_memory(mapping, sizeof(platform_file_mapping));
+    }
+}
+
 void platform_get_required_extensions(const char ***names_list){
     list_push(*names_list, &"VK_KHR_win32_surface");
 }
@@ -279,7 +489,7 @@ LRESULT CALLBACK win32_process_message(HWND hwnd,u32 msg,WPARAM w_param,LPARAM l
                 key = is_extended ? KEY_RCONTROL : KEY_LCONTROL;
             }
             //pass to the inputs subsystem for processing.
-            input_process_key(key, pressed);
+            input_process_key(key, pressed, platform_get_absolute_time());
             // Return 0 to prevent default window behaviour for some keypresses, such as alt.
             return 0;
         }
@@ -288,14 +498,14 @@ LRESULT CALLBACK win32_process_message(HWND hwnd,u32 msg,WPARAM w_param,LPARAM l
             i32 x_position = GET_X_LPARAM(l_param);
             i32 y_position = GET_Y_LPARAM(l_param);
             //pass to the inputs subsystem for processing.
-            input_process_mouse_move(x_position, y_position);
+            input_process_mouse_move(x_position, y_position, platform_get_absolute_time());
         }break;
         case WM_MOUSEWHEEL:{
             i32 z_delta = GET_WHEEL_DELTA_WPARAM(w_param);
             if(z_delta != 0){
                 //flatten the input to an OS independent (-1, 1)
                 z_delta =(z_delta < 0) ? -1 : 1; 
-                input_process_mouse_wheel(z_delta);
+                input_process_mouse_wheel(z_delta, platform_get_absolute_time());
             }
         }break;
         case WM_LBUTTONDOWN:
@@ -303,21 +513,21 @@ LRESULT CALLBACK win32_process_message(HWND hwnd,u32 msg,WPARAM w_param,LPARAM l
             b8 pressed = (msg == WM_LBUTTONDOWN);
             m_buttons mouse_btn = BUTTON_LEFT;
             //pass to the inputs subsystem for processing.
-            input_process_mouse_button(mouse_btn, pressed);
+            input_process_mouse_button(mouse_btn, pressed, platform_get_absolute_time());
         }break;
         case WM_MBUTTONDOWN:
         case WM_MBUTTONUP:{
             b8 pressed = (msg == WM_MBUTTONDOWN);
             m_buttons mouse_btn = BUTTON_MIDDLE; 
             //pass to the inputs subsystem for processing.
-            input_process_mouse_button(mouse_btn, pressed);
+            input_process_mouse_button(mouse_btn, pressed, platform_get_absolute_time());
         }break;
         case WM_RBUTTONDOWN:
         case WM_RBUTTONUP:{
             b8 pressed = (msg == WM_RBUTTONDOWN);
             m_buttons mouse_btn = BUTTON_RIGHT; 
             //pass to the inputs subsystem for processing.
-            input_process_mouse_button(mouse_btn, pressed);
+            input_process_mouse_button(mouse_btn, pressed, platform_get_absolute_time());
         }break;
     }
     return DefWindowProcA(hwnd,msg,w_param,l_param);
@@ -93,7 +93,7 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
     PANCAKE_DEBUG("Required extensions:");
     u32 length = list_length(required_extensions);
     for (u32 i = 0; i < length; ++i) {
-        PANCAKE_DEBUG(required_extensions[i]);
+        PANCAKE_DEBUG("%s", required_extensions[i]);
     }
 #endif
 
@@ -556,16 +556,16 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
     switch (message_severity) {
         default:
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
-            PANCAKE_ERROR(callback_data->pMessage);
+            PANCAKE_ERROR("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
-            PANCAKE_WARN(callback_data->pMessage);
+            PANCAKE_WARN("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
-            PANCAKE_INFO(callback_data->pMessage);
+            PANCAKE_INFO("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
-            PANCAKE_TRACE(callback_data->pMessage);
+            PANCAKE_TRACE("%s", callback_data->pMessage);
             break;
     }
     return VK_FALSE;
@@ -20,25 +20,14 @@ b8 create_shader_module(
     pancake_zero_memory(&shader_stages[stage_index].create_info, sizeof(VkShaderModuleCreateInfo));
     shader_stages[stage_index].create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
-    // Obtain file handle.
-    file_handle handle;
-    if (!filesystem_open(file_name, FILE_MODE_READ, true, &handle)) {
+    // From a pack or the loose file, Vulkan reads the code straight from the mapping.
+    file_view view;
+    if (!filesystem_load(file_name, FILE_MAP_HINT_SEQUENTIAL, &view)) {
         PANCAKE_ERROR("Unable to read shader module: %s.", file_name);
         return false;
     }
-
-    // Read the entire file as binary.
-    u64 size = 0;
-    u8* file_buffer = 0;
-    if (!filesystem_read_all_bytes(&handle, &file_buffer, &size)) {
-        PANCAKE_ERROR("Unable to binary read shader module: %s.", file_name);
-        return false;
-    }
-    shader_stages[stage_index].create_info.codeSize = size;
-    shader_stages[stage_index].create_info.pCode = (u32*)file_buffer;
-
-    // Close the file.
-    filesystem_close(&handle);
+    shader_stages[stage_index].create_info.codeSize = view.size;
+    shader_stages[stage_index].create_info.pCode = (const u32*)view.data;
 
     VK_CHECK(vkCreateShaderModule(
         context->device.logical_device,
@@ -53,10 +42,9 @@ b8 create_shader_module(
     shader_stages[stage_index].shader_stage_create_info.module = shader_stages[stage_index].handle;
     shader_stages[stage_index].shader_stage_create_info.pName = "main";
 
-    if (file_buffer) {
-        pancake_free(file_buffer, sizeof(u8) * size, MEMORY_TAG_STRING);
-        file_buffer = 0;
-    }
+    // The module holds its own copy of the code.
+    filesystem_unmap(&view);
+    shader_stages[stage_index].create_info.pCode = 0;
 
     return true;
 }
\ No newline at end of file
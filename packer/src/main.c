@@ -0,0 +1,66 @@
+#include <defines.h>
+#include <core/logger.h>
+#include <core/pancake_string.h>
+#include <containers/list.h>
+#include <platform/filesystem.h>
+#include <platform/pack_file.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Builds a pack (see pack_file.h) out of every file under a directory. Files are added under
+    the path the engine loads them by, see pack_builder_add_directory: packing "assets", the file
+    "assets/shaders/Builtin.ObjectShader.vert.spv" is loaded as "assets/shaders/Builtin.ObjectShader.vert.spv".
+
+    usage: packer <directory> <pack> [--compress] [--alignment <bytes>] [--prefix <path>]
+*/
+
+static int packer_usage(){
+    printf("usage: packer <directory> <pack> [--compress] [--alignment <bytes>] [--prefix <path>]\n");
+    printf("  --compress   compress the files with lz, those that don't get smaller are stored as is\n");
+    printf("  --alignment  entries start at multiples of it, a power of 2 of at least %d (default %d)\n", PACK_MIN_ALIGNMENT, PACK_DEFAULT_ALIGNMENT);
+    printf("  --prefix     put before the paths in the pack (default the directory's name, \"\" for none)\n");
+    return 1;
+}
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        return packer_usage();
+    }
+    const char* directory = argv[1];
+    const char* pack_path = argv[2];
+    const char* prefix = 0;
+    b8 compress = false;
+    u32 alignment = 0;
+    for(int i = 3; i < argc; ++i){
+        if(strings_equal(argv[i], "--compress")){
+            compress = true;
+        }else if(strings_equal(argv[i], "--alignment") && i + 1 < argc){
+            alignment = (u32)strtoul(argv[++i], 0, 10);
+            if(alignment == 0){
+                return packer_usage();
+            }
+        }else if(strings_equal(argv[i], "--prefix") && i + 1 < argc){
+            prefix = argv[++i];
+        }else{
+            return packer_usage();
+        }
+    }
+
+    pack_builder builder;
+    if(!pack_builder_begin(pack_path, alignment, &builder)){
+        PANCAKE_ERROR("packer - could not create '%s'.", pack_path);
+        return 1;
+    }
+    b8 added = pack_builder_add_directory(&builder, directory, prefix, compress);
+    u64 file_count = list_length(builder.entries);
+
+    if(!pack_builder_end(&builder) || !added){
+        // Never leave a pack missing files behind.
+        filesystem_delete(pack_path);
+        return 1;
+    }
+    PANCAKE_INFO("packer - %llu files packed into '%s'.", file_count, pack_path);
+    return 0;
+}
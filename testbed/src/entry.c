@@ -10,6 +10,12 @@ b8 create_game(game* out_game){
     out_game->config.start_width = 600;
     out_game->config.start_height = 500;
     out_game->config.name = "Pancake Engine Testbed";
+    out_game->config.input_record_path = 0;
+    out_game->config.input_replay_path = 0;
+    out_game->config.input_thread = false;
+    out_game->config.asset_pack_path = 0;
+    out_game->config.derived_cache_directory = 0;
+    out_game->config.derived_cache_size_limit = 0;
     out_game->Initialize = game_initialize;
     out_game->Update = game_update;
     out_game->Redner = game_render;
@@ -0,0 +1,57 @@
+#include "ring_queue_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <containers/ring_queue.h>
+
+u8 ring_queue_should_round_capacity_and_fill() {
+    ring_queue queue;
+    expect_to_be_true(ring_queue_create(sizeof(u32), 5, &queue));
+    expect_should_be(8, queue.capacity);
+
+    for (u32 i = 0; i < 8; ++i) {
+        expect_to_be_true(ring_queue_push(&queue, &i));
+    }
+    u32 extra = 100;
+    expect_to_be_false(ring_queue_push(&queue, &extra));
+    expect_should_be(8, ring_queue_length(&queue));
+
+    ring_queue_destroy(&queue);
+    expect_should_be(0, queue.cells);
+    return true;
+}
+
+u8 ring_queue_should_stay_fifo_across_wraps() {
+    ring_queue queue;
+    ring_queue_create(sizeof(u64), 4, &queue);
+
+    // Interleave pushes and pops so positions wrap several times.
+    u64 next_push = 0;
+    u64 next_pop = 0;
+    for (u32 round = 0; round < 10; ++round) {
+        for (u32 i = 0; i < 3; ++i) {
+            expect_to_be_true(ring_queue_push(&queue, &next_push));
+            next_push++;
+        }
+        for (u32 i = 0; i < 3; ++i) {
+            u64 value = 0;
+            expect_to_be_true(ring_queue_pop(&queue, &value));
+            expect_should_be(next_pop, value);
+            next_pop++;
+        }
+    }
+
+    u64 value = 0;
+    expect_to_be_false(ring_queue_pop(&queue, &value));
+    expect_should_be(0, ring_queue_length(&queue));
+
+    ring_queue_destroy(&queue);
+    return true;
+}
+
+void ring_queue_register_tests() {
+    test_manager_register_test(ring_queue_should_round_capacity_and_fill, "Ring queue should round its capacity and refuse pushes when full");
+    test_manager_register_test(ring_queue_should_stay_fifo_across_wraps, "Ring queue should stay FIFO across wraps");
+}
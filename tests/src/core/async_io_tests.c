@@ -0,0 +1,90 @@
+#include "async_io_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/async_io.h>
+#include <core/pancake_memory.h>
+#include <platform/filesystem.h>
+#include <platform/pancake_thread.h>
+
+#define ASYNC_IO_TEST_PATH "async_io_test.bin"
+
+static u32 async_io_test_completed;
+static async_io_completion async_io_test_last;
+
+static void async_io_test_on_complete(const async_io_completion* completion) {
+    async_io_test_completed++;
+    async_io_test_last = *completion;
+}
+
+static void async_io_test_wait() {
+    while (async_io_pending_count()) {
+        if (async_io_update() == 0) {
+            pancake_thread_yield();
+        }
+    }
+}
+
+u8 async_io_should_read_back_what_it_wrote() {
+    u64 memory_requirement = 0;
+    initialize_async_io_system(&memory_requirement, 0);
+    void* state = pancake_allocate(memory_requirement, MEMORY_TAG_AAPLICATION);
+    expect_to_be_true(initialize_async_io_system(&memory_requirement, state));
+    async_io_test_completed = 0;
+
+    u8 data[4096];
+    for (u32 i = 0; i < sizeof(data); ++i) {
+        data[i] = (u8)(i * 31);
+    }
+    // two halves, the second one at an offset, in any order
+    async_io_request request = {0};
+    request.operation = ASYNC_IO_WRITE;
+    request.path = ASYNC_IO_TEST_PATH;
+    request.offset = 0;
+    request.size = 2048;
+    request.buffer = data;
+    request.on_complete = async_io_test_on_complete;
+    expect_to_be_true((async_io_submit(&request) != 0));
+    async_io_test_wait();
+    request.offset = 2048;
+    request.buffer = data + 2048;
+    expect_to_be_true((async_io_submit(&request) != 0));
+    async_io_test_wait();
+    expect_should_be(2, async_io_test_completed);
+
+    u8 read_back[100];
+    request.operation = ASYNC_IO_READ;
+    request.offset = 3000;
+    request.size = sizeof(read_back);
+    request.buffer = read_back;
+    request.user_data = read_back;
+    u64 id = async_io_submit(&request);
+    async_io_test_wait();
+    expect_should_be(id, async_io_test_last.id);
+    expect_to_be_true(async_io_test_last.success);
+    expect_should_be(sizeof(read_back), async_io_test_last.bytes);
+    expect_should_be(read_back, async_io_test_last.user_data);
+    b8 same = true;
+    for (u32 i = 0; i < sizeof(read_back); ++i) {
+        same = same && read_back[i] == data[3000 + i];
+    }
+    expect_to_be_true(same);
+
+    // past the end of the file: what is there is read
+    request.offset = 4000;
+    async_io_submit(&request);
+    async_io_test_wait();
+    expect_to_be_false(async_io_test_last.success);
+    expect_should_be(96, async_io_test_last.bytes);
+
+    shutdown_async_io_system(state);
+    pancake_free(state, memory_requirement, MEMORY_TAG_AAPLICATION);
+    filesystem_delete(ASYNC_IO_TEST_PATH);
+    return true;
+}
+
+void async_io_register_tests() {
+    test_manager_register_test(async_io_should_read_back_what_it_wrote, "Async I/O should read back what it wrote");
+}
@@ -0,0 +1,193 @@
+#include "derived_cache_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/derived_cache.h>
+#include <core/pancake_memory.h>
+#include <core/pancake_string.h>
+#include <platform/filesystem.h>
+
+#define DERIVED_CACHE_TEST_DIRECTORY "derived_cache_test"
+#define DERIVED_CACHE_TEST_ENTRY_SIZE 8192
+
+static void* derived_cache_test_state;
+
+static b8 derived_cache_test_start(u64 size_limit) {
+    u64 memory_requirement = 0;
+    initialize_derived_cache(&memory_requirement, 0, 0, 0);
+    derived_cache_test_state = pancake_allocate(memory_requirement, MEMORY_TAG_AAPLICATION);
+    return initialize_derived_cache(&memory_requirement, derived_cache_test_state, DERIVED_CACHE_TEST_DIRECTORY, size_limit);
+}
+
+static void derived_cache_test_stop() {
+    u64 memory_requirement = 0;
+    initialize_derived_cache(&memory_requirement, 0, 0, 0);
+    shutdown_derived_cache(derived_cache_test_state);
+    pancake_free(derived_cache_test_state, memory_requirement, MEMORY_TAG_AAPLICATION);
+}
+
+static void derived_cache_test_delete_file(const char* name, b8 is_directory, void* user_data) {
+    if (is_directory) {
+        return;
+    }
+    char path[256];
+    string_format(path, "%s/%s", DERIVED_CACHE_TEST_DIRECTORY, name);
+    filesystem_delete(path);
+}
+
+// Starts from an empty directory, entries left by other tests would be taken in.
+static void derived_cache_test_clear() {
+    filesystem_create_directory(DERIVED_CACHE_TEST_DIRECTORY);
+    filesystem_list_directory(DERIVED_CACHE_TEST_DIRECTORY, derived_cache_test_delete_file, 0);
+}
+
+// Cooked data, compressible or not.
+static void derived_cache_test_cook(u8* data, u32 seed, b8 compressible) {
+    u32 value = seed * 2654435761u + 1;
+    for (u32 i = 0; i < DERIVED_CACHE_TEST_ENTRY_SIZE; ++i) {
+        value = value * 1664525u + 1013904223u;
+        data[i] = compressible ? (u8)(seed + i / 64) : (u8)(value >> 24);
+    }
+}
+
+static b8 derived_cache_test_matches(derived_cache_key key, const u8* data) {
+    file_view view;
+    if (!derived_cache_get(key, &view)) {
+        return false;
+    }
+    b8 result = view.size == DERIVED_CACHE_TEST_ENTRY_SIZE;
+    for (u32 i = 0; i < DERIVED_CACHE_TEST_ENTRY_SIZE && result; ++i) {
+        result = view.data[i] == data[i];
+    }
+    filesystem_unmap(&view);
+    return result;
+}
+
+u8 derived_cache_hash_should_match_xxhash64() {
+    expect_should_be(0xEF46DB3751D8E999ull, derived_cache_hash("", 0, 0));
+    expect_should_be(0x44BC2CF5AD770999ull, derived_cache_hash("abc", 3, 0));
+    // long enough for the 32 byte rounds
+    const char* text = "Nobody inspects the spammish repetition";
+    expect_should_be(0xFBCEA83C8A378BF1ull, derived_cache_hash(text, string_length(text), 0));
+
+    // the settings are part of the key
+    expect_to_be_true((derived_cache_make_key("source", 6, "-O2", 3) != derived_cache_make_key("source", 6, "-O3", 3)));
+    expect_to_be_true((derived_cache_make_key("source", 6, "-O2", 3) != derived_cache_make_key("sourcf", 6, "-O2", 3)));
+    return true;
+}
+
+u8 derived_cache_should_keep_entries_across_runs() {
+    derived_cache_test_clear();
+
+    u8* data = pancake_allocate(DERIVED_CACHE_TEST_ENTRY_SIZE * 2, MEMORY_TAG_STRING);
+    u8* other = data + DERIVED_CACHE_TEST_ENTRY_SIZE;
+    derived_cache_test_cook(data, 1, true);
+    derived_cache_test_cook(other, 2, false);
+    derived_cache_key key = derived_cache_make_key("mesh source", 11, "optimize", 8);
+    derived_cache_key other_key = derived_cache_make_key("texture source", 14, "bc7", 3);
+
+    expect_to_be_true(derived_cache_test_start(0));
+    file_view view;
+    expect_to_be_false(derived_cache_get(key, &view));
+    expect_to_be_true(derived_cache_put(key, data, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    expect_to_be_true(derived_cache_put(other_key, other, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    expect_to_be_true(derived_cache_test_matches(key, data));
+    expect_to_be_true(derived_cache_test_matches(other_key, other));
+    // the compressible entry takes less than its size on disk
+    expect_to_be_true((derived_cache_size() < DERIVED_CACHE_TEST_ENTRY_SIZE * 2));
+    derived_cache_test_stop();
+
+    // found again after a restart, from the index
+    expect_to_be_true(derived_cache_test_start(0));
+    expect_to_be_true(derived_cache_test_matches(key, data));
+    expect_to_be_true(derived_cache_test_matches(other_key, other));
+    derived_cache_test_stop();
+
+    pancake_free(data, DERIVED_CACHE_TEST_ENTRY_SIZE * 2, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 derived_cache_should_evict_the_least_recently_used() {
+    derived_cache_test_clear();
+
+    // room for 3 incompressible entries
+    u8* data = pancake_allocate(DERIVED_CACHE_TEST_ENTRY_SIZE * 4, MEMORY_TAG_STRING);
+    expect_to_be_true(derived_cache_test_start(DERIVED_CACHE_TEST_ENTRY_SIZE * 3 + sizeof(derived_cache_file_header) * 3));
+    for (u32 i = 0; i < 3; ++i) {
+        derived_cache_test_cook(data + i * DERIVED_CACHE_TEST_ENTRY_SIZE, 10 + i, false);
+        expect_to_be_true(derived_cache_put(100 + i, data + i * DERIVED_CACHE_TEST_ENTRY_SIZE, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    }
+    // 100 is used again, 101 is now the least recently used
+    expect_to_be_true(derived_cache_test_matches(100, data));
+
+    derived_cache_test_cook(data + 3 * DERIVED_CACHE_TEST_ENTRY_SIZE, 13, false);
+    expect_to_be_true(derived_cache_put(103, data + 3 * DERIVED_CACHE_TEST_ENTRY_SIZE, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    file_view view;
+    expect_to_be_false(derived_cache_get(101, &view));
+    expect_to_be_true(derived_cache_test_matches(100, data));
+    expect_to_be_true(derived_cache_test_matches(102, data + 2 * DERIVED_CACHE_TEST_ENTRY_SIZE));
+    expect_to_be_true(derived_cache_test_matches(103, data + 3 * DERIVED_CACHE_TEST_ENTRY_SIZE));
+    expect_to_be_true((derived_cache_size() <= DERIVED_CACHE_TEST_ENTRY_SIZE * 3 + sizeof(derived_cache_file_header) * 3));
+
+    // larger than the whole cache: refused
+    expect_to_be_false(derived_cache_put(104, data, DERIVED_CACHE_TEST_ENTRY_SIZE * 4));
+    derived_cache_test_stop();
+
+    pancake_free(data, DERIVED_CACHE_TEST_ENTRY_SIZE * 4, MEMORY_TAG_STRING);
+    return true;
+}
+
+static void derived_cache_test_write_file(const char* path, const char* text) {
+    file_handle file;
+    u64 written = 0;
+    filesystem_open(path, FILE_MODE_WRITE, true, &file);
+    filesystem_write(&file, string_length(text), text, &written);
+    filesystem_close(&file);
+}
+
+u8 derived_cache_should_match_its_index_with_the_directory() {
+    derived_cache_test_clear();
+
+    u8* data = pancake_allocate(DERIVED_CACHE_TEST_ENTRY_SIZE * 3, MEMORY_TAG_STRING);
+    expect_to_be_true(derived_cache_test_start(0));
+    for (u32 i = 0; i < 3; ++i) {
+        derived_cache_test_cook(data + i * DERIVED_CACHE_TEST_ENTRY_SIZE, 20 + i, false);
+    }
+    expect_to_be_true(derived_cache_put(200, data, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    expect_to_be_true(derived_cache_put(202, data + 2 * DERIVED_CACHE_TEST_ENTRY_SIZE, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    u64 size = derived_cache_size();
+    expect_to_be_true(derived_cache_put(201, data + DERIVED_CACHE_TEST_ENTRY_SIZE, DERIVED_CACHE_TEST_ENTRY_SIZE));
+    derived_cache_test_stop();
+
+    // an indexed entry lost, a put that never finished, a file that isn't an entry
+    filesystem_delete(DERIVED_CACHE_TEST_DIRECTORY "/00000000000000c9.ddc");
+    derived_cache_test_write_file(DERIVED_CACHE_TEST_DIRECTORY "/00000000000000cb.tmp", "half");
+    derived_cache_test_write_file(DERIVED_CACHE_TEST_DIRECTORY "/00000000000000cc.ddc", "not an entry");
+    expect_to_be_true(derived_cache_test_start(0));
+    expect_should_be(size, derived_cache_size());
+    expect_to_be_false(filesystem_exists(DERIVED_CACHE_TEST_DIRECTORY "/00000000000000cb.tmp"));
+    expect_to_be_false(filesystem_exists(DERIVED_CACHE_TEST_DIRECTORY "/00000000000000cc.ddc"));
+    file_view view;
+    expect_to_be_false(derived_cache_get(201, &view));
+    derived_cache_test_stop();
+
+    // a broken index: the entries are taken in again from the directory
+    derived_cache_test_write_file(DERIVED_CACHE_TEST_DIRECTORY "/index.ddc", "garbage");
+    expect_to_be_true(derived_cache_test_start(0));
+    expect_should_be(size, derived_cache_size());
+    expect_to_be_true(derived_cache_test_matches(200, data));
+    expect_to_be_true(derived_cache_test_matches(202, data + 2 * DERIVED_CACHE_TEST_ENTRY_SIZE));
+    derived_cache_test_stop();
+
+    pancake_free(data, DERIVED_CACHE_TEST_ENTRY_SIZE * 3, MEMORY_TAG_STRING);
+    return true;
+}
+
+void derived_cache_register_tests() {
+    test_manager_register_test(derived_cache_hash_should_match_xxhash64, "Derived cache hash should match xxHash64");
+    test_manager_register_test(derived_cache_should_keep_entries_across_runs, "Derived cache should keep entries across runs");
+    test_manager_register_test(derived_cache_should_evict_the_least_recently_used, "Derived cache should evict the least recently used");
+    test_manager_register_test(derived_cache_should_match_its_index_with_the_directory, "Derived cache should match its index with the directory");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void derived_cache_register_tests();
@@ -0,0 +1,320 @@
+#include "event_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/event.h>
+#include <core/pancake_memory.h>
+#include <core/clock.h>
+#include <core/pancake_string.h>
+#include <platform/pancake_thread.h>
+
+#define TEST_EVENT_CODE_A 300
+#define TEST_EVENT_CODE_B 301
+
+typedef struct event_test_log {
+    u16 codes[16];
+    u16 values[16];
+    u32 count;
+} event_test_log;
+
+static u64 event_test_memory_requirement;
+static void* event_test_state;
+
+static void event_test_start() {
+    initialize_evnets_system(&event_test_memory_requirement, 0);
+    event_test_state = pancake_allocate(event_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_evnets_system(&event_test_memory_requirement, event_test_state);
+}
+
+static void event_test_end() {
+    shutdown_events_system(event_test_state);
+    pancake_free(event_test_state, event_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+    event_test_state = 0;
+}
+
+static b8 event_test_record(u16 code, void* sender, void* listener_inst, event_context context) {
+    event_test_log* log = listener_inst;
+    log->codes[log->count] = code;
+    log->values[log->count] = context.data.u16[0];
+    log->count++;
+    return false;
+}
+
+static b8 event_test_post_back(u16 code, void* sender, void* listener_inst, event_context context) {
+    // Posting from a handler must not be dispatched in the same batch.
+    event_post(TEST_EVENT_CODE_B, 0, context);
+    return false;
+}
+
+u8 event_dispatch_pending_should_group_by_code() {
+    event_test_start();
+    event_test_log log = {0};
+    register_event(TEST_EVENT_CODE_A, &log, event_test_record);
+    register_event(TEST_EVENT_CODE_B, &log, event_test_record);
+
+    event_context context = {0};
+    u16 posted_codes[4] = {TEST_EVENT_CODE_B, TEST_EVENT_CODE_A, TEST_EVENT_CODE_B, TEST_EVENT_CODE_A};
+    for (u16 i = 0; i < 4; ++i) {
+        context.data.u16[0] = i;
+        event_post(posted_codes[i], 0, context);
+    }
+
+    // Nothing is dispatched until asked to.
+    expect_should_be(0, log.count);
+    expect_should_be(4, event_dispatch_pending());
+    expect_should_be(4, log.count);
+
+    // Codes come out grouped, each group in posting order.
+    expect_should_be(TEST_EVENT_CODE_A, log.codes[0]);
+    expect_should_be(1, log.values[0]);
+    expect_should_be(3, log.values[1]);
+    expect_should_be(TEST_EVENT_CODE_B, log.codes[2]);
+    expect_should_be(0, log.values[2]);
+    expect_should_be(2, log.values[3]);
+
+    expect_should_be(0, event_dispatch_pending());
+
+    event_test_end();
+    return true;
+}
+
+u8 event_post_from_handler_should_wait_for_next_dispatch() {
+    event_test_start();
+    event_test_log log = {0};
+    register_event(TEST_EVENT_CODE_A, 0, event_test_post_back);
+    register_event(TEST_EVENT_CODE_B, &log, event_test_record);
+
+    event_context context = {0};
+    event_post(TEST_EVENT_CODE_A, 0, context);
+
+    expect_should_be(1, event_dispatch_pending());
+    expect_should_be(0, log.count);
+    expect_should_be(1, event_dispatch_pending());
+    expect_should_be(1, log.count);
+
+    event_test_end();
+    return true;
+}
+
+typedef struct event_test_payload_log {
+    char text[64];
+    u64 size;
+    u32 count;
+} event_test_payload_log;
+
+static b8 event_test_record_payload(u16 code, void* sender, void* listener_inst, event_context context) {
+    event_test_payload_log* log = listener_inst;
+    pancake_copy_memory(log->text, context.data.payload.data, context.data.payload.size);
+    log->size = context.data.payload.size;
+    log->count++;
+    return false;
+}
+
+u8 event_post_payload_should_copy_data_until_dispatched() {
+    event_test_start();
+    event_test_payload_log log = {0};
+    register_event(TEST_EVENT_CODE_A, &log, event_test_record_payload);
+
+    char text[] = "dropped file: some/long/path.png";
+    expect_to_be_true(event_post_payload(TEST_EVENT_CODE_A, 0, text, sizeof(text)));
+    // the event holds its own copy
+    text[0] = 'X';
+
+    expect_should_be(1, event_dispatch_pending());
+    expect_should_be(1, log.count);
+    expect_should_be(sizeof(text), log.size);
+    expect_to_be_true(strings_equal("dropped file: some/long/path.png", log.text));
+
+    // the arena is reset once its events are dispatched, way more than one arena's worth goes through
+    for (u32 i = 0; i < 4096; ++i) {
+        void* payload = event_payload_allocate(1024);
+        expect_should_not_be(0, payload);
+        event_context context;
+        context.data.payload.data = payload;
+        context.data.payload.size = 1;
+        event_post(TEST_EVENT_CODE_B, 0, context);
+        event_dispatch_pending();
+    }
+
+    event_test_end();
+    return true;
+}
+
+u8 event_payloads_should_be_16_byte_aligned() {
+    event_test_start();
+    u64 sizes[] = {1, 7, 16, 33};
+    for (u32 i = 0; i < 4; ++i) {
+        void* payload = event_payload_allocate(sizes[i]);
+        expect_should_not_be(0, payload);
+        expect_should_be(0, (u64)payload % 16);
+    }
+    expect_should_be(0, event_payload_allocate(0xFFFFFFFFFFFFFFFFull));
+    event_test_end();
+    return true;
+}
+
+static b8 event_test_consume(u16 code, void* sender, void* listener_inst, event_context context) {
+    return true;
+}
+
+u8 event_profiling_should_count_calls_and_short_circuits() {
+    event_test_start();
+    event_test_log log = {0};
+    register_event(TEST_EVENT_CODE_A, &log, event_test_record);
+    register_event(TEST_EVENT_CODE_A, 0, event_test_consume);
+    register_event(TEST_EVENT_CODE_B, &log, event_test_record);
+
+    event_context context = {0};
+    event_profiling_enable(true);
+    fire_event(TEST_EVENT_CODE_A, 0, context);
+    fire_event(TEST_EVENT_CODE_A, 0, context);
+    fire_event(TEST_EVENT_CODE_B, 0, context);
+    event_profiling_frame_end();
+
+    u32 count = 0;
+    const event_handler_stats* stats = event_profiling_get_stats(&count);
+    expect_should_be(3, count);
+    // Registration order: A/record, A/consume, B/record.
+    expect_should_be(2, stats[0].frame_calls);
+    expect_should_be(0, stats[0].frame_handled);
+    expect_should_be(2, stats[1].frame_calls);
+    expect_should_be(2, stats[1].frame_handled);
+    expect_should_be(1, stats[2].frame_calls);
+    expect_should_be(TEST_EVENT_CODE_B, stats[2].code);
+
+    // A frame without events rolls the counts back to zero but keeps the totals.
+    event_profiling_frame_end();
+    stats = event_profiling_get_stats(&count);
+    expect_should_be(0, stats[1].frame_calls);
+    expect_should_be(2, stats[1].total_handled);
+
+    event_profiling_enable(false);
+    fire_event(TEST_EVENT_CODE_A, 0, context);
+    event_profiling_frame_end();
+    stats = event_profiling_get_stats(&count);
+    expect_should_be(2, stats[0].total_calls);
+
+    event_test_end();
+    return true;
+}
+
+static b8 event_test_record_and_consume(u16 code, void* sender, void* listener_inst, event_context context) {
+    event_test_record(code, sender, listener_inst, context);
+    return true;
+}
+
+u8 event_priority_should_order_listeners() {
+    event_test_start();
+    event_test_log low = {0};
+    event_test_log normal = {0};
+    event_test_log high = {0};
+    register_event_priority(TEST_EVENT_CODE_A, &low, event_test_record, -10);
+    register_event(TEST_EVENT_CODE_A, &normal, event_test_record);
+    register_event_priority(TEST_EVENT_CODE_A, &high, event_test_record_and_consume, 100);
+
+    // The high priority consumer was registered last, yet handles the event before anyone else sees it.
+    event_context context = {0};
+    expect_to_be_true(fire_event(TEST_EVENT_CODE_A, 0, context));
+    expect_should_be(1, high.count);
+    expect_should_be(0, normal.count);
+    expect_should_be(0, low.count);
+
+    // Once it is gone, the others follow in priority order.
+    unregister_event(TEST_EVENT_CODE_A, &high, event_test_record_and_consume);
+    register_event_priority(TEST_EVENT_CODE_A, &high, event_test_record, 100);
+    expect_to_be_false(fire_event(TEST_EVENT_CODE_A, 0, context));
+    expect_should_be(2, high.count);
+    expect_should_be(1, normal.count);
+    expect_should_be(1, low.count);
+
+    event_test_end();
+    return true;
+}
+
+#define INBOX_BENCH_PRODUCERS 8
+#define INBOX_BENCH_EVENTS_PER_PRODUCER 100000
+
+typedef struct inbox_bench_state {
+    u32 next_expected[INBOX_BENCH_PRODUCERS];
+    u64 received;
+    u64 out_of_order;
+    u64 producers_started;
+} inbox_bench_state;
+
+static inbox_bench_state inbox_bench;
+
+static u32 inbox_bench_produce(void* params) {
+    u16 producer = (u16)(u64)params;
+    __atomic_add_fetch(&inbox_bench.producers_started, 1, __ATOMIC_RELAXED);
+
+    event_context context = {0};
+    context.data.u32[0] = producer;
+    for (u32 i = 0; i < INBOX_BENCH_EVENTS_PER_PRODUCER; ++i) {
+        context.data.u32[1] = i;
+        // The main thread drains once per "frame", retry while the inbox is full.
+        while (!event_inbox_post(TEST_EVENT_CODE_A, 0, context)) {
+            pancake_thread_yield();
+        }
+    }
+    return 0;
+}
+
+static b8 inbox_bench_receive(u16 code, void* sender, void* listener_inst, event_context context) {
+    u32 producer = context.data.u32[0];
+    if (context.data.u32[1] != inbox_bench.next_expected[producer]) {
+        inbox_bench.out_of_order++;
+    }
+    inbox_bench.next_expected[producer] = context.data.u32[1] + 1;
+    inbox_bench.received++;
+    return true;
+}
+
+u8 event_inbox_should_deliver_from_8_producers() {
+    event_test_start();
+    pancake_zero_memory(&inbox_bench, sizeof(inbox_bench));
+    register_event(TEST_EVENT_CODE_A, 0, inbox_bench_receive);
+
+    pancake_thread producers[INBOX_BENCH_PRODUCERS];
+    for (u64 i = 0; i < INBOX_BENCH_PRODUCERS; ++i) {
+        expect_to_be_true(pancake_thread_create(inbox_bench_produce, (void*)i, &producers[i]));
+    }
+
+    Clock timer;
+    clock_start(&timer);
+    u64 total = (u64)INBOX_BENCH_PRODUCERS * INBOX_BENCH_EVENTS_PER_PRODUCER;
+    u64 dispatches = 0;
+    while (inbox_bench.received < total) {
+        if (event_dispatch_pending()) {
+            dispatches++;
+        } else {
+            pancake_thread_yield();
+        }
+    }
+    clock_update(&timer);
+
+    for (u32 i = 0; i < INBOX_BENCH_PRODUCERS; ++i) {
+        pancake_thread_wait(&producers[i]);
+    }
+
+    PANCAKE_INFO("Event inbox: %llu events from %d producers in %.4f sec (%.2f M events/sec, %llu dispatches).",
+                 total, INBOX_BENCH_PRODUCERS, timer.elapsed, (total / timer.elapsed) / 1000000.0, dispatches);
+
+    expect_should_be(total, inbox_bench.received);
+    // Each producer's events arrive in the order it posted them.
+    expect_should_be(0, inbox_bench.out_of_order);
+
+    event_test_end();
+    return true;
+}
+
+void event_register_tests() {
+    test_manager_register_test(event_dispatch_pending_should_group_by_code, "Pending events should be dispatched grouped by code");
+    test_manager_register_test(event_post_from_handler_should_wait_for_next_dispatch, "Events posted by a handler should wait for the next dispatch");
+    test_manager_register_test(event_post_payload_should_copy_data_until_dispatched, "Event payloads should be copied and live until dispatched");
+    test_manager_register_test(event_payloads_should_be_16_byte_aligned, "Event payloads should be 16 byte aligned");
+    test_manager_register_test(event_priority_should_order_listeners, "Listeners should be called by descending priority");
+    test_manager_register_test(event_profiling_should_count_calls_and_short_circuits, "Event profiling should count calls and handled short-circuits");
+    test_manager_register_test(event_inbox_should_deliver_from_8_producers, "Event inbox should deliver in order from 8 producer threads (benchmark)");
+}
@@ -0,0 +1,106 @@
+#include "input_actions_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/inputs.h>
+#include <core/input_actions.h>
+#include <core/pancake_memory.h>
+
+static u64 inputs_memory_requirement;
+static void* inputs_state;
+static u64 actions_memory_requirement;
+static void* actions_state;
+
+static void input_actions_test_start() {
+    initialize_inputs_system(&inputs_memory_requirement, 0);
+    inputs_state = pancake_allocate(inputs_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_inputs_system(&inputs_memory_requirement, inputs_state);
+
+    initialize_input_actions_system(&actions_memory_requirement, 0);
+    actions_state = pancake_allocate(actions_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_input_actions_system(&actions_memory_requirement, actions_state);
+}
+
+static void input_actions_test_end() {
+    shutdown_input_actions_system(actions_state);
+    pancake_free(actions_state, actions_memory_requirement, MEMORY_TAG_AAPLICATION);
+    shutdown_inputs_system(inputs_state);
+    pancake_free(inputs_state, inputs_memory_requirement, MEMORY_TAG_AAPLICATION);
+}
+
+static void input_actions_test_frame() {
+    inputs_frame_prepare();
+    input_actions_update();
+}
+
+u8 input_actions_should_track_any_binding() {
+    input_actions_test_start();
+
+    input_action jump = input_action_register(STRING_ID("jump"));
+    input_action fire = input_action_register(STRING_ID("fire"));
+    expect_should_not_be(INVALID_INPUT_ACTION, jump);
+    expect_should_be(jump, input_action_register(STRING_ID("jump")));
+    expect_should_be(fire, input_action_find(STRING_ID("fire")));
+    input_action_bind_key(jump, KEY_SPACE);
+    input_action_bind_key(jump, KEY_W);
+    input_action_bind_button(fire, BUTTON_LEFT);
+
+    input_process_key(KEY_SPACE, true, 0);
+    input_process_mouse_button(BUTTON_LEFT, true, 0);
+    input_actions_test_frame();
+    expect_should_be((INPUT_ACTION_DOWN | INPUT_ACTION_PRESSED), input_action_get_state(jump));
+    expect_to_be_true(input_action_is_down(fire));
+    inputs_update(0);
+
+    // a second binding going down does not press the action again
+    input_process_key(KEY_W, true, 0);
+    input_process_key(KEY_SPACE, false, 0);
+    input_actions_test_frame();
+    expect_should_be(INPUT_ACTION_DOWN, input_action_get_state(jump));
+    inputs_update(0);
+
+    input_process_key(KEY_W, false, 0);
+    input_actions_test_frame();
+    expect_should_be(INPUT_ACTION_RELEASED, input_action_get_state(jump));
+
+    u32 count = 0;
+    const u8* states = input_actions_get_states(&count);
+    expect_should_be(2, count);
+    expect_should_be(INPUT_ACTION_DOWN, states[fire]);
+
+    input_actions_test_end();
+    return true;
+}
+
+u8 input_axis_should_combine_negative_and_positive() {
+    input_actions_test_start();
+
+    input_axis move_x = input_axis_register(STRING_ID("move_x"));
+    input_axis_bind_keys(move_x, KEY_A, KEY_D);
+    input_axis_bind_keys(move_x, KEY_LEFT, KEY_RIGHT);
+
+    input_actions_test_frame();
+    expect_to_be_true((input_axis_get_value(move_x) == 0.0f));
+
+    input_process_key(KEY_LEFT, true, 0);
+    input_actions_test_frame();
+    expect_to_be_true((input_axis_get_value(move_x) == -1.0f));
+
+    input_process_key(KEY_D, true, 0);
+    input_actions_test_frame();
+    expect_to_be_true((input_axis_get_value(move_x) == 0.0f));
+
+    input_process_key(KEY_LEFT, false, 0);
+    input_actions_test_frame();
+    expect_to_be_true((input_axis_get_value(move_x) == 1.0f));
+
+    input_actions_test_end();
+    return true;
+}
+
+void input_actions_register_tests() {
+    test_manager_register_test(input_actions_should_track_any_binding, "Input actions should be down while any binding is");
+    test_manager_register_test(input_axis_should_combine_negative_and_positive, "Input axes should combine negative and positive bindings");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void input_actions_register_tests();
@@ -0,0 +1,135 @@
+#include "input_recorder_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/inputs.h>
+#include <core/input_recorder.h>
+#include <core/pancake_memory.h>
+#include <platform/filesystem.h>
+
+#define INPUT_RECORDER_TEST_PATH "input_recorder_test.pkir"
+
+static u64 inputs_memory_requirement;
+static void* inputs_state;
+static u64 recorder_memory_requirement;
+static void* recorder_state;
+
+static void input_recorder_test_start() {
+    initialize_inputs_system(&inputs_memory_requirement, 0);
+    inputs_state = pancake_allocate(inputs_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_inputs_system(&inputs_memory_requirement, inputs_state);
+
+    initialize_input_recorder(&recorder_memory_requirement, 0);
+    recorder_state = pancake_allocate(recorder_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_input_recorder(&recorder_memory_requirement, recorder_state);
+}
+
+static void input_recorder_test_end() {
+    shutdown_input_recorder(recorder_state);
+    pancake_free(recorder_state, recorder_memory_requirement, MEMORY_TAG_AAPLICATION);
+    shutdown_inputs_system(inputs_state);
+    pancake_free(inputs_state, inputs_memory_requirement, MEMORY_TAG_AAPLICATION);
+}
+
+u8 input_recorder_replay_should_reproduce_recorded_frames() {
+    input_recorder_test_start();
+    expect_to_be_true(input_recorder_start_recording(INPUT_RECORDER_TEST_PATH));
+
+    // frame 0
+    input_process_key(KEY_W, true, 0);
+    input_process_mouse_move(10, 20, 0);
+    expect_to_be_true(input_recorder_frame_begin());
+    input_recorder_frame_delta(0.25);
+    // frame 1: nothing happens
+    input_recorder_frame_delta(0.5);
+    // frame 2
+    input_process_key(KEY_W, false, 0);
+    input_process_mouse_button(BUTTON_LEFT, true, 0);
+    input_recorder_frame_delta(0.125);
+    input_recorder_stop();
+    input_recorder_test_end();
+
+    // fresh state, replay
+    input_recorder_test_start();
+    expect_to_be_true(input_recorder_start_replay(INPUT_RECORDER_TEST_PATH));
+    f32 x, y;
+
+    expect_to_be_true(input_recorder_frame_begin());
+    expect_to_be_true(input_key_is_down(KEY_W));
+    input_mouse_get_position(&x, &y);
+    expect_should_be(10, (i32)x);
+    expect_should_be(20, (i32)y);
+    // the recorded delta wins over the live one
+    expect_to_be_true((input_recorder_frame_delta(1.0) == 0.25));
+
+    // live input is ignored while replaying
+    input_process_key(KEY_A, true, 0);
+    expect_to_be_false(input_key_is_down(KEY_A));
+
+    expect_to_be_true(input_recorder_frame_begin());
+    expect_to_be_true((input_recorder_frame_delta(1.0) == 0.5));
+
+    expect_to_be_true(input_recorder_frame_begin());
+    expect_to_be_false(input_key_is_down(KEY_W));
+    expect_to_be_true(input_mouse_button_is_down(BUTTON_LEFT));
+    expect_to_be_true((input_recorder_frame_delta(1.0) == 0.125));
+
+    // out of input
+    expect_to_be_false(input_recorder_frame_begin());
+
+    input_recorder_test_end();
+    return true;
+}
+
+// Writes a recording holding a single record.
+static b8 input_recorder_test_write(const input_record* record) {
+    input_recording_header header = {0};
+    header.magic = INPUT_RECORDING_MAGIC;
+    header.version = INPUT_RECORDING_VERSION;
+    header.record_size = sizeof(input_record);
+    file_handle file;
+    u64 written = 0;
+    if (!filesystem_open(INPUT_RECORDER_TEST_PATH, FILE_MODE_WRITE, true, &file)) {
+        return false;
+    }
+    b8 result = filesystem_write(&file, sizeof(header), &header, &written)
+        && filesystem_write(&file, sizeof(input_record), record, &written);
+    filesystem_close(&file);
+    return result;
+}
+
+u8 input_recorder_replay_should_refuse_invalid_records() {
+    input_recorder_test_start();
+    input_record record = {0};
+
+    record.type = INPUT_RECORD_KEY;
+    record.code = KEYS_MAX_KEYS;
+    expect_to_be_true(input_recorder_test_write(&record));
+    expect_to_be_false(input_recorder_start_replay(INPUT_RECORDER_TEST_PATH));
+
+    record.type = INPUT_RECORD_BUTTON;
+    record.code = 40;
+    expect_to_be_true(input_recorder_test_write(&record));
+    expect_to_be_false(input_recorder_start_replay(INPUT_RECORDER_TEST_PATH));
+
+    record.type = 200;
+    record.code = 0;
+    expect_to_be_true(input_recorder_test_write(&record));
+    expect_to_be_false(input_recorder_start_replay(INPUT_RECORDER_TEST_PATH));
+
+    record.type = INPUT_RECORD_KEY;
+    record.code = KEY_W;
+    expect_to_be_true(input_recorder_test_write(&record));
+    expect_to_be_true(input_recorder_start_replay(INPUT_RECORDER_TEST_PATH));
+
+    input_recorder_test_end();
+    filesystem_delete(INPUT_RECORDER_TEST_PATH);
+    return true;
+}
+
+void input_recorder_register_tests() {
+    test_manager_register_test(input_recorder_replay_should_reproduce_recorded_frames, "Input replay should reproduce the recorded frames");
+    test_manager_register_test(input_recorder_replay_should_refuse_invalid_records, "Input replay should refuse invalid records");
+}
@@ -0,0 +1,110 @@
+#include "inputs_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/inputs.h>
+#include <core/pancake_memory.h>
+
+static u64 inputs_test_memory_requirement;
+static void* inputs_test_state;
+
+static void inputs_test_start() {
+    initialize_inputs_system(&inputs_test_memory_requirement, 0);
+    inputs_test_state = pancake_allocate(inputs_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_inputs_system(&inputs_test_memory_requirement, inputs_test_state);
+}
+
+static void inputs_test_end() {
+    shutdown_inputs_system(inputs_test_state);
+    pancake_free(inputs_test_state, inputs_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+    inputs_test_state = 0;
+}
+
+u8 inputs_key_edges_should_last_one_frame() {
+    inputs_test_start();
+
+    // frame 1: W and F24 (last word of the mask) go down
+    input_process_key(KEY_W, true, 0);
+    input_process_key(KEY_F24, true, 0);
+    inputs_frame_prepare();
+    expect_to_be_true(input_key_is_down(KEY_W));
+    expect_to_be_true(input_key_pressed_this_frame(KEY_W));
+    expect_to_be_true(input_key_pressed_this_frame(KEY_F24));
+    expect_to_be_false(input_key_pressed_this_frame(KEY_A));
+    expect_to_be_false(input_key_released_this_frame(KEY_W));
+    inputs_update(0);
+
+    // frame 2: still held, no edge
+    inputs_frame_prepare();
+    expect_to_be_true(input_key_is_down(KEY_W));
+    expect_to_be_true(input_key_was_down(KEY_W));
+    expect_to_be_false(input_key_pressed_this_frame(KEY_W));
+    inputs_update(0);
+
+    // frame 3: released
+    input_process_key(KEY_W, false, 0);
+    inputs_frame_prepare();
+    expect_to_be_true(input_key_is_up(KEY_W));
+    expect_to_be_true(input_key_released_this_frame(KEY_W));
+    expect_to_be_false(input_key_released_this_frame(KEY_F24));
+    inputs_update(0);
+
+    inputs_test_end();
+    return true;
+}
+
+u8 inputs_key_masks_should_match_any_and_all() {
+    inputs_test_start();
+
+    input_key_mask movement = {0};
+    input_key_mask_add(&movement, KEY_W);
+    input_key_mask_add(&movement, KEY_A);
+    input_key_mask_add(&movement, KEY_S);
+    input_key_mask_add(&movement, KEY_D);
+
+    input_key_mask shortcut = {0};
+    input_key_mask_add(&shortcut, KEY_LCONTROL);
+    input_key_mask_add(&shortcut, KEY_S);
+
+    inputs_frame_prepare();
+    expect_to_be_false(input_keys_any_down(&movement));
+
+    input_process_key(KEY_S, true, 0);
+    inputs_frame_prepare();
+    expect_to_be_true(input_keys_any_down(&movement));
+    expect_to_be_true(input_keys_any_pressed(&movement));
+    expect_to_be_false(input_keys_all_down(&shortcut));
+    inputs_update(0);
+
+    input_process_key(KEY_LCONTROL, true, 0);
+    inputs_frame_prepare();
+    expect_to_be_true(input_keys_all_down(&shortcut));
+    expect_to_be_false(input_keys_any_pressed(&movement));
+    inputs_update(0);
+
+    inputs_test_end();
+    return true;
+}
+
+u8 inputs_mouse_move_time_should_be_the_last_move() {
+    inputs_test_start();
+
+    expect_to_be_true((input_mouse_get_move_time() == 0));
+    input_process_mouse_move(1, 1, 10.0);
+    input_process_mouse_move(2, 2, 10.5);
+    // not published until the frame starts
+    expect_to_be_true((input_mouse_get_move_time() == 0));
+    inputs_frame_prepare();
+    expect_to_be_true((input_mouse_get_move_time() == 10.5));
+
+    inputs_test_end();
+    return true;
+}
+
+void inputs_register_tests() {
+    test_manager_register_test(inputs_key_edges_should_last_one_frame, "Key pressed/released edges should last one frame");
+    test_manager_register_test(inputs_key_masks_should_match_any_and_all, "Key masks should match any/all keys down");
+    test_manager_register_test(inputs_mouse_move_time_should_be_the_last_move, "Mouse move time should be the time of the last move");
+}
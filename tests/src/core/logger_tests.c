@@ -0,0 +1,344 @@
+#include "logger_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/log_ring.h>
+#include <core/string_builder.h>
+#include <core/pancake_memory.h>
+#include <core/pancake_string.h>
+#include <platform/filesystem.h>
+#include <platform/pancake_thread.h>
+
+#define LOGGER_TEST_THREADS 4
+#define LOGGER_TEST_LINES 25
+
+static u64 logger_test_memory_requirement;
+static void* logger_test_state;
+
+static void logger_test_start() {
+    initialize_logging_system(&logger_test_memory_requirement, 0);
+    logger_test_state = pancake_allocate(logger_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_logging_system(&logger_test_memory_requirement, logger_test_state);
+}
+
+static void logger_test_end() {
+    shutdown_logging_system(logger_test_state);
+    pancake_free(logger_test_state, logger_test_memory_requirement, MEMORY_TAG_AAPLICATION);
+}
+
+// Reads console.log, the data must be freed with MEMORY_TAG_STRING.
+static u8* logger_test_read_file(u64* out_size) {
+    file_handle file;
+    *out_size = 0;
+    if (!filesystem_open("console.log", FILE_MODE_READ, true, &file)) {
+        return 0;
+    }
+    u8* data = 0;
+    filesystem_read_all_bytes(&file, &data, out_size);
+    filesystem_close(&file);
+    return data;
+}
+
+// Removes the time stamp ("[seconds] ") each line starts with, in place. Returns the new length.
+static u64 logger_test_strip_times(char* text, u64 length) {
+    u64 out = 0;
+    b8 line_start = true;
+    for (u64 i = 0; i < length; ++i) {
+        if (line_start && text[i] == '[') {
+            while (i < length && text[i] != ']') {
+                i++;
+            }
+            // the bracket and the space after it
+            i += 2;
+            if (i >= length) {
+                break;
+            }
+        }
+        text[out++] = text[i];
+        line_start = text[i] == '\n';
+    }
+    text[out] = 0;
+    return out;
+}
+
+// Counts the lines of console.log.
+static u64 logger_test_count_file_lines() {
+    u64 size = 0;
+    u8* data = logger_test_read_file(&size);
+
+    u64 lines = 0;
+    for (u64 i = 0; i < size; ++i) {
+        lines += data[i] == '\n';
+    }
+    if (data) {
+        pancake_free(data, size, MEMORY_TAG_STRING);
+    }
+    return lines;
+}
+
+static u32 logger_test_produce(void* params) {
+    u64 thread_index = (u64)params;
+    for (u32 i = 0; i < LOGGER_TEST_LINES; ++i) {
+        PANCAKE_TRACE("logger test: thread %llu line %u", thread_index, i);
+    }
+    return 0;
+}
+
+u8 logger_should_write_every_line_from_every_thread() {
+    logger_test_start();
+
+    pancake_thread threads[LOGGER_TEST_THREADS];
+    for (u64 i = 0; i < LOGGER_TEST_THREADS; ++i) {
+        expect_to_be_true(pancake_thread_create(logger_test_produce, (void*)i, &threads[i]));
+    }
+    for (u32 i = 0; i < LOGGER_TEST_THREADS; ++i) {
+        pancake_thread_wait(&threads[i]);
+    }
+
+    // A long line goes through the queue on the heap.
+    char long_line[600];
+    for (u32 i = 0; i < sizeof(long_line) - 1; ++i) {
+        long_line[i] = 'a' + (i % 26);
+    }
+    long_line[sizeof(long_line) - 1] = 0;
+    PANCAKE_TRACE("%s", long_line);
+
+    log_flush();
+    expect_should_be(LOGGER_TEST_THREADS * LOGGER_TEST_LINES + 1, logger_test_count_file_lines());
+
+    logger_test_end();
+    return true;
+}
+
+u8 logger_deferred_lines_should_format_like_printf() {
+    logger_test_start();
+
+    char changing[] = "before";
+    PANCAKE_TRACE("deferred %d %u %5.2f [%s] %c %lld %x [%-4s] %% %*d %p %zu", -3, 7u, 3.14159, changing, 'z', 1234567890123ll, 255, "ab", 5, 42, (void*)0x1234, (u64)9);
+    // the arguments were copied, strings included
+    changing[0] = 'X';
+    log_flush();
+
+    char expected[256];
+    string_format(expected, "[TRACE]: deferred %d %u %5.2f [%s] %c %lld %x [%-4s] %% %*d %p %zu\n", -3, 7u, 3.14159, "before", 'z', 1234567890123ll, 255, "ab", 5, 42, (void*)0x1234, (u64)9);
+
+    u64 size = 0;
+    u8* data = logger_test_read_file(&size);
+    char written[256];
+    expect_to_be_true((size < sizeof(written)));
+    pancake_copy_memory(written, data, size);
+    written[size] = 0;
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    // stamped with the time it was logged
+    expect_should_be('[', written[0]);
+    expect_to_be_true(strings_nequal("] [TRACE]", written + 12, 9));
+    size = logger_test_strip_times(written, size);
+    expect_should_be(string_length(expected), size);
+    expect_to_be_true(strings_equal(expected, written));
+
+    logger_test_end();
+    return true;
+}
+
+u8 logger_deferred_strings_should_read_no_further_than_their_precision() {
+    logger_test_start();
+
+    // a view into a buffer with no terminator, the characters past it are not the logger's to read
+    char* view = pancake_allocate(4, MEMORY_TAG_STRING);
+    pancake_copy_memory(view, "abcd", 4);
+    PANCAKE_TRACE("view [%.*s] [%.2s] [%.*s]", 4, view, view, 3, view + 1);
+    log_flush();
+    pancake_free(view, 4, MEMORY_TAG_STRING);
+
+    u64 size = 0;
+    u8* data = logger_test_read_file(&size);
+    char written[256];
+    expect_to_be_true((size < sizeof(written)));
+    pancake_copy_memory(written, data, size);
+    written[size] = 0;
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    size = logger_test_strip_times(written, size);
+    expect_to_be_true(strings_equal("[TRACE]: view [abcd] [ab] [bcd]\n", written));
+
+    logger_test_end();
+    return true;
+}
+
+u8 logger_file_should_rotate_past_its_size_limit() {
+    logger_test_start();
+
+    log_file_config config = {0};
+    config.flush_bytes = 64 * 1024;
+    config.flush_interval_ms = 100;
+    config.rotate_bytes = 1;
+    config.max_files = 2;
+    log_configure_file(&config);
+
+    // every flush now moves console.log up, the third one drops the oldest file
+    PANCAKE_TRACE("logger test: first file");
+    log_flush();
+    expect_to_be_true(filesystem_exists("console.1.log"));
+    expect_should_be(0, logger_test_count_file_lines());
+
+    PANCAKE_TRACE("logger test: second file");
+    log_flush();
+    PANCAKE_TRACE("logger test: third file");
+    log_flush();
+    expect_to_be_true(filesystem_exists("console.2.log"));
+    expect_to_be_false(filesystem_exists("console.3.log"));
+
+    logger_test_end();
+    filesystem_delete("console.1.log");
+    filesystem_delete("console.2.log");
+    return true;
+}
+
+static u32 logger_test_evaluations;
+
+static u32 logger_test_evaluate() {
+    return ++logger_test_evaluations;
+}
+
+u8 logger_filtered_lines_should_not_evaluate_their_arguments() {
+    logger_test_start();
+    logger_test_evaluations = 0;
+
+    log_set_level(LOG_LEVEL_WARN);
+    PANCAKE_INFO("logger test: filtered %u", logger_test_evaluate());
+    expect_should_be(0, logger_test_evaluations);
+    PANCAKE_WARN("logger test: kept %u", logger_test_evaluate());
+    expect_should_be(1, logger_test_evaluations);
+
+    // a category with its own level ignores the global one until reset
+    log_category category = log_category_register("logger test");
+    expect_should_be(category, log_category_register("logger test"));
+    log_category_set_level(category, LOG_LEVEL_TRACE);
+    log_set_level(LOG_LEVEL_ERROR);
+    PANCAKE_LOG_CATEGORY(category, LOG_LEVEL_TRACE, "logger test: category %u", logger_test_evaluate());
+    expect_should_be(2, logger_test_evaluations);
+    log_category_reset_level(category);
+    PANCAKE_LOG_CATEGORY(category, LOG_LEVEL_TRACE, "logger test: category %u", logger_test_evaluate());
+    expect_should_be(2, logger_test_evaluations);
+
+    log_set_level(LOG_LEVEL_TRACE);
+    log_flush();
+    expect_should_be(2, logger_test_count_file_lines());
+
+    logger_test_end();
+    return true;
+}
+
+u8 logger_should_rate_limit_and_collapse_repeated_lines() {
+    logger_test_start();
+    logger_test_evaluations = 0;
+
+    log_set_rate_limit(5);
+    for (u32 i = 0; i < 20; ++i) {
+        PANCAKE_TRACE("logger test: same line %u", logger_test_evaluate() * 0);
+    }
+    log_set_rate_limit(LOG_RATE_LIMIT_DEFAULT);
+    expect_should_be(5, logger_test_evaluations);
+
+    // the 5 lines let through are identical, only the first one is written
+    log_flush();
+    u64 size = 0;
+    u8* data = logger_test_read_file(&size);
+    char written[256];
+    expect_to_be_true((size < sizeof(written)));
+    pancake_copy_memory(written, data, size);
+    written[size] = 0;
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    logger_test_strip_times(written, size);
+    expect_to_be_true(strings_equal("[TRACE]: logger test: same line 0\n[TRACE]: Last message repeated 4 times.\n", written));
+
+    logger_test_end();
+    return true;
+}
+
+u8 log_ring_should_keep_the_newest_lines() {
+    log_ring ring;
+    expect_to_be_true(log_ring_create("log_ring_test.ring", 64, &ring));
+
+    // 10 lines of 7 bytes, the first one is overwritten
+    char line[16];
+    for (u32 i = 0; i < 10; ++i) {
+        u64 length = string_format(line, "line %u\n", i);
+        log_ring_write(&ring, line, length);
+    }
+    log_ring_destroy(&ring);
+
+    file_handle file;
+    expect_to_be_true(filesystem_open("log_ring_test.ring", FILE_MODE_READ, true, &file));
+    u8* data = 0;
+    u64 size = 0;
+    filesystem_read_all_bytes(&file, &data, &size);
+    filesystem_close(&file);
+
+    string_builder text;
+    string_builder_create(128, 0, &text);
+    expect_to_be_true(log_ring_decode(data, size, &text));
+    expect_to_be_true(strings_equal("line 1\nline 2\nline 3\nline 4\nline 5\nline 6\nline 7\nline 8\nline 9\n", text.data));
+    // not a ring file
+    expect_to_be_false(log_ring_decode(data + 4, size - 4, &text));
+
+    string_builder_destroy(&text);
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    filesystem_delete("log_ring_test.ring");
+    return true;
+}
+
+static u32 log_ring_test_produce(void* params) {
+    log_ring* ring = params;
+    char line[32];
+    for (u32 i = 0; i < LOGGER_TEST_LINES; ++i) {
+        u64 length = string_format(line, "ring line %u\n", i);
+        log_ring_write(ring, line, length);
+    }
+    return 0;
+}
+
+u8 log_ring_should_take_lines_from_every_thread_at_once() {
+    log_ring ring;
+    expect_to_be_true(log_ring_create("log_ring_test.ring", 64 * 1024, &ring));
+
+    pancake_thread threads[LOGGER_TEST_THREADS];
+    for (u32 i = 0; i < LOGGER_TEST_THREADS; ++i) {
+        expect_to_be_true(pancake_thread_create(log_ring_test_produce, &ring, &threads[i]));
+    }
+    for (u32 i = 0; i < LOGGER_TEST_THREADS; ++i) {
+        pancake_thread_wait(&threads[i]);
+    }
+
+    // Decoded straight from the mapping, every line whole.
+    string_builder text;
+    string_builder_create(1024, 0, &text);
+    expect_to_be_true(log_ring_decode(ring.mapping.memory, ring.mapping.size, &text));
+    u64 lines = 0;
+    for (u64 start = 0; start < text.length; ++lines) {
+        expect_to_be_true(strings_nequal(text.data + start, "ring line ", 10));
+        while (text.data[start] != '\n') {
+            start++;
+        }
+        start++;
+    }
+    expect_should_be(LOGGER_TEST_THREADS * LOGGER_TEST_LINES, lines);
+
+    string_builder_destroy(&text);
+    log_ring_destroy(&ring);
+    filesystem_delete("log_ring_test.ring");
+    return true;
+}
+
+void logger_register_tests() {
+    test_manager_register_test(logger_deferred_lines_should_format_like_printf, "Deferred log lines should format like printf");
+    test_manager_register_test(logger_deferred_strings_should_read_no_further_than_their_precision, "Deferred strings should read no further than their precision");
+    test_manager_register_test(logger_should_write_every_line_from_every_thread, "Logger should write every line queued from every thread");
+    test_manager_register_test(logger_file_should_rotate_past_its_size_limit, "Log file should rotate past its size limit");
+    test_manager_register_test(logger_filtered_lines_should_not_evaluate_their_arguments, "Filtered log lines should not evaluate their arguments");
+    test_manager_register_test(logger_should_rate_limit_and_collapse_repeated_lines, "Logger should rate limit and collapse repeated lines");
+    test_manager_register_test(log_ring_should_keep_the_newest_lines, "Log ring should keep the newest lines");
+    test_manager_register_test(log_ring_should_take_lines_from_every_thread_at_once, "Log ring should take lines from every thread at once");
+}
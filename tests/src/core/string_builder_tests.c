@@ -0,0 +1,79 @@
+#include "string_builder_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/string_builder.h>
+#include <core/pancake_string.h>
+#include <memory/linear_allocator.h>
+
+u8 string_builder_should_spill_buffer_to_heap() {
+    char buffer[8];
+    string_builder sb;
+    string_builder_create_from_buffer(buffer, sizeof(buffer), &sb);
+
+    string_builder_append(&sb, "abc");
+    expect_should_be(buffer, sb.data);
+    expect_should_be(3, sb.length);
+
+    // Grows past the buffer, the contents must be carried over.
+    string_builder_append_format(&sb, "-%d-%s", 12345, "tail");
+    expect_should_not_be(buffer, sb.data);
+    expect_to_be_true(sb.owns_memory);
+    expect_should_be(string_length("abc-12345-tail"), sb.length);
+    expect_to_be_true(strings_equal("abc-12345-tail", sb.data));
+
+    string_builder_destroy(&sb);
+    expect_should_be(0, sb.data);
+
+    return true;
+}
+
+u8 string_builder_untracked_should_spill_the_same_way() {
+    char buffer[8];
+    string_builder sb;
+    string_builder_create_from_buffer_untracked(buffer, sizeof(buffer), &sb);
+    string_builder_append(&sb, "abc");
+    string_builder_append_format(&sb, "-%d-%s", 12345, "tail");
+    expect_to_be_true(sb.owns_memory);
+    expect_to_be_true(sb.untracked);
+    expect_to_be_true(strings_equal("abc-12345-tail", sb.data));
+    // grows again from platform memory
+    string_builder_append(&sb, "0123456789012345678901234567890123456789012345678901234567890123456789");
+    expect_should_be(string_length("abc-12345-tail") + 70, sb.length);
+    string_builder_destroy(&sb);
+    expect_should_be(0, sb.data);
+    return true;
+}
+
+u8 string_builder_should_extend_arena_in_place() {
+    linear_allocator arena;
+    linear_allocator_create(1024, 0, &arena);
+
+    string_builder sb;
+    string_builder_create(64, &arena, &sb);
+    char* start = sb.data;
+
+    for (i32 i = 0; i < 40; ++i) {
+        string_builder_append_format(&sb, "%02d,", i);
+    }
+
+    // The builder was the last allocation, so it grew without moving or copying.
+    expect_should_be(start, sb.data);
+    expect_should_be(120, sb.length);
+    expect_should_be(sb.capacity, arena.allocated);
+    expect_should_be(128, sb.capacity);
+    expect_to_be_true((sb.data[0] == '0' && sb.data[118] == '9' && sb.data[120] == 0));
+
+    string_builder_destroy(&sb);
+    linear_allocator_destroy(&arena);
+
+    return true;
+}
+
+void string_builder_register_tests() {
+    test_manager_register_test(string_builder_should_spill_buffer_to_heap, "String builder should spill a full buffer to the heap");
+    test_manager_register_test(string_builder_untracked_should_spill_the_same_way, "Untracked string builder should spill the same way");
+    test_manager_register_test(string_builder_should_extend_arena_in_place, "String builder should extend its arena block in place");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void string_builder_register_tests();
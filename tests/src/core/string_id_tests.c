@@ -0,0 +1,56 @@
+#include "string_id_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/string_id.h>
+#include <core/pancake_memory.h>
+#include <core/pancake_string.h>
+
+u8 string_id_literal_should_match_runtime_hash() {
+    char runtime[32];
+    string_format(runtime, "%s_%s", "VK_LAYER", "validation");
+
+    string_id literal_id = STRING_ID("VK_LAYER_validation");
+    string_id runtime_id = string_hash(runtime);
+
+    expect_should_be(literal_id, runtime_id);
+    expect_should_not_be(INVALID_STRING_ID, literal_id);
+    expect_should_not_be(STRING_ID("VK_LAYER_validatioN"), literal_id);
+
+    return true;
+}
+
+u8 string_id_intern_should_round_trip() {
+    u64 memory_requirement = 0;
+    initialize_string_id_system(&memory_requirement, 0);
+    void* state = pancake_allocate(memory_requirement, MEMORY_TAG_STRING);
+    initialize_string_id_system(&memory_requirement, state);
+
+    char name[16] = "shader.vert";
+    string_id id = string_intern(name);
+    expect_should_be(STRING_ID("shader.vert"), id);
+
+    // The interned copy must survive changes to the original.
+    name[0] = 'S';
+    expect_to_be_true(strings_equal("shader.vert", string_id_to_string(id)));
+
+    // Interning again yields the same id.
+    expect_should_be(id, string_intern("shader.vert"));
+    expect_should_be(0, string_id_to_string(STRING_ID("never interned")));
+
+    shutdown_string_id_system(state);
+    pancake_free(state, memory_requirement, MEMORY_TAG_STRING);
+
+    // Without the system, ids are still produced but cannot be looked up.
+    expect_should_be(id, string_intern("shader.vert"));
+    expect_should_be(0, string_id_to_string(id));
+
+    return true;
+}
+
+void string_id_register_tests() {
+    test_manager_register_test(string_id_literal_should_match_runtime_hash, "String id of a literal should match the runtime hash");
+    test_manager_register_test(string_id_intern_should_round_trip, "Interned string id should round trip to its string");
+}
@@ -1,6 +1,19 @@
 #include "tests_manager.h"
 
 #include "memory/linear_allocator_tests.h"
+#include "core/string_id_tests.h"
+#include "core/string_builder_tests.h"
+#include "core/logger_tests.h"
+#include "core/event_tests.h"
+#include "core/inputs_tests.h"
+#include "core/input_recorder_tests.h"
+#include "core/input_actions_tests.h"
+#include "core/async_io_tests.h"
+#include "core/derived_cache_tests.h"
+#include "containers/ring_queue_tests.h"
+#include "platform/filesystem_tests.h"
+#include "platform/pack_file_tests.h"
+#include "platform/lz_tests.h"
 
 #include <core/logger.h>
 
@@ -10,6 +23,19 @@ int main() {
 
     // TODO: add test registrations here.
     linear_allocator_register_tests();
+    string_id_register_tests();
+    string_builder_register_tests();
+    logger_register_tests();
+    event_register_tests();
+    inputs_register_tests();
+    input_recorder_register_tests();
+    input_actions_register_tests();
+    async_io_register_tests();
+    derived_cache_register_tests();
+    ring_queue_register_tests();
+    filesystem_register_tests();
+    pack_file_register_tests();
+    lz_register_tests();
 
 
     PANCAKE_DEBUG("Starting tests...");
@@ -108,10 +108,36 @@ u8 linear_allocator_multi_allocation_all_space_then_free() {
     return true;
 }
 
+u8 linear_allocator_should_hand_out_zeroed_memory() {
+    // memory from the caller, not zeroed
+    u8 memory[64];
+    for (u32 i = 0; i < sizeof(memory); ++i) {
+        memory[i] = 0xAB;
+    }
+    linear_allocator alloc;
+    linear_allocator_create(sizeof(memory), memory, &alloc);
+    u8* block = linear_allocator_allocate(&alloc, 16);
+    for (u32 i = 0; i < 16; ++i) {
+        expect_should_be(0, block[i]);
+        block[i] = 0xCD;
+    }
+
+    // written to, then zeroed again by free_all
+    linear_allocator_free_all(&alloc);
+    block = linear_allocator_allocate(&alloc, sizeof(memory));
+    for (u32 i = 0; i < sizeof(memory); ++i) {
+        expect_should_be(0, block[i]);
+    }
+
+    linear_allocator_destroy(&alloc);
+    return true;
+}
+
 void linear_allocator_register_tests() {
     test_manager_register_test(linear_allocator_should_create_and_destroy, "Linear allocator should create and destroy");
     test_manager_register_test(linear_allocator_single_allocation_all_space, "Linear allocator single alloc for all space");
     test_manager_register_test(linear_allocator_multi_allocation_all_space, "Linear allocator multi alloc for all space");
     test_manager_register_test(linear_allocator_multi_allocation_over_allocate, "Linear allocator try over allocate");
     test_manager_register_test(linear_allocator_multi_allocation_all_space_then_free, "Linear allocator allocated should be 0 after free_all");
+    test_manager_register_test(linear_allocator_should_hand_out_zeroed_memory, "Linear allocator should hand out zeroed memory");
 } 
\ No newline at end of file
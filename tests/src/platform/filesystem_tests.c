@@ -0,0 +1,125 @@
+#include "filesystem_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <platform/filesystem.h>
+#include <core/pancake_memory.h>
+#include <core/pancake_string.h>
+
+#define FILESYSTEM_TEST_PATH "filesystem_test.bin"
+
+static b8 filesystem_test_write(const char* path, const void* data, u64 size) {
+    file_handle file;
+    if (!filesystem_open(path, FILE_MODE_WRITE, true, &file)) {
+        return false;
+    }
+    u64 written = 0;
+    b8 result = size == 0 || filesystem_write(&file, size, data, &written);
+    filesystem_close(&file);
+    return result;
+}
+
+u8 filesystem_map_should_view_the_whole_file() {
+    u8 data[5000];
+    for (u32 i = 0; i < sizeof(data); ++i) {
+        data[i] = (u8)(i * 7);
+    }
+    expect_to_be_true(filesystem_test_write(FILESYSTEM_TEST_PATH, data, sizeof(data)));
+
+    file_view view;
+    expect_to_be_true(filesystem_map(FILESYSTEM_TEST_PATH, FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_should_be(sizeof(data), view.size);
+    b8 same = true;
+    for (u32 i = 0; i < sizeof(data); ++i) {
+        same = same && view.data[i] == data[i];
+    }
+    expect_to_be_true(same);
+    filesystem_unmap(&view);
+    expect_should_be(0, view.data);
+
+    // an empty file maps to an empty view
+    expect_to_be_true(filesystem_test_write(FILESYSTEM_TEST_PATH, data, 0));
+    expect_to_be_true(filesystem_map(FILESYSTEM_TEST_PATH, FILE_MAP_HINT_RANDOM, &view));
+    expect_should_be(0, view.size);
+    filesystem_unmap(&view);
+
+    expect_to_be_true(filesystem_delete(FILESYSTEM_TEST_PATH));
+    expect_to_be_false(filesystem_map(FILESYSTEM_TEST_PATH, FILE_MAP_HINT_RANDOM, &view));
+    return true;
+}
+
+u8 filesystem_keep_mode_should_create_or_keep_the_file() {
+    file_handle file;
+    u64 written = 0;
+    filesystem_delete(FILESYSTEM_TEST_PATH);
+    // created when missing
+    expect_to_be_true(filesystem_open(FILESYSTEM_TEST_PATH, FILE_MODE_WRITE | FILE_MODE_KEEP, true, &file));
+    expect_to_be_true(filesystem_write(&file, 8, "abcdefgh", &written));
+    filesystem_close(&file);
+
+    // kept when there, written over in place
+    expect_to_be_true(filesystem_open(FILESYSTEM_TEST_PATH, FILE_MODE_WRITE | FILE_MODE_KEEP, true, &file));
+    expect_to_be_true(filesystem_seek(&file, 2));
+    expect_to_be_true(filesystem_write(&file, 2, "XY", &written));
+    filesystem_close(&file);
+
+    file_view view;
+    expect_to_be_true(filesystem_map(FILESYSTEM_TEST_PATH, FILE_MAP_HINT_RANDOM, &view));
+    expect_should_be(8, view.size);
+    expect_to_be_true(strings_nequal("abXYefgh", (const char*)view.data, 8));
+    filesystem_unmap(&view);
+    expect_to_be_true(filesystem_delete(FILESYSTEM_TEST_PATH));
+    return true;
+}
+
+// Reads every line and checks them against expected, joined with '|'.
+static b8 filesystem_test_lines_match(file_line_reader* reader, const char* expected) {
+    const char* line;
+    u64 length;
+    u64 offset = 0;
+    u64 expected_length = string_length(expected);
+    while (filesystem_line_reader_next(reader, &line, &length)) {
+        if (offset > expected_length || !strings_nequal(expected + offset, line, length)) {
+            return false;
+        }
+        offset += length;
+        if (expected[offset] != '|' && expected[offset] != 0) {
+            return false;
+        }
+        offset++;
+    }
+    return offset == expected_length + 1;
+}
+
+u8 filesystem_line_reader_should_split_lines() {
+    // CRLF, LF, an empty line, a line longer than the buffer and no line break at the end
+    const char* text = "first\r\nsecond\n\nthe fourth line is longer than the buffer\r\nlast";
+    const char* expected = "first|second||the fourth line is longer than the buffer|last";
+    expect_to_be_true(filesystem_test_write(FILESYSTEM_TEST_PATH, text, string_length(text)));
+
+    file_handle file;
+    expect_to_be_true(filesystem_open(FILESYSTEM_TEST_PATH, FILE_MODE_READ, true, &file));
+    file_line_reader reader;
+    filesystem_line_reader_create(&file, 16, &reader);
+    expect_to_be_true(filesystem_test_lines_match(&reader, expected));
+    filesystem_line_reader_destroy(&reader);
+    filesystem_close(&file);
+
+    file_view view;
+    expect_to_be_true(filesystem_map(FILESYSTEM_TEST_PATH, FILE_MAP_HINT_SEQUENTIAL, &view));
+    filesystem_line_reader_create_from_view(&view, &reader);
+    expect_to_be_true(filesystem_test_lines_match(&reader, expected));
+    filesystem_line_reader_destroy(&reader);
+    filesystem_unmap(&view);
+
+    filesystem_delete(FILESYSTEM_TEST_PATH);
+    return true;
+}
+
+void filesystem_register_tests() {
+    test_manager_register_test(filesystem_map_should_view_the_whole_file, "filesystem_map should view the whole file");
+    test_manager_register_test(filesystem_keep_mode_should_create_or_keep_the_file, "Keep mode should create the file or keep what it holds");
+    test_manager_register_test(filesystem_line_reader_should_split_lines, "Line reader should split lines");
+}
@@ -0,0 +1,335 @@
+#include "lz_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <platform/lz.h>
+#include <platform/platform.h>
+#include <platform/pancake_thread.h>
+#include <core/logger.h>
+#include <core/pancake_memory.h>
+#include <math/pancake_math.h>
+
+#define LZ_TEST_THREADS 4
+#define LZ_BENCHMARK_RUNS 8
+
+static void* lz_test_workers_state;
+
+// The calling thread makes up the rest of LZ_TEST_THREADS.
+static void lz_test_start_workers() {
+    u64 memory_requirement = 0;
+    initialize_lz_workers(&memory_requirement, 0, 0);
+    lz_test_workers_state = pancake_allocate(memory_requirement, MEMORY_TAG_AAPLICATION);
+    initialize_lz_workers(&memory_requirement, lz_test_workers_state, LZ_TEST_THREADS - 1);
+}
+
+static void lz_test_stop_workers() {
+    u64 memory_requirement = 0;
+    initialize_lz_workers(&memory_requirement, 0, 0);
+    shutdown_lz_workers(lz_test_workers_state);
+    pancake_free(lz_test_workers_state, memory_requirement, MEMORY_TAG_AAPLICATION);
+}
+
+static b8 lz_test_equal(const u8* a, const u8* b, u64 size) {
+    for (u64 i = 0; i < size; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static b8 lz_test_round_trip(const u8* data, u64 size) {
+    u64 capacity = lz_compress_bound(size);
+    u8* compressed = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u8* decompressed = pancake_allocate(size + 1, MEMORY_TAG_STRING);
+    u64 compressed_size = lz_compress_block(data, size, compressed, capacity);
+    b8 result = compressed_size != 0
+        && lz_decompress_block(compressed, compressed_size, decompressed, size)
+        && lz_test_equal(data, decompressed, size)
+        // a block only decompresses to its exact size
+        && !lz_decompress_block(compressed, compressed_size, decompressed, size + 1);
+    pancake_free(compressed, capacity, MEMORY_TAG_STRING);
+    pancake_free(decompressed, size + 1, MEMORY_TAG_STRING);
+    return result;
+}
+
+u8 lz_should_round_trip_blocks() {
+    const u64 size = 100000;
+    u8* data = pancake_allocate(size, MEMORY_TAG_STRING);
+    u8* compressed = pancake_allocate(lz_compress_bound(size), MEMORY_TAG_STRING);
+
+    expect_to_be_true(lz_test_round_trip(data, 0));
+    expect_to_be_true(lz_test_round_trip((const u8*)"abc", 3));
+
+    // a run of zeros: one long match overlapping itself
+    expect_to_be_true(lz_test_round_trip(data, size));
+    expect_to_be_true((lz_compress_block(data, size, compressed, lz_compress_bound(size)) < 1000));
+
+    // a repeating pattern, copied 8 bytes at a time
+    for (u64 i = 0; i < size; ++i) {
+        data[i] = (u8)('a' + i % 11);
+    }
+    expect_to_be_true(lz_test_round_trip(data, size));
+
+    // noise doesn't fit in less than its size
+    for (u64 i = 0; i < size; ++i) {
+        data[i] = (u8)krandom();
+    }
+    expect_should_be(0, lz_compress_block(data, 4096, compressed, 4095));
+    expect_to_be_true(lz_test_round_trip(data, size));
+
+    // truncated blocks are refused
+    u64 compressed_size = lz_compress_block("hello hello hello hello hello", 29, compressed, lz_compress_bound(29));
+    expect_to_be_false(lz_decompress_block(compressed, compressed_size - 1, data, 29));
+    expect_to_be_true(lz_decompress_block(compressed, compressed_size, data, 29));
+
+    pancake_free(compressed, lz_compress_bound(size), MEMORY_TAG_STRING);
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 lz_frame_should_decompress_any_block() {
+    const u64 size = 300000;
+    const u32 block_size = 16 * 1024;
+    u8* data = pancake_allocate(size, MEMORY_TAG_STRING);
+    // incompressible blocks first (stored as is), then text
+    for (u64 i = 0; i < size; ++i) {
+        data[i] = i < 100000 ? (u8)krandom() : (u8)("the quick brown fox jumps over the lazy dog "[i % 44] + (i / 5000) % 3);
+    }
+    u64 capacity = lz_frame_bound(size, block_size);
+    u8* frame = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u8* decompressed = pancake_allocate(size, MEMORY_TAG_STRING);
+
+    lz_test_start_workers();
+    u64 frame_size = lz_frame_compress(data, size, block_size, frame, capacity);
+    expect_to_be_true((frame_size != 0));
+    expect_to_be_true((frame_size < size));
+    lz_frame_info info;
+    expect_to_be_true(lz_frame_get_info(frame, frame_size, &info));
+    expect_should_be(size, info.size);
+    expect_should_be(19, info.block_count);
+
+    // any block on its own, the raw ones, the compressed ones and the short last one
+    u32 blocks[] = {2, 5, 11, 18};
+    for (u32 i = 0; i < 4; ++i) {
+        u64 offset = (u64)blocks[i] * block_size;
+        u64 length = size - offset < block_size ? size - offset : block_size;
+        expect_to_be_true(lz_frame_decompress_block(frame, frame_size, blocks[i], decompressed));
+        expect_to_be_true(lz_test_equal(data + offset, decompressed, length));
+    }
+    expect_to_be_false(lz_frame_decompress_block(frame, frame_size, 19, decompressed));
+
+    expect_to_be_true(lz_frame_decompress(frame, frame_size, decompressed, size, LZ_TEST_THREADS));
+    expect_to_be_true(lz_test_equal(data, decompressed, size));
+    expect_to_be_false(lz_frame_decompress(frame, frame_size, decompressed, size - 1, 1));
+
+    // a truncated block fails the whole frame, a truncated table fails its info
+    u8* block_end = frame + sizeof(lz_frame_header) + 10 * sizeof(u64);
+    block_end[0]--;
+    expect_to_be_false(lz_frame_decompress(frame, frame_size, decompressed, size, LZ_TEST_THREADS));
+    expect_to_be_false(lz_frame_get_info(frame, sizeof(lz_frame_header) + 8, &info));
+    // a size so large that rounding it up to whole blocks overflows, with a block count to match the overflow
+    lz_frame_header header = {0};
+    header.magic = LZ_FRAME_MAGIC;
+    header.block_size = block_size;
+    header.size = 0xFFFFFFFFFFFFFFFFull;
+    header.block_count = 0;
+    expect_to_be_false(lz_frame_get_info(&header, sizeof(header), &info));
+    lz_test_stop_workers();
+
+    pancake_free(decompressed, size, MEMORY_TAG_STRING);
+    pancake_free(frame, capacity, MEMORY_TAG_STRING);
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    return true;
+}
+
+// SPIR-V like words: loads, stores, multiplies and access chains over recent ids.
+static void lz_test_make_shader(u32* words, u64 count) {
+    words[0] = 0x07230203;
+    words[1] = 0x00010000;
+    words[2] = 0x00080001;
+    words[3] = 0x1000;
+    words[4] = 0;
+    u32 id = 64;
+    u64 i = 5;
+    while (i + 5 <= count) {
+        u32 recent = id - 1 - (u32)krandom_in_range(0, 15);
+        switch (krandom_in_range(0, 3)) {
+            case 0:
+                words[i++] = (4 << 16) | 61;
+                words[i++] = 6 + (u32)krandom_in_range(0, 2);
+                words[i++] = id++;
+                words[i++] = recent;
+                break;
+            case 1:
+                words[i++] = (5 << 16) | 133;
+                words[i++] = 7;
+                words[i++] = id++;
+                words[i++] = recent;
+                words[i++] = id - 2;
+                break;
+            case 2:
+                words[i++] = (5 << 16) | 65;
+                words[i++] = 9;
+                words[i++] = id++;
+                words[i++] = 20 + (u32)krandom_in_range(0, 3);
+                words[i++] = 30 + (u32)krandom_in_range(0, 3);
+                break;
+            default:
+                words[i++] = (3 << 16) | 62;
+                words[i++] = 20 + (u32)krandom_in_range(0, 3);
+                words[i++] = recent;
+                break;
+        }
+    }
+    while (i < count) {
+        words[i++] = (1 << 16) | 253;
+    }
+}
+
+// A grid of vertices (position, normal, uv) over a wavy terrain, then its triangle indices.
+static void lz_test_make_mesh(u8* data, u32 side) {
+    f32* vertex = (f32*)data;
+    for (u32 z = 0; z < side; ++z) {
+        for (u32 x = 0; x < side; ++x) {
+            f32 height = ksin(x * 0.1f) * kcos(z * 0.1f);
+            *vertex++ = (f32)x;
+            *vertex++ = height;
+            *vertex++ = (f32)z;
+            *vertex++ = -0.1f * kcos(x * 0.1f) * kcos(z * 0.1f);
+            *vertex++ = 1.0f;
+            *vertex++ = 0.1f * ksin(x * 0.1f) * ksin(z * 0.1f);
+            *vertex++ = (f32)x / side;
+            *vertex++ = (f32)z / side;
+        }
+    }
+    u32* index = (u32*)vertex;
+    for (u32 z = 0; z + 1 < side; ++z) {
+        for (u32 x = 0; x + 1 < side; ++x) {
+            u32 corner = z * side + x;
+            *index++ = corner;
+            *index++ = corner + side;
+            *index++ = corner + 1;
+            *index++ = corner + 1;
+            *index++ = corner + side;
+            *index++ = corner + side + 1;
+        }
+    }
+}
+
+// Compresses data as a frame, then times its decompression on one thread and on several.
+static b8 lz_test_benchmark(const char* name, const u8* data, u64 size) {
+    u64 capacity = lz_frame_bound(size, 0);
+    u8* frame = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u8* decompressed = pancake_allocate(size, MEMORY_TAG_STRING);
+
+    f64 start = platform_get_absolute_time();
+    u64 frame_size = lz_frame_compress(data, size, 0, frame, capacity);
+    f64 compress_time = platform_get_absolute_time() - start;
+
+    b8 result = frame_size != 0;
+    lz_test_start_workers();
+    f64 decompress_time[2] = {0};
+    u32 threads[2] = {1, LZ_TEST_THREADS};
+    for (u32 t = 0; t < 2 && result; ++t) {
+        start = platform_get_absolute_time();
+        for (u32 run = 0; run < LZ_BENCHMARK_RUNS; ++run) {
+            result = result && lz_frame_decompress(frame, frame_size, decompressed, size, threads[t]);
+        }
+        decompress_time[t] = (platform_get_absolute_time() - start) / LZ_BENCHMARK_RUNS;
+        result = result && lz_test_equal(data, decompressed, size);
+    }
+    lz_test_stop_workers();
+
+    if (result) {
+        f64 megabytes = size / (1024.0 * 1024.0);
+        PANCAKE_INFO("lz %s: %.2f MB to %.1f%%, compress %.0f MB/s, decompress %.0f MB/s (%u threads: %.0f MB/s).",
+            name, megabytes, 100.0 * frame_size / size,
+            megabytes / (compress_time > 0 ? compress_time : 1e-9),
+            megabytes / (decompress_time[0] > 0 ? decompress_time[0] : 1e-9),
+            LZ_TEST_THREADS, megabytes / (decompress_time[1] > 0 ? decompress_time[1] : 1e-9));
+    }
+    result = result && frame_size < size;
+
+    pancake_free(decompressed, size, MEMORY_TAG_STRING);
+    pancake_free(frame, capacity, MEMORY_TAG_STRING);
+    return result;
+}
+
+typedef struct lz_test_decompress_job {
+    const u8* frame;
+    u64 frame_size;
+    const u8* data;
+    u64 size;
+    b8 result;
+} lz_test_decompress_job;
+
+static u32 lz_test_decompress(void* params) {
+    lz_test_decompress_job* job = params;
+    u8* decompressed = platform_allocate(job->size, false);
+    job->result = true;
+    for (u32 run = 0; run < 4; ++run) {
+        job->result = job->result && lz_frame_decompress(job->frame, job->frame_size, decompressed, job->size, LZ_TEST_THREADS)
+            && lz_test_equal(job->data, decompressed, job->size);
+    }
+    platform_free(decompressed, false);
+    return 0;
+}
+
+u8 lz_frames_should_decompress_from_several_threads_at_once() {
+    const u64 size = 1024 * 1024;
+    u8* data = pancake_allocate(size, MEMORY_TAG_STRING);
+    for (u64 i = 0; i < size; ++i) {
+        data[i] = (u8)("the quick brown fox jumps over the lazy dog "[i % 44] + (i / 7000) % 5);
+    }
+    u64 capacity = lz_frame_bound(size, 16 * 1024);
+    u8* frame = pancake_allocate(capacity, MEMORY_TAG_STRING);
+    u64 frame_size = lz_frame_compress(data, size, 16 * 1024, frame, capacity);
+    expect_to_be_true((frame_size != 0));
+
+    // the workers are shared by every frame being decompressed
+    lz_test_start_workers();
+    pancake_thread threads[LZ_TEST_THREADS];
+    lz_test_decompress_job jobs[LZ_TEST_THREADS];
+    for (u32 i = 0; i < LZ_TEST_THREADS; ++i) {
+        jobs[i].frame = frame;
+        jobs[i].frame_size = frame_size;
+        jobs[i].data = data;
+        jobs[i].size = size;
+        expect_to_be_true(pancake_thread_create(lz_test_decompress, &jobs[i], &threads[i]));
+    }
+    for (u32 i = 0; i < LZ_TEST_THREADS; ++i) {
+        pancake_thread_wait(&threads[i]);
+        expect_to_be_true(jobs[i].result);
+    }
+    lz_test_stop_workers();
+
+    pancake_free(frame, capacity, MEMORY_TAG_STRING);
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 lz_should_compress_shader_and_mesh_data() {
+    const u64 shader_words = 256 * 1024;
+    u32* shader = pancake_allocate(shader_words * sizeof(u32), MEMORY_TAG_STRING);
+    lz_test_make_shader(shader, shader_words);
+    expect_to_be_true(lz_test_benchmark("shader", (const u8*)shader, shader_words * sizeof(u32)));
+    pancake_free(shader, shader_words * sizeof(u32), MEMORY_TAG_STRING);
+
+    const u32 side = 256;
+    u64 mesh_size = (u64)side * side * 8 * sizeof(f32) + (u64)(side - 1) * (side - 1) * 6 * sizeof(u32);
+    u8* mesh = pancake_allocate(mesh_size, MEMORY_TAG_STRING);
+    lz_test_make_mesh(mesh, side);
+    expect_to_be_true(lz_test_benchmark("mesh", mesh, mesh_size));
+    pancake_free(mesh, mesh_size, MEMORY_TAG_STRING);
+    return true;
+}
+
+void lz_register_tests() {
+    test_manager_register_test(lz_should_round_trip_blocks, "Lz should round trip blocks");
+    test_manager_register_test(lz_frame_should_decompress_any_block, "Lz frame should decompress any block");
+    test_manager_register_test(lz_frames_should_decompress_from_several_threads_at_once, "Lz frames should decompress from several threads at once");
+    test_manager_register_test(lz_should_compress_shader_and_mesh_data, "Lz should compress shader and mesh data");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void lz_register_tests();
@@ -0,0 +1,198 @@
+#include "pack_file_tests.h"
+#include "../tests_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <platform/pack_file.h>
+#include <platform/filesystem.h>
+#include <core/pancake_string.h>
+#include <core/pancake_memory.h>
+#include <containers/list.h>
+
+#include <stddef.h>  // offsetof
+
+#define PACK_TEST_PATH "pack_file_test.pack"
+#define PACK_TEST_FILE_COUNT 50
+
+u8 pack_file_should_find_every_file_it_holds() {
+    pack_builder builder;
+    // entries are used in place, at least 8 byte aligned
+    expect_to_be_false(pack_builder_begin(PACK_TEST_PATH, 4, &builder));
+    expect_to_be_false(pack_builder_begin(PACK_TEST_PATH, 24, &builder));
+    expect_to_be_true(pack_builder_begin(PACK_TEST_PATH, 64, &builder));
+    char path[64];
+    char contents[64];
+    for (u32 i = 0; i < PACK_TEST_FILE_COUNT; ++i) {
+        string_format(path, "assets/test/file_%u.txt", i);
+        u64 length = string_format(contents, "contents of file %u", i);
+        expect_to_be_true(pack_builder_add(&builder, path, contents, length));
+    }
+    // the same path twice is refused
+    expect_to_be_false(pack_builder_add(&builder, "assets/test/file_0.txt", "x", 1));
+    expect_to_be_true(pack_builder_end(&builder));
+
+    pack_file pack;
+    expect_to_be_true(pack_file_open(PACK_TEST_PATH, &pack));
+    expect_should_be(PACK_TEST_FILE_COUNT, pack.header->entry_count);
+    for (u32 i = 0; i < PACK_TEST_FILE_COUNT; ++i) {
+        string_format(path, "assets/test/file_%u.txt", i);
+        u64 length = string_format(contents, "contents of file %u", i);
+        const pack_entry* entry = pack_file_find(&pack, path);
+        expect_to_be_true((entry != 0));
+        expect_should_be(0, entry->offset % 64);
+        expect_should_be(length, entry->size);
+        expect_to_be_true(strings_nequal(contents, (const char*)pack_file_entry_data(&pack, entry), length));
+    }
+    expect_should_be(0, pack_file_find(&pack, "assets/test/missing.txt"));
+    pack_file_close(&pack);
+
+    // mounted, it is searched before loose files
+    expect_to_be_true(filesystem_mount_pack(PACK_TEST_PATH));
+    file_view view;
+    expect_to_be_true(filesystem_load("assets/test/file_7.txt", FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_should_be(string_length("contents of file 7"), view.size);
+    expect_to_be_true(strings_nequal("contents of file 7", (const char*)view.data, view.size));
+    filesystem_unmap(&view);
+    expect_to_be_false(filesystem_load("assets/test/missing.txt", FILE_MAP_HINT_SEQUENTIAL, &view));
+    filesystem_unmount_packs();
+
+    filesystem_delete(PACK_TEST_PATH);
+    return true;
+}
+
+u8 pack_file_should_decompress_compressed_files() {
+    // large enough to be decompressed across threads
+    const u64 size = 1024 * 1024;
+    u8* data = pancake_allocate(size, MEMORY_TAG_STRING);
+    for (u64 i = 0; i < size; ++i) {
+        data[i] = (u8)(i % 251 + i / 4096);
+    }
+    pack_builder builder;
+    expect_to_be_true(pack_builder_begin(PACK_TEST_PATH, 0, &builder));
+    expect_to_be_true(pack_builder_add_compressed(&builder, "assets/test/big.bin", data, size, 0));
+    // too small to shrink, stored as is
+    expect_to_be_true(pack_builder_add_compressed(&builder, "assets/test/small.txt", "tiny", 4, 0));
+    expect_to_be_true(pack_builder_end(&builder));
+
+    expect_to_be_true(filesystem_mount_pack(PACK_TEST_PATH));
+    file_view view;
+    expect_to_be_true(filesystem_load("assets/test/big.bin", FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_should_be(size, view.size);
+    expect_to_be_true((view.owned_data != 0));
+    b8 equal = true;
+    for (u64 i = 0; i < size && equal; ++i) {
+        equal = view.data[i] == data[i];
+    }
+    expect_to_be_true(equal);
+    filesystem_unmap(&view);
+
+    expect_to_be_true(filesystem_load("assets/test/small.txt", FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_should_be(0, view.owned_data);
+    expect_to_be_true(strings_nequal("tiny", (const char*)view.data, 4));
+    filesystem_unmap(&view);
+    filesystem_unmount_packs();
+
+    filesystem_delete(PACK_TEST_PATH);
+    pancake_free(data, size, MEMORY_TAG_STRING);
+    return true;
+}
+
+#define PACK_TEST_DIRECTORY "pack_file_test"
+#define PACK_TEST_SHADER "pack_file_test/assets/shaders/Builtin.Test.vert.spv"
+// Inside the directory packed, it must not end up in itself.
+#define PACK_TEST_DIRECTORY_PACK "pack_file_test/assets/assets.pack"
+
+static b8 pack_file_test_write(const char* path, const char* contents) {
+    file_handle file;
+    u64 written = 0;
+    if (!filesystem_open(path, FILE_MODE_WRITE, true, &file)) {
+        return false;
+    }
+    b8 result = filesystem_write(&file, string_length(contents), contents, &written);
+    filesystem_close(&file);
+    return result;
+}
+
+u8 pack_file_should_hold_a_directory_under_the_paths_the_engine_loads() {
+    expect_to_be_true(filesystem_create_directory(PACK_TEST_DIRECTORY));
+    expect_to_be_true(filesystem_create_directory(PACK_TEST_DIRECTORY "/assets"));
+    expect_to_be_true(filesystem_create_directory(PACK_TEST_DIRECTORY "/assets/shaders"));
+    expect_to_be_true(pack_file_test_write(PACK_TEST_SHADER, "spir-v"));
+    expect_to_be_true(pack_file_test_write(PACK_TEST_DIRECTORY "/assets/readme.txt", "readme"));
+
+    // the directory's name goes first, as in "assets/shaders/%s.%s.spv" of the renderer
+    pack_builder builder;
+    expect_to_be_true(pack_builder_begin(PACK_TEST_DIRECTORY_PACK, 0, &builder));
+    expect_to_be_true(pack_builder_add_directory(&builder, PACK_TEST_DIRECTORY "/assets/", 0, true));
+    expect_should_be(2, list_length(builder.entries));
+    expect_to_be_true(pack_builder_end(&builder));
+
+    expect_to_be_true(filesystem_mount_pack(PACK_TEST_DIRECTORY_PACK));
+    file_view view;
+    expect_to_be_true(filesystem_load("assets/shaders/Builtin.Test.vert.spv", FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_should_be(6, view.size);
+    expect_to_be_true(strings_nequal("spir-v", (const char*)view.data, view.size));
+    filesystem_unmap(&view);
+    expect_to_be_true(filesystem_load("assets/readme.txt", FILE_MAP_HINT_SEQUENTIAL, &view));
+    filesystem_unmap(&view);
+    expect_to_be_false(filesystem_load("shaders/Builtin.Test.vert.spv", FILE_MAP_HINT_SEQUENTIAL, &view));
+    filesystem_unmount_packs();
+
+    // or under a prefix of the caller's, none at all
+    expect_to_be_true(pack_builder_begin(PACK_TEST_DIRECTORY_PACK, 0, &builder));
+    expect_to_be_true(pack_builder_add_directory(&builder, PACK_TEST_DIRECTORY "/assets", "", false));
+    expect_to_be_true(pack_builder_end(&builder));
+    expect_to_be_true(filesystem_mount_pack(PACK_TEST_DIRECTORY_PACK));
+    expect_to_be_true(filesystem_load("shaders/Builtin.Test.vert.spv", FILE_MAP_HINT_SEQUENTIAL, &view));
+    expect_to_be_true(strings_nequal("spir-v", (const char*)view.data, view.size));
+    filesystem_unmap(&view);
+    filesystem_unmount_packs();
+
+    filesystem_delete(PACK_TEST_DIRECTORY_PACK);
+    filesystem_delete(PACK_TEST_SHADER);
+    filesystem_delete(PACK_TEST_DIRECTORY "/assets/readme.txt");
+    return true;
+}
+
+// Builds a one file pack, then overwrites a field of its entry.
+static b8 pack_file_test_corrupt(u64 field_offset, const void* value, u64 value_size) {
+    pack_builder builder;
+    b8 result = pack_builder_begin(PACK_TEST_PATH, 0, &builder)
+        && pack_builder_add(&builder, "assets/test/file.txt", "contents", 8)
+        && pack_builder_end(&builder);
+
+    file_handle file;
+    pack_header header;
+    u64 bytes = 0;
+    result = result && filesystem_open(PACK_TEST_PATH, FILE_MODE_WRITE | FILE_MODE_KEEP, true, &file);
+    if (result) {
+        result = filesystem_read(&file, sizeof(header), &header, &bytes)
+            && filesystem_seek(&file, header.index_offset + field_offset)
+            && filesystem_write(&file, value_size, value, &bytes);
+        filesystem_close(&file);
+    }
+    return result;
+}
+
+u8 pack_file_should_refuse_inconsistent_entries() {
+    pack_file pack;
+    // a stored entry larger than its data would be read past the mapping
+    u64 size = 4096;
+    expect_to_be_true(pack_file_test_corrupt(offsetof(pack_entry, size), &size, sizeof(size)));
+    expect_to_be_false(pack_file_open(PACK_TEST_PATH, &pack));
+
+    u16 compression = 7;
+    expect_to_be_true(pack_file_test_corrupt(offsetof(pack_entry, compression), &compression, sizeof(compression)));
+    expect_to_be_false(pack_file_open(PACK_TEST_PATH, &pack));
+
+    filesystem_delete(PACK_TEST_PATH);
+    return true;
+}
+
+void pack_file_register_tests() {
+    test_manager_register_test(pack_file_should_find_every_file_it_holds, "Pack file should find every file it holds");
+    test_manager_register_test(pack_file_should_decompress_compressed_files, "Pack file should decompress compressed files");
+    test_manager_register_test(pack_file_should_hold_a_directory_under_the_paths_the_engine_loads, "Pack file should hold a directory under the paths the engine loads");
+    test_manager_register_test(pack_file_should_refuse_inconsistent_entries, "Pack file should refuse inconsistent entries");
+}
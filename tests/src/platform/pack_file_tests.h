@@ -0,0 +1,3 @@
+#pragma once
+
+void pack_file_register_tests();